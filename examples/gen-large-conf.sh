@@ -0,0 +1,58 @@
+#!/bin/sh
+#
+# Generates a synthetic configuration to benchmark startup of large setups:
+#
+#   examples/gen-large-conf.sh 4 5000 > /tmp/large.xml
+#   mbslave --stats /tmp/large.xml
+#
+# Writes <slaves> slaves with <pins> pins each, split evenly over holding
+# registers, input registers, coils and inputs. Register pins cycle through
+# all types, bit mapped registers and swapped words included. Slave n
+# listens on TCP port 1502+n.
+
+if [ $# -ne 2 ] || [ "$1" -lt 1 ] || [ "$2" -lt 4 ] || [ "$2" -gt 160000 ]; then
+  echo "usage: $0 <slaves> <pins per slave, 4..160000>" >&2
+  exit 1
+fi
+
+awk -v slaves="$1" -v pins="$2" '
+function regs(tag, prefix, n,   i, t) {
+  printf "    <%s start=\"0\">\n", tag
+  for (i = 0; i < n; i++) {
+    t = i % 8
+    if (t == 0) printf "      <pin name=\"%s-%d\" type=\"s16\"/>\n", prefix, i
+    else if (t == 1) printf "      <pin name=\"%s-%d\" type=\"u16\"/>\n", prefix, i
+    else if (t == 2) printf "      <pin name=\"%s-%d\" type=\"s32\"/>\n", prefix, i
+    else if (t == 3) printf "      <pin name=\"%s-%d\" type=\"u32\" wordswap=\"true\"/>\n", prefix, i
+    else if (t == 4) printf "      <pin name=\"%s-%d\" type=\"float\"/>\n", prefix, i
+    else if (t == 5) printf "      <pin name=\"%s-%d\" type=\"u16\" byteswap=\"true\"/>\n", prefix, i
+    else {
+      printf "      <bitRegister>\n"
+      printf "        <pin name=\"%s-%d-bit-0\" bit=\"0\"/>\n", prefix, i
+      printf "        <pin name=\"%s-%d-bit-1\" bit=\"1\"/>\n", prefix, i
+      printf "      </bitRegister>\n"
+      i++
+    }
+  }
+  printf "    </%s>\n", tag
+}
+function bits(tag, prefix, n,   i) {
+  printf "    <%s start=\"0\">\n", tag
+  for (i = 0; i < n; i++)
+    printf "      <pin name=\"%s-%d\"/>\n", prefix, i
+  printf "    </%s>\n", tag
+}
+BEGIN {
+  q = int(pins / 4)
+  print "<modbusSlaves>"
+  for (s = 0; s < slaves; s++) {
+    printf "  <modbusSlave name=\"slave-%d\">\n", s
+    printf "    <tcpListener port=\"%d\"/>\n", 1502 + s
+    regs("holdingRegisters", "hr", q)
+    regs("inputRegisters", "ir", q)
+    bits("coils", "coil", q)
+    bits("inputs", "in", pins - 3 * q)
+    print "  </modbusSlave>"
+  }
+  print "</modbusSlaves>"
+}'
@@ -0,0 +1,97 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mbslave_cache.h"
+#include "mbslave_prot.h"
+
+static LCMBS_CONF_CACHE_ENTRY_T *getEntry(LCMBS_CONF_CACHE_T *cache, uint8_t fnk, uint16_t start, uint16_t count) {
+  uint32_t hash = ((uint32_t) fnk << 24) ^ ((uint32_t) start << 8) ^ count;
+  hash *= 2654435761U;
+  return &cache->entries[(hash >> 16) % cache->size];
+}
+
+static int rawEqual(LCMBS_CONF_REGS_T *regs, uint16_t start, uint16_t count, const uint32_t *raw) {
+  int i;
+
+  for (i = 0; i < count; i++) {
+    LCMBS_CONF_REG_T *reg = lcmbsPtabGet(&regs->map, start + i);
+
+    if (reg->pin != NULL) {
+      // multi word pins are compared once at their first register
+      if (reg->index == 0 && lcmbsProtReadPin(reg->pin) != raw[i]) {
+        return 0;
+      }
+      continue;
+    }
+
+    if (reg->bitpins != NULL) {
+      if (lcmbsProtReadBitpins(reg->bitpins) != raw[i]) {
+        return 0;
+      }
+      continue;
+    }
+
+    // virtual registers are never cached
+    return 0;
+  }
+
+  return 1;
+}
+
+int lcmbsCacheRead(LCMBS_CONF_CACHE_T *cache, LCMBS_CONF_REGS_T *regs, uint8_t fnk, uint16_t start, uint16_t count, LCMBS_VECT_T *out) {
+  LCMBS_CONF_CACHE_ENTRY_T *entry;
+  uint32_t raw[LCMBS_CACHE_REGS_MAX];
+  uint16_t data[LCMBS_CACHE_REGS_MAX];
+  int hit = 0;
+
+  if (count > LCMBS_CACHE_REGS_MAX) {
+    return 0;
+  }
+
+  pthread_mutex_lock(&cache->lock);
+
+  // check key and data generation, pin values are
+  // compared on a copy so the lock is held only briefly
+  entry = getEntry(cache, fnk, start, count);
+  if (
+    entry->valid &&
+    entry->fnk == fnk &&
+    entry->start == start &&
+    entry->count == count &&
+    entry->gen == regs->gen) {
+    memcpy(raw, entry->raw, count * sizeof(uint32_t));
+    memcpy(data, entry->data, count * sizeof(uint16_t));
+    hit = 1;
+  }
+
+  pthread_mutex_unlock(&cache->lock);
+
+  if (!hit || !rawEqual(regs, start, count, raw)) {
+    return 0;
+  }
+
+  return lcmbsVectPutData(out, data, count * sizeof(uint16_t)) != NULL;
+}
+
+void lcmbsCacheStore(LCMBS_CONF_CACHE_T *cache, uint8_t fnk, uint16_t start, uint16_t count, uint32_t gen, const uint32_t *raw, const void *data) {
+  LCMBS_CONF_CACHE_ENTRY_T *entry;
+
+  if (count > LCMBS_CACHE_REGS_MAX) {
+    return;
+  }
+
+  pthread_mutex_lock(&cache->lock);
+
+  entry = getEntry(cache, fnk, start, count);
+  entry->valid = 1;
+  entry->fnk = fnk;
+  entry->start = start;
+  entry->count = count;
+  entry->gen = gen;
+  memcpy(entry->raw, raw, count * sizeof(uint32_t));
+  memcpy(entry->data, data, count * sizeof(uint16_t));
+
+  pthread_mutex_unlock(&cache->lock);
+}
+
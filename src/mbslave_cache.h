@@ -0,0 +1,13 @@
+#ifndef _LCMBS_CACHE_H
+#define _LCMBS_CACHE_H
+
+#include <stdint.h>
+
+#include "mbslave_util.h"
+#include "mbslave_conf.h"
+
+int lcmbsCacheRead(LCMBS_CONF_CACHE_T *cache, LCMBS_CONF_REGS_T *regs, uint8_t fnk, uint16_t start, uint16_t count, LCMBS_VECT_T *out);
+void lcmbsCacheStore(LCMBS_CONF_CACHE_T *cache, uint8_t fnk, uint16_t start, uint16_t count, uint32_t gen, const uint32_t *raw, const void *data);
+
+#endif
+
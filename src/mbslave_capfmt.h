@@ -0,0 +1,38 @@
+#ifndef _LCMBS_CAPFMT_H
+#define _LCMBS_CAPFMT_H
+
+#include <stdint.h>
+
+// Layout of a traffic capture
+//
+// The file starts with LCMBS_CAPFMT_HDR_T, followed by one record per
+// request in the order the responses were sent. A record is the fixed
+// LCMBS_CAPFMT_REC_T, followed by reqLen bytes of request and rspLen bytes
+// of response. Both are unit id and PDU, independent of the framing of the
+// listener; rspLen is 0 if no response was sent.
+//
+// ts is the CLOCK_MONOTONIC time in nanoseconds the request was complete,
+// service the nanoseconds until its response, saturated at UINT32_MAX
+// (4.29 s). conn identifies the connection, requests of one connection
+// were answered in order.
+
+#define LCMBS_CAPFMT_MAGIC   0x4342534d
+#define LCMBS_CAPFMT_VERSION 1
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t monotonic;
+  uint64_t realtime;
+} LCMBS_CAPFMT_HDR_T;
+
+typedef struct {
+  uint64_t ts;
+  uint32_t service;
+  uint16_t conn;
+  uint8_t reqLen;
+  uint8_t rspLen;
+} LCMBS_CAPFMT_REC_T;
+
+#endif
+
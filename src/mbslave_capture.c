@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "mbslave_capture.h"
+#include "mbslave_util.h"
+
+#define CAPTURE_BUFSIZE 65536
+
+static FILE *capFile;
+static int capFailed;
+static pthread_mutex_t capLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+int lcmbsCaptureOpen(const char *file) {
+  LCMBS_CAPFMT_HDR_T hdr;
+  struct timespec ts;
+
+  capFile = fopen(file, "w");
+  if (!capFile) {
+    fprintf(stderr, "%s: ERROR: unable to create capture file %s\n", compName, file);
+    goto fail0;
+  }
+  setvbuf(capFile, NULL, _IOFBF, CAPTURE_BUFSIZE);
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = LCMBS_CAPFMT_MAGIC;
+  hdr.version = LCMBS_CAPFMT_VERSION;
+  hdr.monotonic = lcmbsTimeNs();
+  clock_gettime(CLOCK_REALTIME, &ts);
+  hdr.realtime = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  if (fwrite(&hdr, sizeof(hdr), 1, capFile) != 1) {
+    fprintf(stderr, "%s: ERROR: unable to write capture file %s\n", compName, file);
+    goto fail1;
+  }
+
+  return 0;
+
+fail1:
+  fclose(capFile);
+  capFile = NULL;
+fail0:
+  return -1;
+}
+
+void lcmbsCaptureClose(void) {
+  if (capFile != NULL) {
+    fclose(capFile);
+    capFile = NULL;
+  }
+}
+
+void lcmbsCaptureWrite(uint16_t conn, uint64_t start, const uint8_t *req, size_t reqLen, const uint8_t *rsp, size_t rspLen) {
+  LCMBS_CAPFMT_REC_T rec;
+  uint64_t service;
+
+  // capture disabled, or requests too large for a valid ADU
+  if (capFile == NULL || reqLen > 255 || rspLen > 255) {
+    return;
+  }
+
+  // saturate like the trace, don't let slow requests wrap to fast ones
+  service = lcmbsTimeNs() - start;
+  rec.ts = start;
+  rec.service = (service > UINT32_MAX) ? UINT32_MAX : service;
+  rec.conn = conn;
+  rec.reqLen = reqLen;
+  rec.rspLen = rspLen;
+
+  // records go through the stdio buffer, so the lock
+  // is only held for a copy in most cases
+  pthread_mutex_lock(&capLock);
+  if (
+    fwrite(&rec, sizeof(rec), 1, capFile) != 1 ||
+    fwrite(req, 1, reqLen, capFile) != reqLen ||
+    fwrite(rsp, 1, rspLen, capFile) != rspLen) {
+    if (!capFailed) {
+      fprintf(stderr, "%s: ERROR: writing capture file failed, capture incomplete\n", compName);
+      capFailed = 1;
+    }
+  }
+  pthread_mutex_unlock(&capLock);
+}
+
@@ -0,0 +1,14 @@
+#ifndef _LCMBS_CAPTURE_H
+#define _LCMBS_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mbslave_capfmt.h"
+
+int lcmbsCaptureOpen(const char *file);
+void lcmbsCaptureClose(void);
+void lcmbsCaptureWrite(uint16_t conn, uint64_t start, const uint8_t *req, size_t reqLen, const uint8_t *rsp, size_t rspLen);
+
+#endif
+
@@ -0,0 +1,104 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "mbslave_chg.h"
+#include "mbslave_prot.h"
+
+static uint16_t blockMask(int idx, int blockSize) {
+  int block = idx / blockSize;
+  if (block >= LCMBS_CHG_BLOCKS) {
+    block = LCMBS_CHG_BLOCKS - 1;
+  }
+  return 1 << block;
+}
+
+void lcmbsChgUpdate(LCMBS_CONF_SLAVE_T *slave) {
+  LCMBS_CONF_CHG_T *chg = &slave->chg;
+  LCMBS_CONF_REGS_T *regs = &slave->inputRegs;
+  LCMBS_CONF_BITS_T *bits = &slave->inputs;
+  uint16_t regsMap = 0;
+  uint16_t bitsMap = 0;
+  int changed = 0;
+  size_t i;
+
+  if (!chg->enabled) {
+    return;
+  }
+
+  pthread_mutex_lock(&chg->lock);
+
+  // diff input registers against last snapshot
+  for (i = 0; i < regs->regs.count; i++) {
+    LCMBS_CONF_REG_T *reg = lcmbsVectGet(&regs->regs, i);
+    uint32_t val;
+
+    if (reg->pin != NULL) {
+      // multi word pins are compared once at their first register
+      if (reg->index > 0) {
+        continue;
+      }
+      val = lcmbsProtReadPin(reg->pin);
+    } else if (reg->bitpins != NULL) {
+      val = lcmbsProtReadBitpins(reg->bitpins);
+    } else {
+      continue;
+    }
+
+    if (chg->regsSnap[i] != val) {
+      chg->regsSnap[i] = val;
+      if (chg->regsBlockSize > 0) {
+        regsMap |= blockMask(i, chg->regsBlockSize);
+      }
+      changed = 1;
+    }
+  }
+
+  // diff inputs against last snapshot
+  for (i = 0; i < bits->pins.count; i++) {
+    LCMBS_CONF_BIT_PIN_T *pin = lcmbsVectGet(&bits->pins, i);
+    uint8_t val = **pin->pin ? 1 : 0;
+
+    if (chg->bitsSnap[i] != val) {
+      chg->bitsSnap[i] = val;
+      if (chg->bitsBlockSize > 0) {
+        bitsMap |= blockMask(i, chg->bitsBlockSize);
+      }
+      changed = 1;
+    }
+  }
+
+  // first call only takes the initial snapshot
+  if (!chg->valid) {
+    chg->valid = 1;
+  } else if (changed) {
+    chg->counter++;
+    chg->regsMap = regsMap;
+    chg->bitsMap = bitsMap;
+  }
+
+  pthread_mutex_unlock(&chg->lock);
+}
+
+uint16_t lcmbsChgGetReg(LCMBS_CONF_SLAVE_T *slave, int vreg) {
+  LCMBS_CONF_CHG_T *chg = &slave->chg;
+  uint16_t val;
+
+  pthread_mutex_lock(&chg->lock);
+  switch (vreg) {
+    case LCMBS_VREG_CHGCNT:
+      val = chg->counter;
+      break;
+    case LCMBS_VREG_CHGREGS:
+      val = chg->regsMap;
+      break;
+    case LCMBS_VREG_CHGBITS:
+      val = chg->bitsMap;
+      break;
+    default:
+      val = 0;
+  }
+  pthread_mutex_unlock(&chg->lock);
+
+  return val;
+}
+
@@ -0,0 +1,12 @@
+#ifndef _LCMBS_CHG_H
+#define _LCMBS_CHG_H
+
+#include <stdint.h>
+
+#include "mbslave_conf.h"
+
+void lcmbsChgUpdate(LCMBS_CONF_SLAVE_T *slave);
+uint16_t lcmbsChgGetReg(LCMBS_CONF_SLAVE_T *slave, int vreg);
+
+#endif
+
@@ -0,0 +1,128 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mbslave_coal.h"
+#include "mbslave_prot.h"
+
+static uint32_t tableGen(LCMBS_CONF_SLAVE_T *slave, uint8_t fnk) {
+  switch (fnk) {
+    case MB_FNK_READ_COIL_STATUS:
+      return __atomic_load_n(&slave->coils.gen, __ATOMIC_ACQUIRE);
+    case MB_FNK_READ_INPUT_STATUS:
+      return __atomic_load_n(&slave->inputs.gen, __ATOMIC_ACQUIRE);
+    case MB_FNK_READ_HOLDING_REG:
+      return __atomic_load_n(&slave->holdingRegs.gen, __ATOMIC_ACQUIRE);
+    default:
+      return __atomic_load_n(&slave->inputRegs.gen, __ATOMIC_ACQUIRE);
+  }
+}
+
+static LCMBS_CONF_COAL_SLOT_T *findSlot(LCMBS_CONF_COAL_T *coal, uint32_t gen, uint8_t fnk, const uint8_t *key, size_t keyLen) {
+  int i;
+
+  // only join evaluations started after the last write to the table,
+  // a client must see the writes it already got a response for
+  for (i = 0; i < coal->size; i++) {
+    LCMBS_CONF_COAL_SLOT_T *slot = &coal->slots[i];
+    if (slot->refs > 0 && !slot->done && slot->gen == gen && slot->fnk == fnk && slot->keyLen == keyLen && memcmp(slot->key, key, keyLen) == 0) {
+      return slot;
+    }
+  }
+
+  return NULL;
+}
+
+static LCMBS_CONF_COAL_SLOT_T *allocSlot(LCMBS_CONF_COAL_T *coal) {
+  int i;
+
+  for (i = 0; i < coal->size; i++) {
+    LCMBS_CONF_COAL_SLOT_T *slot = &coal->slots[i];
+    if (slot->refs == 0) {
+      return slot;
+    }
+  }
+
+  return NULL;
+}
+
+int lcmbsCoalProc(LCMBS_CONF_SLAVE_T *slave, uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out, LCMBS_COAL_PROC_T proc) {
+  LCMBS_CONF_COAL_T *coal = &slave->coal;
+  LCMBS_CONF_COAL_SLOT_T *slot;
+  const uint8_t *key = in->data + in->pos;
+  size_t keyLen = in->count - in->pos;
+  uint32_t gen;
+  int err;
+
+  if (coal->size == 0 || keyLen > LCMBS_COAL_KEY_MAX) {
+    return proc(slave, sid, fnk, in, out);
+  }
+
+  pthread_mutex_lock(&coal->lock);
+
+  // join an identical request in flight
+  gen = tableGen(slave, fnk);
+  slot = findSlot(coal, gen, fnk, key, keyLen);
+  if (slot != NULL) {
+    slot->refs++;
+    while (!slot->done) {
+      pthread_cond_wait(&slot->cond, &coal->lock);
+    }
+
+    // copy result with our own slave id
+    err = slot->err;
+    if (err == MB_ERR_OK) {
+      lcmbsVectClear(out);
+      if (!lcmbsVectPutByte(out, sid) || !lcmbsVectPutData(out, slot->data, slot->len)) {
+        err = MB_ERR_SLAVE_DEVICE_FAILURE;
+      }
+    }
+
+    slot->refs--;
+    pthread_mutex_unlock(&coal->lock);
+    return err;
+  }
+
+  // no free slot, evaluate uncoalesced
+  slot = allocSlot(coal);
+  if (slot == NULL) {
+    pthread_mutex_unlock(&coal->lock);
+    return proc(slave, sid, fnk, in, out);
+  }
+
+  // publish request as in flight
+  slot->refs = 1;
+  slot->done = 0;
+  slot->gen = gen;
+  slot->fnk = fnk;
+  slot->keyLen = keyLen;
+  memcpy(slot->key, key, keyLen);
+  pthread_mutex_unlock(&coal->lock);
+
+  // evaluate once for all waiters
+  err = proc(slave, sid, fnk, in, out);
+
+  pthread_mutex_lock(&coal->lock);
+
+  // store result without slave id
+  slot->err = err;
+  slot->len = 0;
+  if (err == MB_ERR_OK) {
+    if (out->count < 1 || (out->count - 1) > LCMBS_COAL_DATA_MAX) {
+      slot->err = MB_ERR_SLAVE_DEVICE_FAILURE;
+    } else {
+      slot->len = out->count - 1;
+      memcpy(slot->data, out->data + 1, slot->len);
+    }
+  }
+
+  // wake up waiters
+  slot->done = 1;
+  slot->refs--;
+  pthread_cond_broadcast(&slot->cond);
+
+  pthread_mutex_unlock(&coal->lock);
+
+  return err;
+}
+
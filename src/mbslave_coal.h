@@ -0,0 +1,14 @@
+#ifndef _LCMBS_COAL_H
+#define _LCMBS_COAL_H
+
+#include <stdint.h>
+
+#include "mbslave_util.h"
+#include "mbslave_conf.h"
+
+typedef int (*LCMBS_COAL_PROC_T)(LCMBS_CONF_SLAVE_T *slave, uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out);
+
+int lcmbsCoalProc(LCMBS_CONF_SLAVE_T *slave, uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out, LCMBS_COAL_PROC_T proc);
+
+#endif
+
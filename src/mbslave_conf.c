@@ -17,21 +17,38 @@
 //
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <expat.h>
 #include <signal.h>
+#include <limits.h>
 
 #include "mbslave_conf.h"
+#include "mbslave_rtxfmt.h"
 
 #define BUFFSIZE 4096
 
+#define STATE_HASH_SIZE 256
+
 typedef enum {
   lcmbsConfTypeNone,
   lcmbsConfTypeSlaves,
   lcmbsConfTypeSlave,
   lcmbsConfTypeTcpListener,
   lcmbsConfTypeSerialListener,
+  lcmbsConfTypeUnixListener,
+  lcmbsConfTypeUdpListener,
+  lcmbsConfTypeTlsListener,
+  lcmbsConfTypeResponseCache,
+  lcmbsConfTypeReadCoalescing,
+  lcmbsConfTypeSharedMemory,
+  lcmbsConfTypeRealtime,
+  lcmbsConfTypeFifoQueues,
+  lcmbsConfTypeFifoQueue,
+  lcmbsConfTypeSampleCapture,
+  lcmbsConfTypeSamplePin,
+  lcmbsConfTypeFileTable,
   lcmbsConfTypeHoldingRegs,
   lcmbsConfTypeHoldingReg,
   lcmbsConfTypeHoldingBitReg,
@@ -40,10 +57,31 @@ typedef enum {
   lcmbsConfTypeInputReg,
   lcmbsConfTypeInputBitReg,
   lcmbsConfTypeInputBitRegPin,
+  lcmbsConfTypeInputChgCnt,
+  lcmbsConfTypeInputChgMap,
+  lcmbsConfTypeInputCycleCnt,
+  lcmbsConfTypeInputCycleTs,
   lcmbsConfTypeInputs,
   lcmbsConfTypeInput,
   lcmbsConfTypeCoils,
-  lcmbsConfTypeCoil
+  lcmbsConfTypeCoil,
+  lcmbsConfTypeHoldingRange,
+  lcmbsConfTypeHoldingRangeReg,
+  lcmbsConfTypeHoldingRangeBitReg,
+  lcmbsConfTypeHoldingRangeBitRegPin,
+  lcmbsConfTypeInputRegsRange,
+  lcmbsConfTypeInputRangeReg,
+  lcmbsConfTypeInputRangeBitReg,
+  lcmbsConfTypeInputRangeBitRegPin,
+  lcmbsConfTypeInputRangeChgCnt,
+  lcmbsConfTypeInputRangeChgMap,
+  lcmbsConfTypeInputRangeCycleCnt,
+  lcmbsConfTypeInputRangeCycleTs,
+  lcmbsConfTypeInputsRange,
+  lcmbsConfTypeInputsRangeInput,
+  lcmbsConfTypeCoilsRange,
+  lcmbsConfTypeCoilsRangeCoil,
+  lcmbsConfTypeCount
 } LCMBS_CONF_TYPE_T;
 
 typedef struct {
@@ -51,6 +89,11 @@ typedef struct {
   LCMBS_CONF_TYPE_T currConfType;
   LCMBS_CONF_SLAVE_T *currSlave;
   LCMBS_VECT_T *currBitpins;
+  LCMBS_CONF_SAMPLE_T *currSample;
+  int *rangeNext;
+  int rangeNextSaved;
+  size_t slaveArenaUsed;
+  LCMBS_HSET_T slaveNames;
   LCMBS_CONF_T *conf;
 } LCMBS_CONF_PARSER_T;
 
@@ -62,58 +105,132 @@ typedef struct {
   void (*validator)(LCMBS_CONF_PARSER_T *);
 } LCMBS_CONF_STATE_T;
 
-LCMBS_CONF_T *lcmbsConfParse(const char *filename);
-void lcmbsConfFree(LCMBS_CONF_T *conf);
-
-void lcmbsConfInitRegs(LCMBS_CONF_REGS_T *regs);
+void lcmbsConfInitRegs(LCMBS_CONF_REGS_T *regs, LCMBS_ARENA_T *arena);
 void lcmbsConfFreeRegs(LCMBS_CONF_REGS_T *regs);
-void lcmbsConfInitBits(LCMBS_CONF_BITS_T *bits);
+void lcmbsConfInitBits(LCMBS_CONF_BITS_T *bits, LCMBS_ARENA_T *arena);
 void lcmbsConfFreeBits(LCMBS_CONF_BITS_T *bits);
-
+void lcmbsConfInitChg(LCMBS_CONF_CHG_T *chg);
+void lcmbsConfFreeChg(LCMBS_CONF_CHG_T *chg);
+void lcmbsConfInitCache(LCMBS_CONF_CACHE_T *cache);
+void lcmbsConfFreeCache(LCMBS_CONF_CACHE_T *cache);
+void lcmbsConfInitCoal(LCMBS_CONF_COAL_T *coal);
+void lcmbsConfFreeCoal(LCMBS_CONF_COAL_T *coal);
+
+void lcmbsConfInitStates(void);
 void lcmbsConfXmlStartHandler(void *data, const char *el, const char **attr);
 void lcmbsConfXmlEndHandler(void *data, const char *el);
 
 void lcmbsConfParseSlaveAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfValidateSlave(LCMBS_CONF_PARSER_T *parser);
 void lcmbsConfParseTcpLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseSerLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
-void lcmbsConfParseListAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, int *start, const char *type);
+void lcmbsConfParseUnixLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseUdpLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseTlsLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseCacheAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseCoalAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseShmAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseRtxAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseFifosAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfValidateFifos(LCMBS_CONF_PARSER_T *parser);
+void lcmbsConfParseFifoAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseSampleAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfValidateSample(LCMBS_CONF_PARSER_T *parser);
+void lcmbsConfParseSamplePinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseTableAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+int lcmbsConfAllocAddr(LCMBS_CONF_PARSER_T *parser, int *next, int count, const char *type);
+void lcmbsConfParseListAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, int *defined, int *next, const char *type);
+void lcmbsConfParseRangeAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, int *next, const char *type);
+void lcmbsConfValidateRange(LCMBS_CONF_PARSER_T *parser);
 void lcmbsConfParseBitPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_BITS_T *bits, const char *type);
 void lcmbsConfParseRegPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_REGS_T *regs, const char *type);
 void lcmbsConfParseBitRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_REGS_T *regs, const char *type);
 void lcmbsConfParseBitRegPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_REGS_T *regs, const char *type);
+void lcmbsConfParseChgRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_REGS_T *regs, int vreg, const char *type);
+void lcmbsConfParseCycleRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_REGS_T *regs, int vreg, int count, const char *type);
 void lcmbsConfParseHoldingRegsAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfValidateHoldingRegs(LCMBS_CONF_PARSER_T *parser);
+void lcmbsConfParseHoldingRangeAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseHoldingRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseHoldingBitRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseHoldingBitRegPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseInputRegsAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfValidateInputRegs(LCMBS_CONF_PARSER_T *parser);
+void lcmbsConfParseInputRegsRangeAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseInputRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseInputBitRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseInputBitRegPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseInputChgCntAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseInputChgMapAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseInputCycleCntAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfParseInputCycleTsAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseInputsAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfValidateInputs(LCMBS_CONF_PARSER_T *parser);
+void lcmbsConfParseInputsRangeAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseInputAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseCoilsAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
+void lcmbsConfValidateCoils(LCMBS_CONF_PARSER_T *parser);
+void lcmbsConfParseCoilsRangeAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 void lcmbsConfParseCoilAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr);
 
 static const LCMBS_CONF_STATE_T lcmbsConfStates[] = {
   { "modbusSlaves",	lcmbsConfTypeNone,		lcmbsConfTypeSlaves,		NULL,					NULL },
-  { "modbusSlave",	lcmbsConfTypeSlaves,		lcmbsConfTypeSlave,		lcmbsConfParseSlaveAttrs,		NULL },
+  { "modbusSlave",	lcmbsConfTypeSlaves,		lcmbsConfTypeSlave,		lcmbsConfParseSlaveAttrs,		lcmbsConfValidateSlave },
   { "tcpListener",	lcmbsConfTypeSlave,		lcmbsConfTypeTcpListener,	lcmbsConfParseTcpLsnrAttrs,		NULL },
   { "serialListener",	lcmbsConfTypeSlave,		lcmbsConfTypeSerialListener,	lcmbsConfParseSerLsnrAttrs,		NULL },
-  { "holdingRegisters",	lcmbsConfTypeSlave,		lcmbsConfTypeHoldingRegs,	lcmbsConfParseHoldingRegsAttrs,		NULL },
+  { "unixListener",	lcmbsConfTypeSlave,		lcmbsConfTypeUnixListener,	lcmbsConfParseUnixLsnrAttrs,		NULL },
+  { "udpListener",	lcmbsConfTypeSlave,		lcmbsConfTypeUdpListener,	lcmbsConfParseUdpLsnrAttrs,		NULL },
+  { "tlsListener",	lcmbsConfTypeSlave,		lcmbsConfTypeTlsListener,	lcmbsConfParseTlsLsnrAttrs,		NULL },
+  { "responseCache",	lcmbsConfTypeSlave,		lcmbsConfTypeResponseCache,	lcmbsConfParseCacheAttrs,		NULL },
+  { "readCoalescing",	lcmbsConfTypeSlave,		lcmbsConfTypeReadCoalescing,	lcmbsConfParseCoalAttrs,		NULL },
+  { "sharedMemory",	lcmbsConfTypeSlave,		lcmbsConfTypeSharedMemory,	lcmbsConfParseShmAttrs,			NULL },
+  { "realtime",		lcmbsConfTypeSlave,		lcmbsConfTypeRealtime,		lcmbsConfParseRtxAttrs,			NULL },
+  { "fifoQueues",	lcmbsConfTypeSlave,		lcmbsConfTypeFifoQueues,	lcmbsConfParseFifosAttrs,		lcmbsConfValidateFifos },
+  { "fifo",		lcmbsConfTypeFifoQueues,	lcmbsConfTypeFifoQueue,		lcmbsConfParseFifoAttrs,		NULL },
+  { "sampleCapture",	lcmbsConfTypeSlave,		lcmbsConfTypeSampleCapture,	lcmbsConfParseSampleAttrs,		lcmbsConfValidateSample },
+  { "pin",		lcmbsConfTypeSampleCapture,	lcmbsConfTypeSamplePin,		lcmbsConfParseSamplePinAttrs,		NULL },
+  { "fileTable",	lcmbsConfTypeSlave,		lcmbsConfTypeFileTable,		lcmbsConfParseTableAttrs,		NULL },
+  { "holdingRegisters",	lcmbsConfTypeSlave,		lcmbsConfTypeHoldingRegs,	lcmbsConfParseHoldingRegsAttrs,		lcmbsConfValidateHoldingRegs },
   { "pin",		lcmbsConfTypeHoldingRegs,	lcmbsConfTypeHoldingReg,	lcmbsConfParseHoldingRegAttrs,		NULL },
   { "bitRegister",	lcmbsConfTypeHoldingRegs,	lcmbsConfTypeHoldingBitReg,	lcmbsConfParseHoldingBitRegAttrs,	NULL },
   { "pin",		lcmbsConfTypeHoldingBitReg,	lcmbsConfTypeHoldingBitRegPin,	lcmbsConfParseHoldingBitRegPinAttrs,	NULL },
-  { "inputRegisters",	lcmbsConfTypeSlave,		lcmbsConfTypeInputRegs,		lcmbsConfParseInputRegsAttrs,		NULL },
+  { "range",		lcmbsConfTypeHoldingRegs,	lcmbsConfTypeHoldingRange,	lcmbsConfParseHoldingRangeAttrs,	lcmbsConfValidateRange },
+  { "pin",		lcmbsConfTypeHoldingRange,	lcmbsConfTypeHoldingRangeReg,	lcmbsConfParseHoldingRegAttrs,		NULL },
+  { "bitRegister",	lcmbsConfTypeHoldingRange,	lcmbsConfTypeHoldingRangeBitReg,	lcmbsConfParseHoldingBitRegAttrs,	NULL },
+  { "pin",		lcmbsConfTypeHoldingRangeBitReg,	lcmbsConfTypeHoldingRangeBitRegPin,	lcmbsConfParseHoldingBitRegPinAttrs,	NULL },
+  { "inputRegisters",	lcmbsConfTypeSlave,		lcmbsConfTypeInputRegs,		lcmbsConfParseInputRegsAttrs,		lcmbsConfValidateInputRegs },
   { "pin",		lcmbsConfTypeInputRegs,		lcmbsConfTypeInputReg,		lcmbsConfParseInputRegAttrs,		NULL },
   { "bitRegister",	lcmbsConfTypeInputRegs,		lcmbsConfTypeInputBitReg,	lcmbsConfParseInputBitRegAttrs,		NULL },
   { "pin",		lcmbsConfTypeInputBitReg,	lcmbsConfTypeInputBitRegPin,	lcmbsConfParseInputBitRegPinAttrs,	NULL },
-  { "inputs",		lcmbsConfTypeSlave,		lcmbsConfTypeInputs,		lcmbsConfParseInputsAttrs,		NULL },
+  { "changeCounter",	lcmbsConfTypeInputRegs,		lcmbsConfTypeInputChgCnt,	lcmbsConfParseInputChgCntAttrs,		NULL },
+  { "changeBitmap",	lcmbsConfTypeInputRegs,		lcmbsConfTypeInputChgMap,	lcmbsConfParseInputChgMapAttrs,		NULL },
+  { "cycleCounter",	lcmbsConfTypeInputRegs,		lcmbsConfTypeInputCycleCnt,	lcmbsConfParseInputCycleCntAttrs,	NULL },
+  { "cycleTimestamp",	lcmbsConfTypeInputRegs,		lcmbsConfTypeInputCycleTs,	lcmbsConfParseInputCycleTsAttrs,	NULL },
+  { "range",		lcmbsConfTypeInputRegs,		lcmbsConfTypeInputRegsRange,	lcmbsConfParseInputRegsRangeAttrs,	lcmbsConfValidateRange },
+  { "pin",		lcmbsConfTypeInputRegsRange,	lcmbsConfTypeInputRangeReg,	lcmbsConfParseInputRegAttrs,		NULL },
+  { "bitRegister",	lcmbsConfTypeInputRegsRange,	lcmbsConfTypeInputRangeBitReg,	lcmbsConfParseInputBitRegAttrs,		NULL },
+  { "pin",		lcmbsConfTypeInputRangeBitReg,	lcmbsConfTypeInputRangeBitRegPin,	lcmbsConfParseInputBitRegPinAttrs,	NULL },
+  { "changeCounter",	lcmbsConfTypeInputRegsRange,	lcmbsConfTypeInputRangeChgCnt,	lcmbsConfParseInputChgCntAttrs,		NULL },
+  { "changeBitmap",	lcmbsConfTypeInputRegsRange,	lcmbsConfTypeInputRangeChgMap,	lcmbsConfParseInputChgMapAttrs,		NULL },
+  { "cycleCounter",	lcmbsConfTypeInputRegsRange,	lcmbsConfTypeInputRangeCycleCnt,	lcmbsConfParseInputCycleCntAttrs,	NULL },
+  { "cycleTimestamp",	lcmbsConfTypeInputRegsRange,	lcmbsConfTypeInputRangeCycleTs,	lcmbsConfParseInputCycleTsAttrs,	NULL },
+  { "inputs",		lcmbsConfTypeSlave,		lcmbsConfTypeInputs,		lcmbsConfParseInputsAttrs,		lcmbsConfValidateInputs },
   { "pin",		lcmbsConfTypeInputs,		lcmbsConfTypeInput,		lcmbsConfParseInputAttrs,		NULL },
-  { "coils",		lcmbsConfTypeSlave,		lcmbsConfTypeCoils,		lcmbsConfParseCoilsAttrs,		NULL },
+  { "range",		lcmbsConfTypeInputs,		lcmbsConfTypeInputsRange,	lcmbsConfParseInputsRangeAttrs,		lcmbsConfValidateRange },
+  { "pin",		lcmbsConfTypeInputsRange,	lcmbsConfTypeInputsRangeInput,	lcmbsConfParseInputAttrs,		NULL },
+  { "coils",		lcmbsConfTypeSlave,		lcmbsConfTypeCoils,		lcmbsConfParseCoilsAttrs,		lcmbsConfValidateCoils },
   { "pin",		lcmbsConfTypeCoils,		lcmbsConfTypeCoil,		lcmbsConfParseCoilAttrs,		NULL },
+  { "range",		lcmbsConfTypeCoils,		lcmbsConfTypeCoilsRange,	lcmbsConfParseCoilsRangeAttrs,		lcmbsConfValidateRange },
+  { "pin",		lcmbsConfTypeCoilsRange,	lcmbsConfTypeCoilsRangeCoil,	lcmbsConfParseCoilAttrs,		NULL },
   { NULL }
 };
 
+// element dispatch index, start elements are hashed by state and name,
+// end elements are unique per entered state
+static pthread_once_t lcmbsConfStatesOnce = PTHREAD_ONCE_INIT;
+static const LCMBS_CONF_STATE_T *lcmbsConfStartIndex[STATE_HASH_SIZE];
+static const LCMBS_CONF_STATE_T *lcmbsConfEndIndex[lcmbsConfTypeCount];
+
 LCMBS_CONF_T *lcmbsConfParse(const char *filename) {
   int done;
   char buffer[BUFFSIZE];
@@ -129,15 +246,12 @@ LCMBS_CONF_T *lcmbsConfParse(const char *filename) {
   }
 
   // allocate config mem
-  parser.conf = calloc(1, sizeof(LCMBS_CONF_T));
+  parser.conf = lcmbsConfAlloc();
   if (!parser.conf) {
     fprintf(stderr, "%s: ERROR: Couldn't allocate memory for config\n", compName);
     goto fail1;
   }
 
-  // initialize config
-  lcmbsVectInit(&parser.conf->slaves, sizeof(LCMBS_CONF_SLAVE_T));
-
   // create xml parser
   parser.xmlParser = XML_ParserCreate(NULL);
   if (!parser.xmlParser) {
@@ -146,7 +260,9 @@ LCMBS_CONF_T *lcmbsConfParse(const char *filename) {
   }
 
   // initialize parser state
+  pthread_once(&lcmbsConfStatesOnce, lcmbsConfInitStates);
   parser.currConfType = lcmbsConfTypeNone;
+  lcmbsHsetInit(&parser.slaveNames);
   XML_SetUserData(parser.xmlParser, &parser);
 
   // setup handlers
@@ -173,10 +289,16 @@ LCMBS_CONF_T *lcmbsConfParse(const char *filename) {
     }
   }
 
+  // move slaves to arena
+  if (lcmbsConfFinish(parser.conf)) {
+    goto fail3;
+  }
+
   // result is ok now
   ret = parser.conf;
 
 fail3:
+  lcmbsHsetFree(&parser.slaveNames);
   XML_ParserFree(parser.xmlParser);
 fail2:
   if (!ret) {
@@ -188,31 +310,73 @@ fail0:
   return ret;
 }
 
+LCMBS_CONF_T *lcmbsConfAlloc(void) {
+  LCMBS_CONF_T *conf = calloc(1, sizeof(LCMBS_CONF_T));
+  if (!conf) {
+    return NULL;
+  }
+
+  lcmbsArenaInit(&conf->arena);
+  lcmbsVectInit(&conf->slaves, sizeof(LCMBS_CONF_SLAVE_T));
+  return conf;
+}
+
+int lcmbsConfFinish(LCMBS_CONF_T *conf) {
+  if (lcmbsVectMoveToArena(&conf->slaves, &conf->arena)) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for slaves\n", compName);
+    return -1;
+  }
+
+  return 0;
+}
+
 void lcmbsConfFree(LCMBS_CONF_T *conf) {
-  size_t i;
+  size_t i, j;
 
   if (!conf) {
     return;
   }
 
-  // free slaves
+  // free slaves, only data of a partially parsed
+  // config is left outside the arena
   for (i = 0; i < conf->slaves.count; i++) {
     LCMBS_CONF_SLAVE_T *slave = lcmbsVectGet(&conf->slaves, i);
     lcmbsVectFree(&slave->tcpListeners);
+    lcmbsVectFree(&slave->unixListeners);
+    lcmbsVectFree(&slave->udpListeners);
+    lcmbsVectFree(&slave->tlsListeners);
     lcmbsConfFreeRegs(&slave->holdingRegs);
     lcmbsConfFreeRegs(&slave->inputRegs);
     lcmbsConfFreeBits(&slave->inputs);
     lcmbsConfFreeBits(&slave->coils);
+    lcmbsConfFreeChg(&slave->chg);
+    lcmbsConfFreeCache(&slave->cache);
+    lcmbsConfFreeCoal(&slave->coal);
+    lcmbsVectFree(&slave->fifos.queues);
+    for (j = 0; j < slave->samples.count; j++) {
+      LCMBS_CONF_SAMPLE_T *sample = lcmbsVectGet(&slave->samples, j);
+      lcmbsVectFree(&sample->pins);
+    }
+    lcmbsVectFree(&slave->samples);
+    lcmbsVectFree(&slave->tables.tables);
   }
   lcmbsVectFree(&conf->slaves);
 
+  // free all remaining config data at once
+  lcmbsArenaFree(&conf->arena);
   free(conf);
 }
 
-void lcmbsConfInitRegs(LCMBS_CONF_REGS_T *regs) {
-  regs->start = -1;
+void lcmbsConfInitRegs(LCMBS_CONF_REGS_T *regs, LCMBS_ARENA_T *arena) {
+  regs->defined = 0;
+  regs->next = -1;
+  regs->gen = 0;
+  regs->genPins = NULL;
+  regs->genRead = NULL;
+  regs->genWrite = NULL;
   lcmbsVectInit(&regs->regs, sizeof(LCMBS_CONF_REG_T));
   lcmbsVectInit(&regs->pins, sizeof(LCMBS_CONF_REG_PIN_T));
+  lcmbsPtabInit(&regs->map, arena);
 }
 
 void lcmbsConfFreeRegs(LCMBS_CONF_REGS_T *regs) {
@@ -221,28 +385,85 @@ void lcmbsConfFreeRegs(LCMBS_CONF_REGS_T *regs) {
     LCMBS_CONF_REG_T *reg = lcmbsVectGet(&regs->regs, i);
     if (reg->bitpins != NULL) {
       lcmbsVectFree(reg->bitpins);
-      free(reg->bitpins);
     }
   }
 
   lcmbsVectFree(&regs->regs);
   lcmbsVectFree(&regs->pins);
+  lcmbsPtabFree(&regs->map);
 }
 
-void lcmbsConfInitBits(LCMBS_CONF_BITS_T *bits) {
-  bits->start = -1;
+void lcmbsConfInitBits(LCMBS_CONF_BITS_T *bits, LCMBS_ARENA_T *arena) {
+  bits->defined = 0;
+  bits->next = -1;
+  bits->gen = 0;
   lcmbsVectInit(&bits->pins, sizeof(LCMBS_CONF_BIT_PIN_T));
+  lcmbsPtabInit(&bits->map, arena);
 }
 
 void lcmbsConfFreeBits(LCMBS_CONF_BITS_T *bits) {
   lcmbsVectFree(&bits->pins);
+  lcmbsPtabFree(&bits->map);
+}
+
+void lcmbsConfInitChg(LCMBS_CONF_CHG_T *chg) {
+  memset(chg, 0, sizeof(LCMBS_CONF_CHG_T));
+  pthread_mutex_init(&chg->lock, NULL);
+}
+
+void lcmbsConfFreeChg(LCMBS_CONF_CHG_T *chg) {
+  pthread_mutex_destroy(&chg->lock);
+}
+
+void lcmbsConfInitCache(LCMBS_CONF_CACHE_T *cache) {
+  memset(cache, 0, sizeof(LCMBS_CONF_CACHE_T));
+  pthread_mutex_init(&cache->lock, NULL);
+}
+
+void lcmbsConfFreeCache(LCMBS_CONF_CACHE_T *cache) {
+  pthread_mutex_destroy(&cache->lock);
+}
+
+void lcmbsConfInitCoal(LCMBS_CONF_COAL_T *coal) {
+  memset(coal, 0, sizeof(LCMBS_CONF_COAL_T));
+  pthread_mutex_init(&coal->lock, NULL);
+}
+
+void lcmbsConfFreeCoal(LCMBS_CONF_COAL_T *coal) {
+  int i;
+
+  if (coal->slots != NULL) {
+    for (i = 0; i < coal->size; i++) {
+      pthread_cond_destroy(&coal->slots[i].cond);
+    }
+  }
+  pthread_mutex_destroy(&coal->lock);
+}
+
+void lcmbsConfInitStates(void) {
+  const LCMBS_CONF_STATE_T *state;
+  uint32_t idx;
+
+  for (state = lcmbsConfStates; state->nodeName; state++) {
+    // insert into start index (linear probing)
+    idx = lcmbsHashStr(state->nodeName, state->currState) & (STATE_HASH_SIZE - 1);
+    while (lcmbsConfStartIndex[idx] != NULL) {
+      idx = (idx + 1) & (STATE_HASH_SIZE - 1);
+    }
+    lcmbsConfStartIndex[idx] = state;
+
+    // insert into end index
+    lcmbsConfEndIndex[state->nextState] = state;
+  }
 }
 
 void lcmbsConfXmlStartHandler(void *data, const char *el, const char **attr) {
   LCMBS_CONF_PARSER_T *parser = (LCMBS_CONF_PARSER_T *) data;
-  static const LCMBS_CONF_STATE_T *state;
+  const LCMBS_CONF_STATE_T *state;
+  uint32_t idx;
 
-  for (state = lcmbsConfStates; state->nodeName; state++) {
+  idx = lcmbsHashStr(el, parser->currConfType) & (STATE_HASH_SIZE - 1);
+  for (; (state = lcmbsConfStartIndex[idx]) != NULL; idx = (idx + 1) & (STATE_HASH_SIZE - 1)) {
     // check current state
     if (parser->currConfType != state->currState) {
       continue;
@@ -270,49 +491,58 @@ void lcmbsConfXmlStartHandler(void *data, const char *el, const char **attr) {
 
 void lcmbsConfXmlEndHandler(void *data, const char *el) {
   LCMBS_CONF_PARSER_T *parser = (LCMBS_CONF_PARSER_T *) data;
-  static const LCMBS_CONF_STATE_T *state;
-
-  for (state = lcmbsConfStates; state->nodeName; state++) {
-    // check current state
-    if (parser->currConfType != state->nextState) {
-      continue;
-    }
+  const LCMBS_CONF_STATE_T *state = lcmbsConfEndIndex[parser->currConfType];
 
-    // check node name
-    if (strcmp(state->nodeName, el)) {
-      continue;
-    }
+  // check node name
+  if (state == NULL || strcmp(state->nodeName, el)) {
+    fprintf(stderr, "%s: ERROR: unexpected close tag %s found\n", compName, el);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
 
-    // set state
-    parser->currConfType = state->currState;
+  // set state
+  parser->currConfType = state->currState;
 
-    // call validator if applicable
-    if (state->validator != NULL) {
-      state->validator(parser);
-    }
+  // call validator if applicable
+  if (state->validator != NULL) {
+    state->validator(parser);
+  }
+}
 
-    return;
+LCMBS_CONF_SLAVE_T *lcmbsConfAddSlave(LCMBS_CONF_T *conf) {
+  LCMBS_CONF_SLAVE_T *slave = lcmbsVectPut(&conf->slaves);
+  if (!slave) {
+    return NULL;
   }
 
-  fprintf(stderr, "%s: ERROR: unexpected close tag %s found\n", compName, el);
-  XML_StopParser(parser->xmlParser, 0);
+  // initialize attributes
+  lcmbsVectInit(&slave->tcpListeners, sizeof(LCMBS_CONF_TCP_LSNR_T));
+  lcmbsVectInit(&slave->unixListeners, sizeof(LCMBS_CONF_UNIX_LSNR_T));
+  lcmbsVectInit(&slave->udpListeners, sizeof(LCMBS_CONF_UDP_LSNR_T));
+  lcmbsVectInit(&slave->tlsListeners, sizeof(LCMBS_CONF_TLS_LSNR_T));
+  lcmbsConfInitRegs(&slave->holdingRegs, &conf->arena);
+  lcmbsConfInitRegs(&slave->inputRegs, &conf->arena);
+  lcmbsConfInitBits(&slave->inputs, &conf->arena);
+  lcmbsConfInitBits(&slave->coils, &conf->arena);
+  lcmbsConfInitChg(&slave->chg);
+  lcmbsConfInitCache(&slave->cache);
+  lcmbsConfInitCoal(&slave->coal);
+  lcmbsVectInit(&slave->fifos.queues, sizeof(LCMBS_CONF_FIFO_T));
+  lcmbsVectInit(&slave->samples, sizeof(LCMBS_CONF_SAMPLE_T));
+  lcmbsVectInit(&slave->tables.tables, sizeof(LCMBS_CONF_TABLE_T));
+
+  return slave;
 }
 
 void lcmbsConfParseSlaveAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
   // create new slave
-  LCMBS_CONF_SLAVE_T *slave = lcmbsVectPut(&parser->conf->slaves);
+  LCMBS_CONF_SLAVE_T *slave = lcmbsConfAddSlave(parser->conf);
   if (!slave) {
     fprintf(stderr, "%s: ERROR: Couldn't allocate memory for slave\n", compName);
     XML_StopParser(parser->xmlParser, 0);
     return;
   }
-
-  // initialize attributes
-  lcmbsVectInit(&slave->tcpListeners, sizeof(LCMBS_CONF_TCP_LSNR_T));
-  lcmbsConfInitRegs(&slave->holdingRegs);
-  lcmbsConfInitRegs(&slave->inputRegs);
-  lcmbsConfInitBits(&slave->inputs);
-  lcmbsConfInitBits(&slave->coils);
+  parser->slaveArenaUsed = parser->conf->arena.used;
 
   while (*attr) {
     const char *name = *(attr++);
@@ -338,10 +568,171 @@ void lcmbsConfParseSlaveAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
     return;
   }
 
+  // check for unique name
+  switch (lcmbsHsetAdd(&parser->slaveNames, slave->name)) {
+    case 0:
+      break;
+    case 1:
+      fprintf(stderr, "%s: ERROR: Duplicate slave name %s\n", compName, slave->name);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    default:
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for slave name\n", compName);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+  }
+
   // set current slave
   parser->currSlave = slave;
 }
 
+int lcmbsConfSetupSlave(LCMBS_CONF_T *conf, LCMBS_CONF_SLAVE_T *slave) {
+  LCMBS_CONF_CHG_T *chg = &slave->chg;
+  LCMBS_CONF_CACHE_T *cache = &slave->cache;
+  LCMBS_CONF_COAL_T *coal = &slave->coal;
+  LCMBS_ARENA_T *arena = &conf->arena;
+  size_t j, k;
+  int i;
+
+  // move listeners to arena
+  if (lcmbsVectMoveToArena(&slave->tcpListeners, arena) || lcmbsVectMoveToArena(&slave->unixListeners, arena) ||
+      lcmbsVectMoveToArena(&slave->udpListeners, arena) || lcmbsVectMoveToArena(&slave->tlsListeners, arena)) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for listeners\n", compName);
+    return -1;
+  }
+
+  // move sample captures to arena
+  for (j = 0; j < slave->samples.count; j++) {
+    LCMBS_CONF_SAMPLE_T *sample = lcmbsVectGet(&slave->samples, j);
+    if (lcmbsVectMoveToArena(&sample->pins, arena)) {
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for sampleCapture pins\n", compName);
+      return -1;
+    }
+  }
+  if (lcmbsVectMoveToArena(&slave->samples, arena)) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for sampleCaptures\n", compName);
+    return -1;
+  }
+
+  // each capture owns its header file and the data files following it
+  for (j = 0; j < slave->samples.count; j++) {
+    LCMBS_CONF_SAMPLE_T *sample = lcmbsVectGet(&slave->samples, j);
+    for (k = 0; k < j; k++) {
+      LCMBS_CONF_SAMPLE_T *other = lcmbsVectGet(&slave->samples, k);
+      if (sample->file <= other->file + other->dataFiles && other->file <= sample->file + sample->dataFiles) {
+        fprintf(stderr, "%s: ERROR: sampleCapture %s files overlap %s\n", compName, sample->name, other->name);
+        return -1;
+      }
+    }
+  }
+
+  // move file tables to arena
+  if (lcmbsVectMoveToArena(&slave->tables.tables, arena)) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for fileTables\n", compName);
+    return -1;
+  }
+  pthread_mutex_init(&slave->tables.lock, NULL);
+
+  for (j = 0; j < slave->tables.tables.count; j++) {
+    LCMBS_CONF_TABLE_T *table = lcmbsVectGet(&slave->tables.tables, j);
+
+    // tables share the file numbers with the sample captures
+    for (k = 0; k < j; k++) {
+      LCMBS_CONF_TABLE_T *other = lcmbsVectGet(&slave->tables.tables, k);
+      if (table->file < other->file + other->files && other->file < table->file + table->files) {
+        fprintf(stderr, "%s: ERROR: fileTable %s files overlap %s\n", compName, table->name, other->name);
+        return -1;
+      }
+    }
+    for (k = 0; k < slave->samples.count; k++) {
+      LCMBS_CONF_SAMPLE_T *other = lcmbsVectGet(&slave->samples, k);
+      if (table->file < other->file + other->dataFiles + 1 && other->file < table->file + table->files) {
+        fprintf(stderr, "%s: ERROR: fileTable %s files overlap sampleCapture %s\n", compName, table->name, other->name);
+        return -1;
+      }
+    }
+
+    // allocate pin slots and staging records
+    table->pins = lcmbsArenaAlloc(arena, table->size * sizeof(LCMBS_CONF_TABLE_PIN_T));
+    table->staging = lcmbsArenaAlloc(arena, table->records * sizeof(uint16_t));
+    if (!table->pins || !table->staging) {
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for fileTable %s\n", compName, table->name);
+      return -1;
+    }
+    memset(table->pins, 0, table->size * sizeof(LCMBS_CONF_TABLE_PIN_T));
+    table->commits = NULL;
+    table->staged = 0;
+  }
+
+  // allocate response cache entries
+  if (cache->size > 0) {
+    cache->entries = lcmbsArenaAlloc(arena, cache->size * sizeof(LCMBS_CONF_CACHE_ENTRY_T));
+    if (!cache->entries) {
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for response cache\n", compName);
+      return -1;
+    }
+  }
+
+  // allocate read coalescing slots
+  if (coal->size > 0) {
+    coal->slots = lcmbsArenaAlloc(arena, coal->size * sizeof(LCMBS_CONF_COAL_SLOT_T));
+    if (!coal->slots) {
+      coal->size = 0;
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for read coalescing\n", compName);
+      return -1;
+    }
+    for (i = 0; i < coal->size; i++) {
+      pthread_cond_init(&coal->slots[i].cond, NULL);
+    }
+  }
+
+  // allocate change detection snapshots
+  if (chg->enabled) {
+    chg->regsSnap = lcmbsArenaAlloc(arena, (slave->inputRegs.regs.count + 1) * sizeof(uint32_t));
+    chg->bitsSnap = lcmbsArenaAlloc(arena, (slave->inputs.pins.count + 1) * sizeof(uint8_t));
+    if (!chg->regsSnap || !chg->bitsSnap) {
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for change snapshot\n", compName);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+void lcmbsConfValidateSlave(LCMBS_CONF_PARSER_T *parser) {
+  LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
+  size_t i;
+
+  // only the realtime module refreshes the image per cycle
+  for (i = 0; i < slave->inputRegs.regs.count && !slave->rtx.enabled; i++) {
+    LCMBS_CONF_REG_T *reg = lcmbsVectGet(&slave->inputRegs.regs, i);
+    if (reg->vreg == LCMBS_VREG_CYCLE || reg->vreg == LCMBS_VREG_CYCLETS) {
+      fprintf(stderr, "%s: ERROR: cycle registers of slave %s need a realtime node\n", compName, slave->name);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    }
+  }
+
+  if (lcmbsConfSetupSlave(parser->conf, slave)) {
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // account config memory of this slave
+  slave->confSize = parser->conf->arena.used - parser->slaveArenaUsed;
+}
+
+static int lcmbsConfCopyAttr(LCMBS_CONF_PARSER_T *parser, char *dst, size_t size, const char *name, const char *val, const char *type) {
+  if (strlen(val) >= size) {
+    fprintf(stderr, "%s: ERROR: %s %s %s too long\n", compName, type, name, val);
+    XML_StopParser(parser->xmlParser, 0);
+    return -1;
+  }
+
+  strcpy(dst, val);
+  return 0;
+}
+
 void lcmbsConfParseTcpLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
   // create new tcpListener
   LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
@@ -353,8 +744,15 @@ void lcmbsConfParseTcpLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr)
   }
 
   // initialize attributes
-  listener->slave = slave;
   listener->port = -1;
+  listener->rtu = 0;
+  listener->clientRate = 0;
+  listener->clientBurst = -1;
+  listener->listenerRate = 0;
+  listener->listenerBurst = -1;
+  listener->overloadDelay = 0;
+  listener->priority = LCMBS_PRIO_NORMAL;
+  listener->highPriorityClients[0] = 0;
 
   while (*attr) {
     const char *name = *(attr++);
@@ -366,6 +764,76 @@ void lcmbsConfParseTcpLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr)
       continue;
     }
 
+    // parse framing
+    if (strcmp(name, "framing") == 0) {
+      if (strcmp(val, "mbap") == 0) {
+        listener->rtu = 0;
+      } else if (strcmp(val, "rtu") == 0) {
+        listener->rtu = 1;
+      } else {
+        fprintf(stderr, "%s: ERROR: Invalid tcpListener framing %s\n", compName, val);
+        XML_StopParser(parser->xmlParser, 0);
+        return;
+      }
+      continue;
+    }
+
+    // parse request rate limits (requests per second)
+    if (strcmp(name, "clientRate") == 0) {
+      listener->clientRate = atoi(val);
+      continue;
+    }
+    if (strcmp(name, "clientBurst") == 0) {
+      listener->clientBurst = atoi(val);
+      continue;
+    }
+    if (strcmp(name, "listenerRate") == 0) {
+      listener->listenerRate = atoi(val);
+      continue;
+    }
+    if (strcmp(name, "listenerBurst") == 0) {
+      listener->listenerBurst = atoi(val);
+      continue;
+    }
+
+    // parse overload handling
+    if (strcmp(name, "overload") == 0) {
+      if (strcmp(val, "busy") == 0) {
+        listener->overloadDelay = 0;
+      } else if (strcmp(val, "delay") == 0) {
+        listener->overloadDelay = 1;
+      } else {
+        fprintf(stderr, "%s: ERROR: Invalid tcpListener overload %s\n", compName, val);
+        XML_StopParser(parser->xmlParser, 0);
+        return;
+      }
+      continue;
+    }
+
+    // parse priority class
+    if (strcmp(name, "priority") == 0) {
+      if (strcmp(val, "normal") == 0) {
+        listener->priority = LCMBS_PRIO_NORMAL;
+      } else if (strcmp(val, "high") == 0) {
+        listener->priority = LCMBS_PRIO_HIGH;
+      } else if (strcmp(val, "low") == 0) {
+        listener->priority = LCMBS_PRIO_LOW;
+      } else {
+        fprintf(stderr, "%s: ERROR: Invalid tcpListener priority %s\n", compName, val);
+        XML_StopParser(parser->xmlParser, 0);
+        return;
+      }
+      continue;
+    }
+
+    // parse client addresses served with high priority
+    if (strcmp(name, "highPriorityClients") == 0) {
+      if (lcmbsConfCopyAttr(parser, listener->highPriorityClients, LCMBS_PRIO_ADDRS_LEN, name, val, "tcpListener")) {
+        return;
+      }
+      continue;
+    }
+
     // handle error
     fprintf(stderr, "%s: ERROR: Invalid tcpListener attribute %s\n", compName, name);
     XML_StopParser(parser->xmlParser, 0);
@@ -378,6 +846,19 @@ void lcmbsConfParseTcpLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr)
     XML_StopParser(parser->xmlParser, 0);
     return;
   }
+
+  // check rate limits, bursts default to one second of requests
+  if (listener->clientRate < 0 || listener->listenerRate < 0 || listener->clientRate > 1000000 || listener->listenerRate > 1000000) {
+    fprintf(stderr, "%s: ERROR: Invalid tcpListener rate (0..1000000)\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+  if (listener->clientBurst < 0) {
+    listener->clientBurst = listener->clientRate;
+  }
+  if (listener->listenerBurst < 0) {
+    listener->listenerBurst = listener->listenerRate;
+  }
 }
 
 void lcmbsConfParseSerLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
@@ -385,120 +866,1239 @@ void lcmbsConfParseSerLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr)
   XML_StopParser(parser->xmlParser, 0);
 }
 
-void lcmbsConfParseListAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, int *start, const char *type) {
-  // check for unique node
-  if (*start >= 0) {
-    fprintf(stderr, "%s: ERROR: %s node must be unique per slave\n", compName, type);
+void lcmbsConfParseUnixLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  // create new unixListener
+  LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
+  LCMBS_CONF_UNIX_LSNR_T *listener = lcmbsVectPut(&slave->unixListeners);
+  if (!listener) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for unixListener\n", compName);
     XML_StopParser(parser->xmlParser, 0);
+    return;
   }
 
   // initialize attributes
-  *start = -1;
+  listener->seqpacket = 0;
+  listener->mode = -1;
 
   while (*attr) {
     const char *name = *(attr++);
     const char *val = *(attr++);
 
-    // parse port number
-    if (strcmp(name, "start") == 0) {
-      *start = atoi(val);
+    // parse socket path
+    if (strcmp(name, "path") == 0) {
+      if (strlen(val) >= LCMBS_UNIX_PATH_LEN) {
+        fprintf(stderr, "%s: ERROR: unixListener path %s too long\n", compName, val);
+        XML_StopParser(parser->xmlParser, 0);
+        return;
+      }
+      strcpy(listener->path, val);
+      continue;
+    }
+
+    // parse socket type
+    if (strcmp(name, "type") == 0) {
+      if (strcmp(val, "stream") == 0) {
+        listener->seqpacket = 0;
+      } else if (strcmp(val, "seqpacket") == 0) {
+        listener->seqpacket = 1;
+      } else {
+        fprintf(stderr, "%s: ERROR: Invalid unixListener type %s\n", compName, val);
+        XML_StopParser(parser->xmlParser, 0);
+        return;
+      }
+      continue;
+    }
+
+    // parse file mode
+    if (strcmp(name, "mode") == 0) {
+      listener->mode = strtol(val, NULL, 8);
       continue;
     }
 
     // handle error
-    fprintf(stderr, "%s: ERROR: Invalid %s attribute %s\n", compName, type, name);
+    fprintf(stderr, "%s: ERROR: Invalid unixListener attribute %s\n", compName, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check path
+  if (listener->path[0] == 0) {
+    fprintf(stderr, "%s: ERROR: No unixListener path given\n", compName);
     XML_StopParser(parser->xmlParser, 0);
     return;
   }
 
-  // check start number
-  if (*start < 0 || *start > 65535) {
-    fprintf(stderr, "%s: ERROR: Invalid %s start number %d\n", compName, type, *start);
+  // check file mode
+  if (listener->mode > 0777) {
+    fprintf(stderr, "%s: ERROR: Invalid unixListener mode %o\n", compName, listener->mode);
     XML_StopParser(parser->xmlParser, 0);
     return;
   }
 }
 
-void lcmbsConfParseBitPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_BITS_T *bits, const char *type) {
-  // create new pin
+void lcmbsConfParseUdpLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  // create new udpListener
   LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
-  LCMBS_CONF_BIT_PIN_T *pin = lcmbsVectPut(&bits->pins);
-  if (!pin) {
-    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s pin\n", compName, type);
+  LCMBS_CONF_UDP_LSNR_T *listener = lcmbsVectPut(&slave->udpListeners);
+  if (!listener) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for udpListener\n", compName);
     XML_StopParser(parser->xmlParser, 0);
     return;
   }
 
+  // initialize attributes
+  listener->port = -1;
+  listener->batch = LCMBS_UDP_BATCH_DEFAULT;
+
   while (*attr) {
     const char *name = *(attr++);
     const char *val = *(attr++);
 
-    // parse name
-    if (strcmp(name, "name") == 0) {
-      strncpy(pin->name, val, HAL_NAME_LEN);
-      pin->name[HAL_NAME_LEN - 1] = 0;
+    // parse port number
+    if (strcmp(name, "port") == 0) {
+      listener->port = atoi(val);
+      continue;
+    }
+
+    // parse datagrams per receive call
+    if (strcmp(name, "batch") == 0) {
+      listener->batch = atoi(val);
       continue;
     }
 
     // handle error
-    fprintf(stderr, "%s: ERROR: Invalid %s attribute %s\n", compName, type, name);
+    fprintf(stderr, "%s: ERROR: Invalid udpListener attribute %s\n", compName, name);
     XML_StopParser(parser->xmlParser, 0);
     return;
   }
 
-  // check for name
-  if (pin->name[0] == 0) {
-    fprintf(stderr, "%s: ERROR: No %s name given\n", compName, type);
+  // check port number
+  if (listener->port < 0 || listener->port > 65535) {
+    fprintf(stderr, "%s: ERROR: Invalid port number %d\n", compName, listener->port);
     XML_StopParser(parser->xmlParser, 0);
     return;
   }
 
-  // set attributes
-  slave->halSize += sizeof(hal_bit_t *);
+  // check batch size
+  if (listener->batch < 1 || listener->batch > LCMBS_UDP_BATCH_MAX) {
+    fprintf(stderr, "%s: ERROR: Invalid udpListener batch %d (1..%d)\n", compName, listener->batch, LCMBS_UDP_BATCH_MAX);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
 }
 
-void lcmbsConfParseRegPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_REGS_T *regs, const char *type) {
-  int i;
-  size_t halSize;
-
-  // create new pin
+void lcmbsConfParseTlsLsnrAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  // create new tlsListener
   LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
-  LCMBS_CONF_REG_PIN_T *pin = lcmbsVectPut(&regs->pins);
-  if (!pin) {
-    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s pin\n", compName, type);
+  LCMBS_CONF_TLS_LSNR_T *listener = lcmbsVectPut(&slave->tlsListeners);
+  if (!listener) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for tlsListener\n", compName);
     XML_StopParser(parser->xmlParser, 0);
     return;
   }
 
   // initialize attributes
-  pin->type = LCMBS_PINTYPE_INVAL;
-  pin->halType = HAL_TYPE_UNSPECIFIED;
-  pin->regCount = 0;
-  halSize = 0;
+  listener->port = 802;
+  listener->sessionCache = 1024;
+  listener->sessionTimeout = 7200;
+  listener->ktls = 1;
 
   while (*attr) {
     const char *name = *(attr++);
     const char *val = *(attr++);
 
-    // parse name
-    if (strcmp(name, "name") == 0) {
-      strncpy(pin->name, val, HAL_NAME_LEN);
-      pin->name[HAL_NAME_LEN - 1] = 0;
+    // parse port number
+    if (strcmp(name, "port") == 0) {
+      listener->port = atoi(val);
       continue;
     }
 
-    // parse type
-    if (strcmp(name, "type") == 0) {
-      if (strcmp(val, "u16") == 0) {
-        pin->type = LCMBS_PINTYPE_U16;
-        pin->halType = HAL_U32;
-        pin->regCount = 1;
-        halSize = sizeof(hal_u32_t *);
-        continue;
+    // parse certificate, key and CA file names
+    if (strcmp(name, "cert") == 0) {
+      if (lcmbsConfCopyAttr(parser, listener->cert, LCMBS_TLS_PATH_LEN, name, val, "tlsListener")) {
+        return;
       }
-      if (strcmp(val, "s16") == 0) {
-        pin->type = LCMBS_PINTYPE_S16;
-        pin->halType = HAL_S32;
+      continue;
+    }
+    if (strcmp(name, "key") == 0) {
+      if (lcmbsConfCopyAttr(parser, listener->key, LCMBS_TLS_PATH_LEN, name, val, "tlsListener")) {
+        return;
+      }
+      continue;
+    }
+    if (strcmp(name, "ca") == 0) {
+      if (lcmbsConfCopyAttr(parser, listener->ca, LCMBS_TLS_PATH_LEN, name, val, "tlsListener")) {
+        return;
+      }
+      continue;
+    }
+
+    // parse comma separated role lists
+    if (strcmp(name, "readRoles") == 0) {
+      if (lcmbsConfCopyAttr(parser, listener->readRoles, LCMBS_TLS_ROLES_LEN, name, val, "tlsListener")) {
+        return;
+      }
+      continue;
+    }
+    if (strcmp(name, "writeRoles") == 0) {
+      if (lcmbsConfCopyAttr(parser, listener->writeRoles, LCMBS_TLS_ROLES_LEN, name, val, "tlsListener")) {
+        return;
+      }
+      continue;
+    }
+
+    // parse session resumption parameters
+    if (strcmp(name, "sessionCache") == 0) {
+      listener->sessionCache = atoi(val);
+      continue;
+    }
+    if (strcmp(name, "sessionTimeout") == 0) {
+      listener->sessionTimeout = atoi(val);
+      continue;
+    }
+
+    // parse kernel TLS offload flag
+    if (strcmp(name, "ktls") == 0) {
+      listener->ktls = (strcmp(val, "true") == 0);
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid tlsListener attribute %s\n", compName, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check port number
+  if (listener->port < 0 || listener->port > 65535) {
+    fprintf(stderr, "%s: ERROR: Invalid port number %d\n", compName, listener->port);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // clients are always authenticated
+  if (listener->cert[0] == 0 || listener->key[0] == 0 || listener->ca[0] == 0) {
+    fprintf(stderr, "%s: ERROR: tlsListener needs cert, key and ca\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check session parameters
+  if (listener->sessionCache < 0 || listener->sessionTimeout < 1) {
+    fprintf(stderr, "%s: ERROR: Invalid tlsListener session parameters\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+}
+
+void lcmbsConfParseCacheAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  LCMBS_CONF_CACHE_T *cache = &parser->currSlave->cache;
+
+  // check for unique node
+  if (cache->size > 0) {
+    fprintf(stderr, "%s: ERROR: responseCache node must be unique per slave\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // initialize attributes
+  cache->size = 32;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse number of entries
+    if (strcmp(name, "entries") == 0) {
+      cache->size = atoi(val);
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid responseCache attribute %s\n", compName, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check number of entries
+  if (cache->size <= 0 || cache->size > 4096) {
+    fprintf(stderr, "%s: ERROR: Invalid responseCache entry count %d\n", compName, cache->size);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+}
+
+void lcmbsConfParseCoalAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  LCMBS_CONF_COAL_T *coal = &parser->currSlave->coal;
+
+  // check for unique node
+  if (coal->size > 0) {
+    fprintf(stderr, "%s: ERROR: readCoalescing node must be unique per slave\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // initialize attributes
+  coal->size = 16;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse number of in-flight slots
+    if (strcmp(name, "slots") == 0) {
+      coal->size = atoi(val);
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid readCoalescing attribute %s\n", compName, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check number of slots
+  if (coal->size <= 0 || coal->size > 1024) {
+    fprintf(stderr, "%s: ERROR: Invalid readCoalescing slot count %d\n", compName, coal->size);
+    coal->size = 0;
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+}
+
+void lcmbsConfParseShmAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
+  LCMBS_CONF_SHM_T *shm = &slave->shm;
+  const char *shmName = NULL;
+
+  // check for unique node
+  if (shm->enabled) {
+    fprintf(stderr, "%s: ERROR: sharedMemory node must be unique per slave\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // initialize attributes
+  shm->enabled = 1;
+  shm->period = 10;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse segment name
+    if (strcmp(name, "name") == 0) {
+      shmName = val;
+      continue;
+    }
+
+    // parse update period
+    if (strcmp(name, "period") == 0) {
+      shm->period = atoi(val);
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid sharedMemory attribute %s\n", compName, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // segment names default to the slave name
+  if (shmName == NULL) {
+    snprintf(shm->name, LCMBS_SHM_NAME_LEN, "/%s.%s", compName, slave->name);
+  } else {
+    // POSIX names are a single component with leading slash
+    const char *p = (shmName[0] == '/') ? shmName + 1 : shmName;
+    if (p[0] == 0 || strchr(p, '/') != NULL || snprintf(shm->name, LCMBS_SHM_NAME_LEN, "/%s", p) >= LCMBS_SHM_NAME_LEN) {
+      fprintf(stderr, "%s: ERROR: Invalid sharedMemory name %s\n", compName, shmName);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    }
+  }
+
+  // check update period
+  if (shm->period <= 0 || shm->period > 60000) {
+    fprintf(stderr, "%s: ERROR: Invalid sharedMemory period %d\n", compName, shm->period);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+}
+
+void lcmbsConfParseRtxAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
+  LCMBS_CONF_RTX_T *rtx = &slave->rtx;
+  int i, count = 0;
+  char *end;
+
+  // check for unique node
+  if (rtx->enabled) {
+    fprintf(stderr, "%s: ERROR: realtime node must be unique per slave\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // initialize attributes, default keys follow the slave order
+  rtx->enabled = 1;
+  rtx->key = LCMBS_RTX_KEY_DEFAULT + 2 * (parser->conf->slaves.count - 1);
+  rtx->queueSize = LCMBS_RTX_QUEUE_DEFAULT;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse shared memory key
+    if (strcmp(name, "key") == 0) {
+      rtx->key = strtol(val, &end, 0);
+      if (*end != 0) {
+        rtx->key = 0;
+      }
+      continue;
+    }
+
+    // parse write queue size
+    if (strcmp(name, "queueSize") == 0) {
+      rtx->queueSize = atoi(val);
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid realtime attribute %s\n", compName, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // the data segment uses the next key
+  if (rtx->key <= 0 || rtx->key == INT_MAX) {
+    fprintf(stderr, "%s: ERROR: Invalid realtime key\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // queue counters wrap with a power of two
+  if (rtx->queueSize <= 0 || rtx->queueSize > LCMBS_RTX_QUEUE_MAX || (rtx->queueSize & (rtx->queueSize - 1)) != 0) {
+    fprintf(stderr, "%s: ERROR: Invalid realtime queueSize %d\n", compName, rtx->queueSize);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check key collisions and the module slave limit
+  for (i = 0; i < parser->conf->slaves.count; i++) {
+    LCMBS_CONF_SLAVE_T *other = lcmbsVectGet(&parser->conf->slaves, i);
+    if (other == slave || !other->rtx.enabled) {
+      continue;
+    }
+    if (other->rtx.key >= rtx->key - 1 && other->rtx.key <= rtx->key + 1) {
+      fprintf(stderr, "%s: ERROR: realtime keys of slaves %s and %s overlap\n", compName, other->name, slave->name);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    }
+    count++;
+  }
+  if (count >= LCMBS_RTX_SLAVES_MAX) {
+    fprintf(stderr, "%s: ERROR: More than %d realtime slaves\n", compName, LCMBS_RTX_SLAVES_MAX);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+}
+
+void lcmbsConfParseFifosAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  LCMBS_CONF_FIFOS_T *fifos = &parser->currSlave->fifos;
+
+  // check for unique node
+  if (fifos->defined) {
+    fprintf(stderr, "%s: ERROR: fifoQueues node must be unique per slave\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // initialize attributes
+  fifos->defined = 1;
+  fifos->period = 1;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse sample period
+    if (strcmp(name, "period") == 0) {
+      fifos->period = atoi(val);
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid fifoQueues attribute %s\n", compName, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check sample period
+  if (fifos->period <= 0 || fifos->period > 60000) {
+    fprintf(stderr, "%s: ERROR: Invalid fifoQueues period %d\n", compName, fifos->period);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+}
+
+void lcmbsConfValidateFifos(LCMBS_CONF_PARSER_T *parser) {
+  if (lcmbsConfCompileFifos(parser->conf, &parser->currSlave->fifos)) {
+    XML_StopParser(parser->xmlParser, 0);
+  }
+}
+
+static int lcmbsConfCheckSubPinName(LCMBS_CONF_PARSER_T *parser, const char *base, const char *suffix) {
+  char name[HAL_NAME_LEN];
+
+  // only the length, duplicate names are found when the pins are exported
+  if (snprintf(name, HAL_NAME_LEN, "%s.%s", base, suffix) >= HAL_NAME_LEN) {
+    fprintf(stderr, "%s: ERROR: pin name %s.%s too long\n", compName, base, suffix);
+    XML_StopParser(parser->xmlParser, 0);
+    return -1;
+  }
+
+  return 0;
+}
+
+void lcmbsConfParseFifoAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  // create new fifo
+  LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
+  LCMBS_CONF_FIFO_T *fifo = lcmbsVectPut(&slave->fifos.queues);
+  if (!fifo) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for fifo\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // initialize attributes
+  fifo->addr = -1;
+  fifo->type = LCMBS_PINTYPE_U16;
+  fifo->halType = HAL_U32;
+  fifo->size = 64;
+  fifo->event = -1;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse fifo pointer address
+    if (strcmp(name, "addr") == 0) {
+      fifo->addr = atoi(val);
+      if (fifo->addr < 0 || fifo->addr > 65535) {
+        fprintf(stderr, "%s: ERROR: Invalid fifo address %d\n", compName, fifo->addr);
+        XML_StopParser(parser->xmlParser, 0);
+        return;
+      }
+      continue;
+    }
+
+    // parse name
+    if (strcmp(name, "name") == 0) {
+      strncpy(fifo->name, val, HAL_NAME_LEN);
+      fifo->name[HAL_NAME_LEN - 1] = 0;
+      continue;
+    }
+
+    // parse type, queue entries are single registers
+    if (strcmp(name, "type") == 0) {
+      if (strcmp(val, "u16") == 0) {
+        fifo->type = LCMBS_PINTYPE_U16;
+        fifo->halType = HAL_U32;
+        continue;
+      }
+      if (strcmp(val, "s16") == 0) {
+        fifo->type = LCMBS_PINTYPE_S16;
+        fifo->halType = HAL_S32;
+        continue;
+      }
+      fprintf(stderr, "%s: ERROR: Invalid fifo data type %s\n", compName, val);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    }
+
+    // parse queue size
+    if (strcmp(name, "size") == 0) {
+      fifo->size = atoi(val);
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid fifo attribute %s\n", compName, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check for address and name
+  if (fifo->addr < 0) {
+    fprintf(stderr, "%s: ERROR: No fifo address given\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+  if (fifo->name[0] == 0) {
+    fprintf(stderr, "%s: ERROR: No fifo name given\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+  if (lcmbsConfCheckSubPinName(parser, fifo->name, "value") || lcmbsConfCheckSubPinName(parser, fifo->name, "strobe") ||
+      lcmbsConfCheckSubPinName(parser, fifo->name, "count") || lcmbsConfCheckSubPinName(parser, fifo->name, "overruns")) {
+    return;
+  }
+
+  // check queue size
+  if (fifo->size <= 0 || fifo->size > LCMBS_FIFO_SIZE_MAX) {
+    fprintf(stderr, "%s: ERROR: Invalid fifo size %d\n", compName, fifo->size);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // set attributes
+  slave->halSize += sizeof(hal_u32_t *) + sizeof(hal_bit_t *) + 2 * sizeof(hal_u32_t *);
+}
+
+int lcmbsConfCompileFifos(LCMBS_CONF_T *conf, LCMBS_CONF_FIFOS_T *fifos) {
+  size_t i, j;
+
+  // move final table to arena
+  if (lcmbsVectMoveToArena(&fifos->queues, &conf->arena)) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for fifoQueues\n", compName);
+    return -1;
+  }
+
+  // few queues per slave, requests search them linearly
+  for (i = 0; i < fifos->queues.count; i++) {
+    LCMBS_CONF_FIFO_T *fifo = lcmbsVectGet(&fifos->queues, i);
+    for (j = 0; j < i; j++) {
+      LCMBS_CONF_FIFO_T *other = lcmbsVectGet(&fifos->queues, j);
+      if (other->addr == fifo->addr) {
+        fprintf(stderr, "%s: ERROR: Duplicate fifo address %d\n", compName, fifo->addr);
+        return -1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+void lcmbsConfParseSampleAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  // create new sample capture
+  LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
+  LCMBS_CONF_SAMPLE_T *sample = lcmbsVectPut(&slave->samples);
+  if (!sample) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for sampleCapture\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+  parser->currSample = sample;
+
+  // initialize attributes
+  lcmbsVectInit(&sample->pins, sizeof(LCMBS_CONF_SAMPLE_PIN_T));
+  sample->file = -1;
+  sample->mode = LCMBS_SAMPLE_CONTINUOUS;
+  sample->period = 1000;
+  sample->slots = 1000;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse name
+    if (strcmp(name, "name") == 0) {
+      if (lcmbsConfCopyAttr(parser, sample->name, HAL_NAME_LEN, name, val, "sampleCapture")) {
+        return;
+      }
+      continue;
+    }
+
+    // parse header file number
+    if (strcmp(name, "file") == 0) {
+      sample->file = atoi(val);
+      continue;
+    }
+
+    // parse mode
+    if (strcmp(name, "mode") == 0) {
+      if (strcmp(val, "continuous") == 0) {
+        sample->mode = LCMBS_SAMPLE_CONTINUOUS;
+        continue;
+      }
+      if (strcmp(val, "triggered") == 0) {
+        sample->mode = LCMBS_SAMPLE_TRIGGERED;
+        continue;
+      }
+      fprintf(stderr, "%s: ERROR: Invalid sampleCapture mode %s\n", compName, val);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    }
+
+    // parse sample period in microseconds
+    if (strcmp(name, "period") == 0) {
+      sample->period = atoi(val);
+      continue;
+    }
+
+    // parse number of samples kept
+    if (strcmp(name, "samples") == 0) {
+      sample->slots = atoi(val);
+      continue;
+    }
+
+    // parse samples kept before the trigger
+    if (strcmp(name, "pretrigger") == 0) {
+      sample->pretrigger = atoi(val);
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid sampleCapture attribute %s\n", compName, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check for name
+  if (sample->name[0] == 0) {
+    fprintf(stderr, "%s: ERROR: No sampleCapture name given\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check attribute ranges
+  if (sample->file < 1 || sample->file > 65534) {
+    fprintf(stderr, "%s: ERROR: Invalid sampleCapture file number %d\n", compName, sample->file);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+  if (sample->period < 100 || sample->period > 1000000) {
+    fprintf(stderr, "%s: ERROR: Invalid sampleCapture period %d\n", compName, sample->period);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+  if (sample->slots <= 0 || sample->slots > LCMBS_SAMPLE_SLOTS_MAX) {
+    fprintf(stderr, "%s: ERROR: Invalid sampleCapture sample count %d\n", compName, sample->slots);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+  if (sample->pretrigger < 0 || sample->pretrigger >= sample->slots) {
+    fprintf(stderr, "%s: ERROR: Invalid sampleCapture pretrigger %d\n", compName, sample->pretrigger);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // triggered captures are controlled by pins
+  if (sample->mode == LCMBS_SAMPLE_TRIGGERED) {
+    if (lcmbsConfCheckSubPinName(parser, sample->name, "trigger") || lcmbsConfCheckSubPinName(parser, sample->name, "arm")) {
+      return;
+    }
+    slave->halSize += 2 * sizeof(hal_bit_t *);
+  }
+}
+
+void lcmbsConfValidateSample(LCMBS_CONF_PARSER_T *parser) {
+  LCMBS_CONF_SAMPLE_T *sample = parser->currSample;
+  size_t i;
+
+  // check for pins
+  if (sample->pins.count == 0) {
+    fprintf(stderr, "%s: ERROR: sampleCapture %s has no pins\n", compName, sample->name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // one frame of registers per sample
+  sample->frameRegs = 0;
+  for (i = 0; i < sample->pins.count; i++) {
+    LCMBS_CONF_SAMPLE_PIN_T *pin = lcmbsVectGet(&sample->pins, i);
+    sample->frameRegs += pin->regCount;
+  }
+
+  // data files follow the header file
+  sample->dataFiles = ((size_t) sample->slots * sample->frameRegs + LCMBS_SAMPLE_FILE_RECORDS - 1) / LCMBS_SAMPLE_FILE_RECORDS;
+  if (sample->file + sample->dataFiles > 65535) {
+    fprintf(stderr, "%s: ERROR: sampleCapture %s data files exceed file numbers\n", compName, sample->name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+}
+
+void lcmbsConfParseSamplePinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  LCMBS_CONF_SAMPLE_T *sample = parser->currSample;
+  const char *pinName = NULL;
+
+  // check pin count
+  if (sample->pins.count >= LCMBS_SAMPLE_PINS_MAX) {
+    fprintf(stderr, "%s: ERROR: sampleCapture %s has more than %d pins\n", compName, sample->name, LCMBS_SAMPLE_PINS_MAX);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // create new pin
+  LCMBS_CONF_SAMPLE_PIN_T *pin = lcmbsVectPut(&sample->pins);
+  if (!pin) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for sampleCapture pin\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // initialize attributes
+  pin->type = LCMBS_PINTYPE_INVAL;
+  pin->halType = HAL_TYPE_UNSPECIFIED;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse name
+    if (strcmp(name, "name") == 0) {
+      pinName = val;
+      continue;
+    }
+
+    // parse type
+    if (strcmp(name, "type") == 0) {
+      if (strcmp(val, "bit") == 0) {
+        pin->type = LCMBS_PINTYPE_BIT;
+        pin->halType = HAL_BIT;
+        pin->regCount = 1;
+        continue;
+      }
+      if (strcmp(val, "u16") == 0) {
+        pin->type = LCMBS_PINTYPE_U16;
+        pin->halType = HAL_U32;
+        pin->regCount = 1;
+        continue;
+      }
+      if (strcmp(val, "s16") == 0) {
+        pin->type = LCMBS_PINTYPE_S16;
+        pin->halType = HAL_S32;
+        pin->regCount = 1;
+        continue;
+      }
+      if (strcmp(val, "u32") == 0) {
+        pin->type = LCMBS_PINTYPE_U32;
+        pin->halType = HAL_U32;
+        pin->regCount = 2;
+        continue;
+      }
+      if (strcmp(val, "s32") == 0) {
+        pin->type = LCMBS_PINTYPE_S32;
+        pin->halType = HAL_S32;
+        pin->regCount = 2;
+        continue;
+      }
+      if (strcmp(val, "float") == 0) {
+        pin->type = LCMBS_PINTYPE_FLOAT;
+        pin->halType = HAL_FLOAT;
+        pin->regCount = 2;
+        continue;
+      }
+      fprintf(stderr, "%s: ERROR: Invalid sampleCapture data type %s\n", compName, val);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid sampleCapture pin attribute %s\n", compName, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check for name, pins are named below the capture
+  if (pinName == NULL || pinName[0] == 0) {
+    fprintf(stderr, "%s: ERROR: No sampleCapture pin name given\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+  if (snprintf(pin->name, HAL_NAME_LEN, "%s.%s", sample->name, pinName) >= HAL_NAME_LEN) {
+    fprintf(stderr, "%s: ERROR: sampleCapture pin name %s.%s too long\n", compName, sample->name, pinName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check for type
+  if (pin->type == LCMBS_PINTYPE_INVAL) {
+    fprintf(stderr, "%s: ERROR: No data type given\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // set attributes
+  parser->currSlave->halSize += sizeof(void *);
+}
+
+void lcmbsConfParseTableAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  // create new file table
+  LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
+  LCMBS_CONF_TABLE_T *table = lcmbsVectPut(&slave->tables.tables);
+  char suffix[16];
+  int i;
+
+  if (!table) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for fileTable\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // initialize attributes
+  table->file = -1;
+  table->type = LCMBS_PINTYPE_U16;
+  table->halType = HAL_U32;
+  table->regCount = 1;
+  table->commit = LCMBS_TABLE_COMMIT_REQUEST;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse name
+    if (strcmp(name, "name") == 0) {
+      if (lcmbsConfCopyAttr(parser, table->name, HAL_NAME_LEN, name, val, "fileTable")) {
+        return;
+      }
+      continue;
+    }
+
+    // parse file number
+    if (strcmp(name, "file") == 0) {
+      table->file = atoi(val);
+      continue;
+    }
+
+    // parse type
+    if (strcmp(name, "type") == 0) {
+      if (strcmp(val, "u16") == 0) {
+        table->type = LCMBS_PINTYPE_U16;
+        table->halType = HAL_U32;
+        table->regCount = 1;
+        continue;
+      }
+      if (strcmp(val, "s16") == 0) {
+        table->type = LCMBS_PINTYPE_S16;
+        table->halType = HAL_S32;
+        table->regCount = 1;
+        continue;
+      }
+      if (strcmp(val, "u32") == 0) {
+        table->type = LCMBS_PINTYPE_U32;
+        table->halType = HAL_U32;
+        table->regCount = 2;
+        continue;
+      }
+      if (strcmp(val, "s32") == 0) {
+        table->type = LCMBS_PINTYPE_S32;
+        table->halType = HAL_S32;
+        table->regCount = 2;
+        continue;
+      }
+      if (strcmp(val, "float") == 0) {
+        table->type = LCMBS_PINTYPE_FLOAT;
+        table->halType = HAL_FLOAT;
+        table->regCount = 2;
+        continue;
+      }
+      fprintf(stderr, "%s: ERROR: Invalid fileTable data type %s\n", compName, val);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    }
+
+    // parse number of entries
+    if (strcmp(name, "size") == 0) {
+      table->size = atoi(val);
+      continue;
+    }
+
+    // parse commit mode
+    if (strcmp(name, "commit") == 0) {
+      if (strcmp(val, "request") == 0) {
+        table->commit = LCMBS_TABLE_COMMIT_REQUEST;
+        continue;
+      }
+      if (strcmp(val, "explicit") == 0) {
+        table->commit = LCMBS_TABLE_COMMIT_EXPLICIT;
+        continue;
+      }
+      fprintf(stderr, "%s: ERROR: Invalid fileTable commit mode %s\n", compName, val);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid fileTable attribute %s\n", compName, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check for name
+  if (table->name[0] == 0) {
+    fprintf(stderr, "%s: ERROR: No fileTable name given\n", compName);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check attribute ranges, explicit commits use the following file
+  table->files = (table->commit == LCMBS_TABLE_COMMIT_EXPLICIT) ? 2 : 1;
+  if (table->file < 1 || table->file + table->files > 65536) {
+    fprintf(stderr, "%s: ERROR: Invalid fileTable file number %d\n", compName, table->file);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+  if (table->size <= 0 || table->size * table->regCount > LCMBS_TABLE_RECORDS_MAX) {
+    fprintf(stderr, "%s: ERROR: Invalid fileTable size %d\n", compName, table->size);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+  table->records = table->size * table->regCount;
+
+  // one pin per entry and the commit counter
+  for (i = 0; i < table->size; i++) {
+    snprintf(suffix, sizeof(suffix), "%d", i);
+    if (lcmbsConfCheckSubPinName(parser, table->name, suffix)) {
+      return;
+    }
+  }
+  if (lcmbsConfCheckSubPinName(parser, table->name, "commits")) {
+    return;
+  }
+  slave->halSize += (table->size + 1) * sizeof(void *);
+}
+
+int lcmbsConfAllocAddr(LCMBS_CONF_PARSER_T *parser, int *next, int count, const char *type) {
+  int addr = *next;
+
+  // check for start address
+  if (addr < 0) {
+    fprintf(stderr, "%s: ERROR: No start address given for %s\n", compName, type);
+    XML_StopParser(parser->xmlParser, 0);
+    return -1;
+  }
+
+  // check address space
+  if ((addr + count) > 65536) {
+    fprintf(stderr, "%s: ERROR: %s address %d exceeds address space\n", compName, type, addr + count - 1);
+    XML_StopParser(parser->xmlParser, 0);
+    return -1;
+  }
+
+  *next += count;
+  return addr;
+}
+
+int lcmbsConfCompileRegs(LCMBS_CONF_T *conf, LCMBS_CONF_REGS_T *regs, const char *type) {
+  LCMBS_CONF_REG_PIN_T *pin = NULL;
+  LCMBS_ARENA_T *arena = &conf->arena;
+  size_t i, pinIdx = 0;
+
+  // move final tables to arena
+  if (lcmbsVectMoveToArena(&regs->regs, arena) || lcmbsVectMoveToArena(&regs->pins, arena)) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s\n", compName, type);
+    return -1;
+  }
+
+  for (i = 0; i < regs->regs.count; i++) {
+    LCMBS_CONF_REG_T *reg = lcmbsVectGet(&regs->regs, i);
+
+    // move bit pins to arena
+    if (reg->bitpins != NULL && lcmbsVectMoveToArena(reg->bitpins, arena)) {
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s bitpins\n", compName, type);
+      return -1;
+    }
+
+    // resolve pin pointers (pins vector has been moved)
+    if (reg->pin != NULL) {
+      if (reg->index == 0) {
+        pin = lcmbsVectGet(&regs->pins, pinIdx++);
+      }
+      reg->pin = pin;
+    }
+
+    // map register address
+    if (lcmbsPtabGet(&regs->map, reg->addr) != NULL) {
+      fprintf(stderr, "%s: ERROR: Duplicate %s address %d\n", compName, type, reg->addr);
+      return -1;
+    }
+    if (lcmbsPtabSet(&regs->map, reg->addr, reg)) {
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s address map\n", compName, type);
+      return -1;
+    }
+  }
+
+  // end of the contiguous run each register belongs to, so a request
+  // range is checked with one comparison, every register is walked once
+  for (i = 0; i < regs->regs.count; i++) {
+    LCMBS_CONF_REG_T *reg = lcmbsVectGet(&regs->regs, i);
+    LCMBS_CONF_REG_T *next;
+    int addr, end;
+
+    if (reg->runEnd > 0) {
+      continue;
+    }
+    for (addr = reg->addr + 1; (next = lcmbsPtabGet(&regs->map, addr)) != NULL && next->runEnd == 0; addr++);
+    end = (next != NULL) ? next->runEnd : addr;
+    while (--addr >= reg->addr) {
+      next = lcmbsPtabGet(&regs->map, addr);
+      next->runEnd = end;
+    }
+  }
+
+  return 0;
+}
+
+int lcmbsConfCompileBits(LCMBS_CONF_T *conf, LCMBS_CONF_BITS_T *bits, const char *type) {
+  size_t i;
+
+  // move final table to arena
+  if (lcmbsVectMoveToArena(&bits->pins, &conf->arena)) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s\n", compName, type);
+    return -1;
+  }
+
+  for (i = 0; i < bits->pins.count; i++) {
+    LCMBS_CONF_BIT_PIN_T *pin = lcmbsVectGet(&bits->pins, i);
+
+    // map bit address
+    if (lcmbsPtabGet(&bits->map, pin->addr) != NULL) {
+      fprintf(stderr, "%s: ERROR: Duplicate %s address %d\n", compName, type, pin->addr);
+      return -1;
+    }
+    if (lcmbsPtabSet(&bits->map, pin->addr, pin)) {
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s address map\n", compName, type);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+void lcmbsConfParseListAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, int *defined, int *next, const char *type) {
+  // check for unique node
+  if (*defined) {
+    fprintf(stderr, "%s: ERROR: %s node must be unique per slave\n", compName, type);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+  *defined = 1;
+
+  // start address is optional if ranges are used
+  lcmbsConfParseRangeAttrs(parser, attr, next, type);
+}
+
+void lcmbsConfParseRangeAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, int *next, const char *type) {
+  int start = -1;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse start address
+    if (strcmp(name, "start") == 0) {
+      start = atoi(val);
+      if (start < 0 || start > 65535) {
+        fprintf(stderr, "%s: ERROR: Invalid %s start number %d\n", compName, type, start);
+        XML_StopParser(parser->xmlParser, 0);
+        return;
+      }
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid %s attribute %s\n", compName, type, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // entries following the range continue at the list address
+  parser->rangeNext = next;
+  parser->rangeNextSaved = *next;
+  *next = start;
+}
+
+void lcmbsConfValidateRange(LCMBS_CONF_PARSER_T *parser) {
+  *parser->rangeNext = parser->rangeNextSaved;
+}
+
+void lcmbsConfParseBitPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_BITS_T *bits, const char *type) {
+  // create new pin
+  LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
+  LCMBS_CONF_BIT_PIN_T *pin = lcmbsVectPut(&bits->pins);
+  if (!pin) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s pin\n", compName, type);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse name
+    if (strcmp(name, "name") == 0) {
+      strncpy(pin->name, val, HAL_NAME_LEN);
+      pin->name[HAL_NAME_LEN - 1] = 0;
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid %s attribute %s\n", compName, type, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check for name
+  if (pin->name[0] == 0) {
+    fprintf(stderr, "%s: ERROR: No %s name given\n", compName, type);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // assign address
+  pin->addr = lcmbsConfAllocAddr(parser, &bits->next, 1, type);
+  if (pin->addr < 0) {
+    return;
+  }
+
+  // set attributes
+  slave->halSize += sizeof(hal_bit_t *);
+}
+
+void lcmbsConfParseRegPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_REGS_T *regs, const char *type) {
+  int i, addr;
+  size_t halSize;
+
+  // create new pin
+  LCMBS_CONF_SLAVE_T *slave = parser->currSlave;
+  LCMBS_CONF_REG_PIN_T *pin = lcmbsVectPut(&regs->pins);
+  if (!pin) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s pin\n", compName, type);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // initialize attributes
+  pin->type = LCMBS_PINTYPE_INVAL;
+  pin->halType = HAL_TYPE_UNSPECIFIED;
+  pin->regCount = 0;
+  halSize = 0;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse name
+    if (strcmp(name, "name") == 0) {
+      strncpy(pin->name, val, HAL_NAME_LEN);
+      pin->name[HAL_NAME_LEN - 1] = 0;
+      continue;
+    }
+
+    // parse type
+    if (strcmp(name, "type") == 0) {
+      if (strcmp(val, "u16") == 0) {
+        pin->type = LCMBS_PINTYPE_U16;
+        pin->halType = HAL_U32;
+        pin->regCount = 1;
+        halSize = sizeof(hal_u32_t *);
+        continue;
+      }
+      if (strcmp(val, "s16") == 0) {
+        pin->type = LCMBS_PINTYPE_S16;
+        pin->halType = HAL_S32;
         pin->regCount = 1;
         halSize = sizeof(hal_s32_t *);
         continue;
@@ -569,6 +2169,12 @@ void lcmbsConfParseRegPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, L
     return;
   }
 
+  // assign addresses
+  addr = lcmbsConfAllocAddr(parser, &regs->next, pin->regCount, type);
+  if (addr < 0) {
+    return;
+  }
+
   // set attributes
   slave->halSize += halSize;
 
@@ -583,15 +2189,22 @@ void lcmbsConfParseRegPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, L
     }
 
     // set attributes
+    reg->addr = addr + i;
     reg->index = i;
     reg->pin = pin;
     reg->bitpins = NULL;
+    reg->vreg = LCMBS_VREG_NONE;
   }
 }
 
 void lcmbsConfParseBitRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_REGS_T *regs, const char *type) {
-  LCMBS_CONF_REG_T *reg = lcmbsVectPut(&regs->regs);
+  // assign address
+  int addr = lcmbsConfAllocAddr(parser, &regs->next, 1, type);
+  if (addr < 0) {
+    return;
+  }
 
+  LCMBS_CONF_REG_T *reg = lcmbsVectPut(&regs->regs);
   if (!reg) {
     fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s\n", compName, type);
     XML_StopParser(parser->xmlParser, 0);
@@ -599,9 +2212,11 @@ void lcmbsConfParseBitRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, L
   }
 
   // set attributes
+  reg->addr = addr;
   reg->pin = NULL;
   reg->index = 0;
-  reg->bitpins = malloc(sizeof(LCMBS_VECT_T));
+  reg->vreg = LCMBS_VREG_NONE;
+  reg->bitpins = lcmbsArenaAlloc(&parser->conf->arena, sizeof(LCMBS_VECT_T));
   if (!reg->bitpins) {
     fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s\n bitpin vector", compName, type);
     XML_StopParser(parser->xmlParser, 0);
@@ -661,8 +2276,133 @@ void lcmbsConfParseBitRegPinAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr
   slave->halSize += sizeof(hal_bit_t *);
 }
 
+void lcmbsConfParseChgRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_REGS_T *regs, int vreg, const char *type) {
+  LCMBS_CONF_CHG_T *chg = &parser->currSlave->chg;
+  int *blockSize = NULL;
+  int size = LCMBS_CHG_BLOCKS;
+
+  while (*attr) {
+    const char *name = *(attr++);
+    const char *val = *(attr++);
+
+    // parse covered table (bitmap only)
+    if (vreg != LCMBS_VREG_CHGCNT && strcmp(name, "table") == 0) {
+      if (strcmp(val, "inputRegisters") == 0) {
+        vreg = LCMBS_VREG_CHGREGS;
+        continue;
+      }
+      if (strcmp(val, "inputs") == 0) {
+        vreg = LCMBS_VREG_CHGBITS;
+        continue;
+      }
+      fprintf(stderr, "%s: ERROR: Invalid %s table %s\n", compName, type, val);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    }
+
+    // parse block size (bitmap only)
+    if (vreg != LCMBS_VREG_CHGCNT && strcmp(name, "blockSize") == 0) {
+      size = atoi(val);
+      if (size <= 0 || size > 65535) {
+        fprintf(stderr, "%s: ERROR: Invalid %s block size %d\n", compName, type, size);
+        XML_StopParser(parser->xmlParser, 0);
+        return;
+      }
+      continue;
+    }
+
+    // handle error
+    fprintf(stderr, "%s: ERROR: Invalid %s attribute %s\n", compName, type, name);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // check for consistent block size
+  switch (vreg) {
+    case LCMBS_VREG_CHGREGS:
+      blockSize = &chg->regsBlockSize;
+      break;
+    case LCMBS_VREG_CHGBITS:
+      blockSize = &chg->bitsBlockSize;
+      break;
+  }
+  if (blockSize != NULL) {
+    if (*blockSize > 0 && *blockSize != size) {
+      fprintf(stderr, "%s: ERROR: Conflicting %s block sizes %d and %d\n", compName, type, *blockSize, size);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    }
+    *blockSize = size;
+  }
+
+  // assign address
+  int addr = lcmbsConfAllocAddr(parser, &regs->next, 1, type);
+  if (addr < 0) {
+    return;
+  }
+
+  // create virtual register
+  LCMBS_CONF_REG_T *reg = lcmbsVectPut(&regs->regs);
+  if (!reg) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s\n", compName, type);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // set attributes
+  reg->addr = addr;
+  reg->pin = NULL;
+  reg->index = 0;
+  reg->bitpins = NULL;
+  reg->vreg = vreg;
+
+  chg->enabled = 1;
+}
+
+void lcmbsConfParseCycleRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr, LCMBS_CONF_REGS_T *regs, int vreg, int count, const char *type) {
+  int i;
+
+  // no attributes
+  if (*attr) {
+    fprintf(stderr, "%s: ERROR: Invalid %s attribute %s\n", compName, type, *attr);
+    XML_StopParser(parser->xmlParser, 0);
+    return;
+  }
+
+  // assign address
+  int addr = lcmbsConfAllocAddr(parser, &regs->next, count, type);
+  if (addr < 0) {
+    return;
+  }
+
+  // create virtual registers, high word first
+  for (i = 0; i < count; i++) {
+    LCMBS_CONF_REG_T *reg = lcmbsVectPut(&regs->regs);
+    if (!reg) {
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s\n", compName, type);
+      XML_StopParser(parser->xmlParser, 0);
+      return;
+    }
+    reg->addr = addr + i;
+    reg->pin = NULL;
+    reg->index = i;
+    reg->bitpins = NULL;
+    reg->vreg = vreg;
+  }
+}
+
 void lcmbsConfParseHoldingRegsAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
-  lcmbsConfParseListAttrs(parser, attr, &parser->currSlave->holdingRegs.start, "holdingRegisters");
+  lcmbsConfParseListAttrs(parser, attr, &parser->currSlave->holdingRegs.defined, &parser->currSlave->holdingRegs.next, "holdingRegisters");
+}
+
+void lcmbsConfValidateHoldingRegs(LCMBS_CONF_PARSER_T *parser) {
+  if (lcmbsConfCompileRegs(parser->conf, &parser->currSlave->holdingRegs, "holdingRegisters")) {
+    XML_StopParser(parser->xmlParser, 0);
+  }
+}
+
+void lcmbsConfParseHoldingRangeAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  lcmbsConfParseRangeAttrs(parser, attr, &parser->currSlave->holdingRegs.next, "holdingRegisters range");
 }
 
 void lcmbsConfParseHoldingRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
@@ -678,7 +2418,17 @@ void lcmbsConfParseHoldingBitRegPinAttrs(LCMBS_CONF_PARSER_T *parser, const char
 }
 
 void lcmbsConfParseInputRegsAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
-  lcmbsConfParseListAttrs(parser, attr, &parser->currSlave->inputRegs.start, "inputRegisters");
+  lcmbsConfParseListAttrs(parser, attr, &parser->currSlave->inputRegs.defined, &parser->currSlave->inputRegs.next, "inputRegisters");
+}
+
+void lcmbsConfValidateInputRegs(LCMBS_CONF_PARSER_T *parser) {
+  if (lcmbsConfCompileRegs(parser->conf, &parser->currSlave->inputRegs, "inputRegisters")) {
+    XML_StopParser(parser->xmlParser, 0);
+  }
+}
+
+void lcmbsConfParseInputRegsRangeAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  lcmbsConfParseRangeAttrs(parser, attr, &parser->currSlave->inputRegs.next, "inputRegisters range");
 }
 
 void lcmbsConfParseInputRegAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
@@ -693,8 +2443,34 @@ void lcmbsConfParseInputBitRegPinAttrs(LCMBS_CONF_PARSER_T *parser, const char *
   lcmbsConfParseBitRegPinAttrs(parser, attr, &parser->currSlave->inputRegs, "inputRegister");
 }
 
+void lcmbsConfParseInputChgCntAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  lcmbsConfParseChgRegAttrs(parser, attr, &parser->currSlave->inputRegs, LCMBS_VREG_CHGCNT, "changeCounter");
+}
+
+void lcmbsConfParseInputChgMapAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  lcmbsConfParseChgRegAttrs(parser, attr, &parser->currSlave->inputRegs, LCMBS_VREG_CHGREGS, "changeBitmap");
+}
+
+void lcmbsConfParseInputCycleCntAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  lcmbsConfParseCycleRegAttrs(parser, attr, &parser->currSlave->inputRegs, LCMBS_VREG_CYCLE, 2, "cycleCounter");
+}
+
+void lcmbsConfParseInputCycleTsAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  lcmbsConfParseCycleRegAttrs(parser, attr, &parser->currSlave->inputRegs, LCMBS_VREG_CYCLETS, 4, "cycleTimestamp");
+}
+
 void lcmbsConfParseInputsAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
-  lcmbsConfParseListAttrs(parser, attr, &parser->currSlave->inputs.start, "inputs");
+  lcmbsConfParseListAttrs(parser, attr, &parser->currSlave->inputs.defined, &parser->currSlave->inputs.next, "inputs");
+}
+
+void lcmbsConfValidateInputs(LCMBS_CONF_PARSER_T *parser) {
+  if (lcmbsConfCompileBits(parser->conf, &parser->currSlave->inputs, "inputs")) {
+    XML_StopParser(parser->xmlParser, 0);
+  }
+}
+
+void lcmbsConfParseInputsRangeAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  lcmbsConfParseRangeAttrs(parser, attr, &parser->currSlave->inputs.next, "inputs range");
 }
 
 void lcmbsConfParseInputAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
@@ -702,7 +2478,17 @@ void lcmbsConfParseInputAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
 }
 
 void lcmbsConfParseCoilsAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
-  lcmbsConfParseListAttrs(parser, attr, &parser->currSlave->coils.start, "coils");
+  lcmbsConfParseListAttrs(parser, attr, &parser->currSlave->coils.defined, &parser->currSlave->coils.next, "coils");
+}
+
+void lcmbsConfValidateCoils(LCMBS_CONF_PARSER_T *parser) {
+  if (lcmbsConfCompileBits(parser->conf, &parser->currSlave->coils, "coils")) {
+    XML_StopParser(parser->xmlParser, 0);
+  }
+}
+
+void lcmbsConfParseCoilsRangeAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
+  lcmbsConfParseRangeAttrs(parser, attr, &parser->currSlave->coils.next, "coils range");
 }
 
 void lcmbsConfParseCoilAttrs(LCMBS_CONF_PARSER_T *parser, const char **attr) {
@@ -1,9 +1,11 @@
 #ifndef _LCMBS_CONF_H
 #define _LCMBS_CONF_H
 
+#include <pthread.h>
 #include <hal.h>
 
 #include "mbslave_util.h"
+#include "mbslave_genfmt.h"
 
 #define LCMBS_PINTYPE_INVAL 0
 #define LCMBS_PINTYPE_U16   1
@@ -11,24 +13,84 @@
 #define LCMBS_PINTYPE_U32   3
 #define LCMBS_PINTYPE_S32   4
 #define LCMBS_PINTYPE_FLOAT 5
+#define LCMBS_PINTYPE_BIT   6
 
 #define LCMBS_PINFLAG_BYTESWAP (1 << 0)
 #define LCMBS_PINFLAG_WORDSWAP (1 << 1)
 
+#define LCMBS_VREG_NONE    0
+#define LCMBS_VREG_CHGCNT  1
+#define LCMBS_VREG_CHGREGS 2
+#define LCMBS_VREG_CHGBITS 3
+#define LCMBS_VREG_CYCLE   4
+#define LCMBS_VREG_CYCLETS 5
+
+#define LCMBS_CHG_BLOCKS   16
+
+#define LCMBS_CACHE_REGS_MAX 127
+
+#define LCMBS_COAL_KEY_MAX  8
+#define LCMBS_COAL_DATA_MAX 260
+
+#define LCMBS_SHM_NAME_LEN 64
+
+#define LCMBS_RTX_QUEUE_DEFAULT 1024
+#define LCMBS_RTX_QUEUE_MAX     65536
+
+#define LCMBS_UNIX_PATH_LEN 108
+
+#define LCMBS_TLS_PATH_LEN  256
+#define LCMBS_TLS_ROLES_LEN 256
+
+#define LCMBS_PRIO_NORMAL 0
+#define LCMBS_PRIO_HIGH   1
+#define LCMBS_PRIO_LOW    2
+
+#define LCMBS_PRIO_ADDRS_LEN 256
+
+#define LCMBS_UDP_BATCH_DEFAULT 32
+#define LCMBS_UDP_BATCH_MAX     256
+
+#define LCMBS_FIFO_SIZE_MAX  65536
+#define LCMBS_FIFO_VALS_MAX  31
+
+#define LCMBS_SAMPLE_CONTINUOUS 0
+#define LCMBS_SAMPLE_TRIGGERED  1
+
+#define LCMBS_SAMPLE_PINS_MAX     32
+#define LCMBS_SAMPLE_SLOTS_MAX    65536
+#define LCMBS_SAMPLE_HDR_REGS     16
+#define LCMBS_SAMPLE_FILE_RECORDS 10000
+
+#define LCMBS_TABLE_COMMIT_REQUEST  0
+#define LCMBS_TABLE_COMMIT_EXPLICIT 1
+
+#define LCMBS_TABLE_RECORDS_MAX 10000
+
 typedef struct {
+  int addr;
   char name[HAL_NAME_LEN];
   hal_bit_t **pin;
 } LCMBS_CONF_BIT_PIN_T;
 
 typedef struct {
-  int start;
+  int defined;
+  int next;
   LCMBS_VECT_T regs;
   LCMBS_VECT_T pins;
+  LCMBS_PTAB_T map;
+  uint32_t gen;
+  void **genPins;
+  LCMBS_GEN_READ_T genRead;
+  LCMBS_GEN_WRITE_T genWrite;
 } LCMBS_CONF_REGS_T;
 
 typedef struct {
-  int start;
+  int defined;
+  int next;
   LCMBS_VECT_T pins;
+  LCMBS_PTAB_T map;
+  uint32_t gen;
 } LCMBS_CONF_BITS_T;
 
 typedef struct {
@@ -51,34 +113,233 @@ typedef struct {
 } LCMBS_CONF_REG_BIT_PIN_T;
 
 typedef struct {
+  int addr;
   int index;
   LCMBS_CONF_REG_PIN_T *pin;
   LCMBS_VECT_T *bitpins;
+  int vreg;
+  int runEnd;  // first unmapped address after this one
 } LCMBS_CONF_REG_T;
 
+typedef struct {
+  int enabled;
+  int valid;
+  pthread_mutex_t lock;
+  uint16_t counter;
+  uint16_t regsMap;
+  uint16_t bitsMap;
+  int regsBlockSize;
+  int bitsBlockSize;
+  uint32_t *regsSnap;
+  uint8_t *bitsSnap;
+} LCMBS_CONF_CHG_T;
+
+typedef struct {
+  int valid;
+  uint8_t fnk;
+  uint16_t start;
+  uint16_t count;
+  uint32_t gen;
+  uint32_t raw[LCMBS_CACHE_REGS_MAX];
+  uint16_t data[LCMBS_CACHE_REGS_MAX];
+} LCMBS_CONF_CACHE_ENTRY_T;
+
+typedef struct {
+  int size;
+  pthread_mutex_t lock;
+  LCMBS_CONF_CACHE_ENTRY_T *entries;
+} LCMBS_CONF_CACHE_T;
+
+typedef struct {
+  int refs;
+  int done;
+  uint32_t gen;
+  uint8_t fnk;
+  size_t keyLen;
+  uint8_t key[LCMBS_COAL_KEY_MAX];
+  int err;
+  size_t len;
+  uint8_t data[LCMBS_COAL_DATA_MAX];
+  pthread_cond_t cond;
+} LCMBS_CONF_COAL_SLOT_T;
+
+typedef struct {
+  int size;
+  pthread_mutex_t lock;
+  LCMBS_CONF_COAL_SLOT_T *slots;
+} LCMBS_CONF_COAL_T;
+
+typedef struct {
+  int enabled;
+  char name[LCMBS_SHM_NAME_LEN];
+  int period;
+} LCMBS_CONF_SHM_T;
+
+typedef struct {
+  int enabled;
+  int key;
+  int queueSize;
+} LCMBS_CONF_RTX_T;
+
+struct LCMBS_FIFO_RING;
+
+typedef struct {
+  int addr;
+  char name[HAL_NAME_LEN];
+  int type;
+  hal_type_t halType;
+  int size;
+  union {
+    hal_u32_t **u;
+    hal_s32_t **s;
+  } value;
+  hal_bit_t **strobe;
+  hal_u32_t **count;
+  hal_u32_t **overruns;
+  struct LCMBS_FIFO_RING *ring;
+  int event;
+} LCMBS_CONF_FIFO_T;
+
+typedef struct {
+  int defined;
+  int period;
+  LCMBS_VECT_T queues;
+} LCMBS_CONF_FIFOS_T;
+
+struct LCMBS_SAMPLE_RING;
+
+typedef struct {
+  char name[HAL_NAME_LEN];
+  int type;
+  hal_type_t halType;
+  int regCount;
+  union {
+    hal_bit_t **b;
+    hal_u32_t **u;
+    hal_s32_t **s;
+    hal_float_t **f;
+  } pin;
+} LCMBS_CONF_SAMPLE_PIN_T;
+
+typedef struct {
+  char name[HAL_NAME_LEN];
+  int file;
+  int dataFiles;
+  int mode;
+  int period;
+  int slots;
+  int pretrigger;
+  int frameRegs;
+  LCMBS_VECT_T pins;
+  hal_bit_t **trigger;
+  hal_bit_t **arm;
+  struct LCMBS_SAMPLE_RING *ring;
+} LCMBS_CONF_SAMPLE_T;
+
+typedef union {
+  hal_u32_t **u;
+  hal_s32_t **s;
+  hal_float_t **f;
+} LCMBS_CONF_TABLE_PIN_T;
+
+typedef struct {
+  char name[HAL_NAME_LEN];
+  int file;
+  int type;
+  hal_type_t halType;
+  int regCount;
+  int size;
+  int records;
+  int commit;
+  int files;
+  LCMBS_CONF_TABLE_PIN_T *pins;
+  hal_u32_t **commits;
+  int staged;
+  uint16_t *staging;
+} LCMBS_CONF_TABLE_T;
+
+typedef struct {
+  pthread_mutex_t lock;
+  LCMBS_VECT_T tables;
+} LCMBS_CONF_TABLES_T;
+
+struct LCMBS_DIAG;
+
 typedef struct {
   void *halData;
   size_t halSize;
+  size_t confSize;
   char name[HAL_NAME_LEN];
   LCMBS_VECT_T tcpListeners;
+  LCMBS_VECT_T unixListeners;
+  LCMBS_VECT_T udpListeners;
+  LCMBS_VECT_T tlsListeners;
   LCMBS_CONF_REGS_T holdingRegs;
   LCMBS_CONF_REGS_T inputRegs;
   LCMBS_CONF_BITS_T inputs;
   LCMBS_CONF_BITS_T coils;
+  LCMBS_CONF_CHG_T chg;
+  LCMBS_CONF_CACHE_T cache;
+  LCMBS_CONF_COAL_T coal;
+  LCMBS_CONF_SHM_T shm;
+  LCMBS_CONF_RTX_T rtx;
+  LCMBS_CONF_FIFOS_T fifos;
+  LCMBS_VECT_T samples;
+  LCMBS_CONF_TABLES_T tables;
+  struct LCMBS_DIAG *diag;
+  struct LCMBS_RTX *exchange;
 } LCMBS_CONF_SLAVE_T;
 
 typedef struct {
-  LCMBS_CONF_SLAVE_T *slave;
   int port;
-  void *server;
+  int rtu;
+  int clientRate;
+  int clientBurst;
+  int listenerRate;
+  int listenerBurst;
+  int overloadDelay;
+  int priority;
+  char highPriorityClients[LCMBS_PRIO_ADDRS_LEN];
 } LCMBS_CONF_TCP_LSNR_T;
 
 typedef struct {
+  char path[LCMBS_UNIX_PATH_LEN];
+  int seqpacket;
+  int mode;
+} LCMBS_CONF_UNIX_LSNR_T;
+
+typedef struct {
+  int port;
+  int batch;
+} LCMBS_CONF_UDP_LSNR_T;
+
+typedef struct {
+  int port;
+  char cert[LCMBS_TLS_PATH_LEN];
+  char key[LCMBS_TLS_PATH_LEN];
+  char ca[LCMBS_TLS_PATH_LEN];
+  char readRoles[LCMBS_TLS_ROLES_LEN];
+  char writeRoles[LCMBS_TLS_ROLES_LEN];
+  int sessionCache;
+  int sessionTimeout;
+  int ktls;
+} LCMBS_CONF_TLS_LSNR_T;
+
+typedef struct {
+  LCMBS_ARENA_T arena;
   LCMBS_VECT_T slaves;
 } LCMBS_CONF_T;
 
 LCMBS_CONF_T *lcmbsConfParse(const char *filename);
 void lcmbsConfFree(LCMBS_CONF_T *conf);
 
+LCMBS_CONF_T *lcmbsConfAlloc(void);
+int lcmbsConfFinish(LCMBS_CONF_T *conf);
+LCMBS_CONF_SLAVE_T *lcmbsConfAddSlave(LCMBS_CONF_T *conf);
+int lcmbsConfSetupSlave(LCMBS_CONF_T *conf, LCMBS_CONF_SLAVE_T *slave);
+int lcmbsConfCompileRegs(LCMBS_CONF_T *conf, LCMBS_CONF_REGS_T *regs, const char *type);
+int lcmbsConfCompileBits(LCMBS_CONF_T *conf, LCMBS_CONF_BITS_T *bits, const char *type);
+int lcmbsConfCompileFifos(LCMBS_CONF_T *conf, LCMBS_CONF_FIFOS_T *fifos);
+
 #endif
 
@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "mbslave_diag.h"
+#include "mbslave_prot.h"
+
+void lcmbsDiagRequest(LCMBS_DIAG_T *diag, uint8_t fnk, uint8_t err) {
+  uint8_t ev = LCMBS_DIAG_EV_SEND;
+
+  // a successful request costs one counter and one log
+  // update, the event counter is derived from the rest
+  lcmbsDiagCount(&diag->busMessages);
+  switch (err) {
+    case MB_ERR_OK:
+      if (fnk == MB_FNK_GET_COMM_EVENT_COUNTER || fnk == MB_FNK_GET_COMM_EVENT_LOG) {
+        lcmbsDiagCount(&diag->eventQueries);
+      }
+      break;
+    case MB_ERR_SLAVE_DEVICE_FAILURE:
+      ev |= LCMBS_DIAG_EV_SEND_ABORT_EX;
+      lcmbsDiagCount(&diag->exceptions);
+      break;
+    case MB_ERR_SLAVE_DEVICE_BUSY:
+      ev |= LCMBS_DIAG_EV_SEND_BUSY_EX;
+      lcmbsDiagCount(&diag->exceptions);
+      lcmbsDiagCount(&diag->busy);
+      break;
+    default:
+      ev |= LCMBS_DIAG_EV_SEND_READ_EX;
+      lcmbsDiagCount(&diag->exceptions);
+  }
+
+  lcmbsDiagLog2(diag, LCMBS_DIAG_EV_RCV, ev);
+}
+
+void lcmbsDiagBusy(LCMBS_DIAG_T *diag) {
+  // rejected before processing, still a message to this slave
+  lcmbsDiagCount(&diag->busMessages);
+  lcmbsDiagCount(&diag->exceptions);
+  lcmbsDiagCount(&diag->busy);
+  lcmbsDiagLog2(diag, LCMBS_DIAG_EV_RCV, LCMBS_DIAG_EV_SEND | LCMBS_DIAG_EV_SEND_BUSY_EX);
+}
+
+void lcmbsDiagCommError(LCMBS_DIAG_T *diag) {
+  lcmbsDiagCount(&diag->busMessages);
+  lcmbsDiagCount(&diag->commErrors);
+  lcmbsDiagLog(diag, LCMBS_DIAG_EV_RCV | LCMBS_DIAG_EV_RCV_COMM_ERR);
+}
+
+void lcmbsDiagOverrun(LCMBS_DIAG_T *diag) {
+  lcmbsDiagCount(&diag->busMessages);
+  lcmbsDiagCount(&diag->overruns);
+  lcmbsDiagLog(diag, LCMBS_DIAG_EV_RCV | LCMBS_DIAG_EV_RCV_OVERRUN);
+}
+
+void lcmbsDiagNoResponse(LCMBS_DIAG_T *diag) {
+  // the request itself was counted when it was processed
+  lcmbsDiagCount(&diag->noResponses);
+}
+
+void lcmbsDiagClear(LCMBS_DIAG_T *diag, int clearLog) {
+  // counters still in flight may survive a clear, good enough for diagnostics
+  __atomic_store_n(&diag->busMessages, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&diag->commErrors, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&diag->exceptions, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&diag->noResponses, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&diag->busy, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&diag->overruns, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&diag->overrunsCleared, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&diag->eventQueries, 0, __ATOMIC_RELAXED);
+  if (clearLog) {
+    __atomic_store_n(&diag->logPos, 0, __ATOMIC_RELAXED);
+  }
+}
+
+void lcmbsDiagClearOverruns(LCMBS_DIAG_T *diag) {
+  // overruns stay part of the bus messages, only the reported count restarts
+  __atomic_store_n(&diag->overrunsCleared, __atomic_load_n(&diag->overruns, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+uint32_t lcmbsDiagOverruns(LCMBS_DIAG_T *diag) {
+  return __atomic_load_n(&diag->overruns, __ATOMIC_RELAXED) - __atomic_load_n(&diag->overrunsCleared, __ATOMIC_RELAXED);
+}
+
+uint32_t lcmbsDiagSlaveMessages(LCMBS_DIAG_T *diag) {
+  // every bus message except the ones that could not be parsed
+  return __atomic_load_n(&diag->busMessages, __ATOMIC_RELAXED) -
+    __atomic_load_n(&diag->commErrors, __ATOMIC_RELAXED) - __atomic_load_n(&diag->overruns, __ATOMIC_RELAXED);
+}
+
+uint32_t lcmbsDiagEvents(LCMBS_DIAG_T *diag) {
+  // the event counter skips exceptions and its own queries
+  return lcmbsDiagSlaveMessages(diag) -
+    __atomic_load_n(&diag->exceptions, __ATOMIC_RELAXED) - __atomic_load_n(&diag->eventQueries, __ATOMIC_RELAXED);
+}
+
+int lcmbsDiagReadLog(LCMBS_DIAG_T *diag, uint8_t *events) {
+  uint32_t pos = __atomic_load_n(&diag->logPos, __ATOMIC_RELAXED);
+  int i, n;
+
+  // newest event first
+  n = (pos < LCMBS_DIAG_LOG_SIZE) ? pos : LCMBS_DIAG_LOG_SIZE;
+  for (i = 0; i < n; i++) {
+    events[i] = __atomic_load_n(&diag->log[(pos - 1 - i) % LCMBS_DIAG_LOG_SIZE], __ATOMIC_RELAXED);
+  }
+
+  return n;
+}
+
@@ -0,0 +1,70 @@
+#ifndef _LCMBS_DIAG_H
+#define _LCMBS_DIAG_H
+
+#include <stdint.h>
+
+// Communication counters and event log of a slave for the FC8, FC11 and
+// FC12 diagnostics. They are updated with relaxed atomics in the request
+// path and only read when a master asks for them. The counters belong to
+// the runtime slave, so they survive config reloads. To keep the request
+// path short, slave messages and the event counter are not counted but
+// derived from the bus messages when queried.
+
+#define LCMBS_DIAG_LOG_SIZE 64
+
+// receive events
+#define LCMBS_DIAG_EV_RCV           0x80
+#define LCMBS_DIAG_EV_RCV_COMM_ERR  0x02
+#define LCMBS_DIAG_EV_RCV_OVERRUN   0x10
+
+// send events
+#define LCMBS_DIAG_EV_SEND          0x40
+#define LCMBS_DIAG_EV_SEND_READ_EX  0x01
+#define LCMBS_DIAG_EV_SEND_ABORT_EX 0x02
+#define LCMBS_DIAG_EV_SEND_BUSY_EX  0x04
+
+#define LCMBS_DIAG_EV_RESTART       0x04
+
+typedef struct LCMBS_DIAG {
+  uint32_t busMessages;
+  uint32_t commErrors;
+  uint32_t exceptions;
+  uint32_t noResponses;
+  uint32_t busy;
+  uint32_t overruns;
+  uint32_t overrunsCleared;
+  uint32_t eventQueries;
+  uint32_t logPos;
+  uint8_t log[LCMBS_DIAG_LOG_SIZE];
+} LCMBS_DIAG_T;
+
+static inline void lcmbsDiagCount(uint32_t *counter) {
+  __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+}
+
+static inline void lcmbsDiagLog(LCMBS_DIAG_T *diag, uint8_t ev) {
+  uint32_t pos = __atomic_fetch_add(&diag->logPos, 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&diag->log[pos % LCMBS_DIAG_LOG_SIZE], ev, __ATOMIC_RELAXED);
+}
+
+static inline void lcmbsDiagLog2(LCMBS_DIAG_T *diag, uint8_t ev1, uint8_t ev2) {
+  uint32_t pos = __atomic_fetch_add(&diag->logPos, 2, __ATOMIC_RELAXED);
+  __atomic_store_n(&diag->log[pos % LCMBS_DIAG_LOG_SIZE], ev1, __ATOMIC_RELAXED);
+  __atomic_store_n(&diag->log[(pos + 1) % LCMBS_DIAG_LOG_SIZE], ev2, __ATOMIC_RELAXED);
+}
+
+void lcmbsDiagRequest(LCMBS_DIAG_T *diag, uint8_t fnk, uint8_t err);
+void lcmbsDiagBusy(LCMBS_DIAG_T *diag);
+void lcmbsDiagCommError(LCMBS_DIAG_T *diag);
+void lcmbsDiagOverrun(LCMBS_DIAG_T *diag);
+void lcmbsDiagNoResponse(LCMBS_DIAG_T *diag);
+
+void lcmbsDiagClear(LCMBS_DIAG_T *diag, int clearLog);
+void lcmbsDiagClearOverruns(LCMBS_DIAG_T *diag);
+uint32_t lcmbsDiagOverruns(LCMBS_DIAG_T *diag);
+uint32_t lcmbsDiagSlaveMessages(LCMBS_DIAG_T *diag);
+uint32_t lcmbsDiagEvents(LCMBS_DIAG_T *diag);
+int lcmbsDiagReadLog(LCMBS_DIAG_T *diag, uint8_t *events);
+
+#endif
+
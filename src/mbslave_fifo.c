@@ -0,0 +1,216 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/select.h>
+#include <sys/eventfd.h>
+
+#include "mbslave_fifo.h"
+#include "mbslave_rtx.h"
+
+#define SET_TIMEVAL_MS(tv, val) { tv.tv_sec = val / 1000; tv.tv_usec = (val % 1000) * 1000; }
+
+static void *lcmbsFifoThread(void *arg);
+
+LCMBS_FIFO_RING_T *lcmbsFifoRingAlloc(LCMBS_CONF_FIFO_T *conf) {
+  LCMBS_FIFO_RING_T *ring;
+  uint32_t size;
+
+  // power of two storage, the configured size limits the fill level
+  for (size = 1; size < conf->size; size <<= 1);
+
+  ring = calloc(1, sizeof(LCMBS_FIFO_RING_T) + size * sizeof(uint16_t));
+  if (!ring) {
+    return NULL;
+  }
+
+  ring->capacity = conf->size;
+  ring->mask = size - 1;
+  ring->type = conf->type;
+
+  // a strobe already set at start is no event
+  ring->lastStrobe = 1;
+  pthread_mutex_init(&ring->readLock, NULL);
+
+  return ring;
+}
+
+void lcmbsFifoRingFree(LCMBS_FIFO_RING_T *ring) {
+  pthread_mutex_destroy(&ring->readLock);
+  free(ring);
+}
+
+int lcmbsFifoRingMatches(LCMBS_FIFO_RING_T *ring, LCMBS_CONF_FIFO_T *conf) {
+  return ring->capacity == conf->size && ring->type == conf->type;
+}
+
+int lcmbsFifoRead(LCMBS_FIFO_RING_T *ring, uint16_t *vals, int max) {
+  uint64_t head, tail;
+  int i, n;
+
+  pthread_mutex_lock(&ring->readLock);
+
+  head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  tail = ring->tail;
+  n = (head - tail < max) ? head - tail : max;
+  for (i = 0; i < n; i++) {
+    vals[i] = ring->data[(tail + i) & ring->mask];
+  }
+
+  // hand the slots back to the sampler
+  __atomic_store_n(&ring->tail, tail + n, __ATOMIC_RELEASE);
+
+  pthread_mutex_unlock(&ring->readLock);
+  return n;
+}
+
+static uint16_t clampValue(LCMBS_CONF_FIFO_T *fifo, uint32_t u) {
+  int32_t s;
+
+  // limit range like single register pins
+  if (fifo->type == LCMBS_PINTYPE_S16) {
+    s = (int32_t) u;
+    if (s < SHRT_MIN) s = SHRT_MIN;
+    if (s > SHRT_MAX) s = SHRT_MAX;
+    return (uint16_t) s;
+  }
+
+  if (u > USHRT_MAX) u = USHRT_MAX;
+  return u;
+}
+
+static void pushValue(LCMBS_FIFO_RING_T *ring, uint64_t *head, uint64_t tail, uint16_t val) {
+  // a full queue keeps its oldest events and counts the loss
+  if (*head - tail < ring->capacity) {
+    ring->data[*head & ring->mask] = val;
+    __atomic_store_n(&ring->head, ++(*head), __ATOMIC_RELEASE);
+  } else {
+    ring->overruns++;
+  }
+}
+
+static void sampleFifo(LCMBS_RTX_T *rtx, LCMBS_CONF_FIFO_T *fifo) {
+  LCMBS_FIFO_RING_T *ring = fifo->ring;
+  uint64_t head = ring->head;
+  uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+  LCMBS_RTX_VAL_T val;
+  uint32_t lost;
+  int strobe;
+
+  if (fifo->event >= 0) {
+    // values latched by mbslave_rt, edges it
+    // could not store count as overruns too
+    while (lcmbsRtxPopEvent(rtx, fifo->event, &val)) {
+      pushValue(ring, &head, tail, clampValue(fifo, val.u));
+    }
+    lost = lcmbsRtxEventLost(rtx, fifo->event);
+    ring->overruns += lost - ring->rtLost;
+    ring->rtLost = lost;
+  } else {
+    // queue the value on the rising strobe edge
+    strobe = **fifo->strobe ? 1 : 0;
+    if (strobe && !ring->lastStrobe) {
+      pushValue(ring, &head, tail, clampValue(fifo, **fifo->value.u));
+    }
+    ring->lastStrobe = strobe;
+  }
+
+  // status pins change rarely, realtime slaves
+  // would queue a write on every period otherwise
+  if (**fifo->count != head - tail) {
+    lcmbsPinSetU32(fifo->count, head - tail);
+  }
+  if (**fifo->overruns != ring->overruns) {
+    lcmbsPinSetU32(fifo->overruns, ring->overruns);
+  }
+}
+
+LCMBS_FIFO_DATA_T *lcmbsFifoStart(LCMBS_RCU_T *slave) {
+  LCMBS_FIFO_DATA_T *fifo;
+
+  // alloc memory
+  fifo = calloc(1, sizeof(LCMBS_FIFO_DATA_T));
+  if (!fifo) {
+    goto fail0;
+  }
+
+  // queues are looked up on every period,
+  // a config reload may replace them
+  fifo->slave = slave;
+
+  // create exit flag event
+  if ((fifo->exit_flag = eventfd(0, 0)) < 0) {
+    goto fail1;
+  }
+
+  // start sampler thread
+  if (pthread_create(&fifo->thread, 0, lcmbsFifoThread, fifo)) {
+    goto fail2;
+  }
+
+  return fifo;
+
+fail2:
+  close(fifo->exit_flag);
+fail1:
+  free(fifo);
+fail0:
+  return NULL;
+}
+
+void lcmbsFifoStop(LCMBS_FIFO_DATA_T *fifo) {
+  // set exit flag
+  uint64_t u = 1;
+  if (write(fifo->exit_flag, &u, sizeof(uint64_t)) < 0) {
+    fprintf(stderr, "%s: ERROR: error writing fifo exit event\n", compName);
+  }
+
+  // wait for sampler thread
+  pthread_join(fifo->thread, NULL);
+
+  close(fifo->exit_flag);
+  free(fifo);
+}
+
+static void *lcmbsFifoThread(void *arg) {
+  LCMBS_FIFO_DATA_T *fifo = (LCMBS_FIFO_DATA_T *) arg;
+  LCMBS_CONF_SLAVE_T *slave;
+  struct timeval timeout;
+  fd_set rfds;
+  int ret, idx, period = 1;
+  size_t i;
+
+  while (1) {
+    // wait for exit or next period
+    FD_ZERO(&rfds);
+    FD_SET(fifo->exit_flag, &rfds);
+    SET_TIMEVAL_MS(timeout, period);
+    ret = select(fifo->exit_flag + 1, &rfds, NULL, NULL, &timeout);
+    if (ret < 0 && errno != EINTR) {
+      fprintf(stderr, "%s: ERROR: select failed on fifo sampler\n", compName);
+      break;
+    }
+    if (ret > 0) {
+      break;
+    }
+
+    idx = lcmbsRcuReadLock(fifo->slave);
+    slave = lcmbsRcuDeref(fifo->slave);
+
+    lcmbsRtxBegin(slave->exchange);
+    for (i = 0; i < slave->fifos.queues.count; i++) {
+      sampleFifo(slave->exchange, lcmbsVectGet(&slave->fifos.queues, i));
+    }
+    lcmbsRtxEnd(slave->exchange);
+    if (slave->fifos.defined) {
+      period = slave->fifos.period;
+    }
+
+    lcmbsRcuReadUnlock(fifo->slave, idx);
+  }
+
+  return NULL;
+}
+
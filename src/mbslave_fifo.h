@@ -0,0 +1,47 @@
+#ifndef _LCMBS_FIFO_H
+#define _LCMBS_FIFO_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "mbslave_util.h"
+#include "mbslave_conf.h"
+
+// Event queue behind a FC24 fifo address. The sampler thread is the only
+// producer, so queueing takes no locks. Readers only serialize among
+// themselves, as every FC24 request drains the values it returns.
+// Rings belong to the runtime slave and survive config reloads.
+//
+// Without a realtime node the sampler polls the strobe pin once per period,
+// shorter strobe pulses are missed. Realtime slaves take the values latched
+// by mbslave_rt on every strobe edge instead.
+
+typedef struct LCMBS_FIFO_RING {
+  uint32_t capacity;
+  uint32_t mask;
+  int type;
+  int lastStrobe;
+  uint32_t overruns;
+  uint32_t rtLost;
+  uint64_t head;
+  pthread_mutex_t readLock;
+  uint64_t tail __attribute__((aligned(64)));
+  uint16_t data[];
+} LCMBS_FIFO_RING_T;
+
+typedef struct {
+  LCMBS_RCU_T *slave;
+  pthread_t thread;
+  int exit_flag;
+} LCMBS_FIFO_DATA_T;
+
+LCMBS_FIFO_RING_T *lcmbsFifoRingAlloc(LCMBS_CONF_FIFO_T *conf);
+void lcmbsFifoRingFree(LCMBS_FIFO_RING_T *ring);
+int lcmbsFifoRingMatches(LCMBS_FIFO_RING_T *ring, LCMBS_CONF_FIFO_T *conf);
+int lcmbsFifoRead(LCMBS_FIFO_RING_T *ring, uint16_t *vals, int max);
+
+LCMBS_FIFO_DATA_T *lcmbsFifoStart(LCMBS_RCU_T *slave);
+void lcmbsFifoStop(LCMBS_FIFO_DATA_T *fifo);
+
+#endif
+
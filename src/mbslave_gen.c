@@ -0,0 +1,524 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <dlfcn.h>
+
+#include "mbslave_gen.h"
+
+#define ADDR_COUNT 65536
+
+typedef struct {
+  int addr;
+  int runEnd;
+  int index;
+  LCMBS_CONF_REG_PIN_T *pin;
+} GEN_PIN_T;
+
+// helpers of the generated code, conversions match lcmbsProtEncodePin()
+// and lcmbsProtPresetRegs()
+static const char *preamble =
+  "#include <stdint.h>\n"
+  "#include <string.h>\n"
+  "\n"
+  "#include \"mbslave_genfmt.h\"\n"
+  "\n"
+  "static inline uint32_t getU16(void *p) {\n"
+  "  uint32_t v = *(volatile uint32_t *) p;\n"
+  "  return v > 0xffff ? 0xffff : v;\n"
+  "}\n"
+  "\n"
+  "static inline uint32_t getS16(void *p) {\n"
+  "  int32_t v = *(volatile int32_t *) p;\n"
+  "  if (v < -32768) v = -32768;\n"
+  "  if (v > 32767) v = 32767;\n"
+  "  return v;\n"
+  "}\n"
+  "\n"
+  "static inline uint32_t getU32(void *p) {\n"
+  "  return *(volatile uint32_t *) p;\n"
+  "}\n"
+  "\n"
+  "static inline uint32_t getS32(void *p) {\n"
+  "  return *(volatile int32_t *) p;\n"
+  "}\n"
+  "\n"
+  "static inline uint32_t getFloat(void *p) {\n"
+  "  float f = *(volatile double *) p;\n"
+  "  uint32_t v;\n"
+  "  memcpy(&v, &f, sizeof(v));\n"
+  "  return v;\n"
+  "}\n"
+  "\n"
+  "static inline void setU16(void *p, uint32_t v) {\n"
+  "  *(volatile uint32_t *) p = (uint16_t) v;\n"
+  "}\n"
+  "\n"
+  "static inline void setS16(void *p, uint32_t v) {\n"
+  "  *(volatile int32_t *) p = (int16_t) v;\n"
+  "}\n"
+  "\n"
+  "static inline void setU32(void *p, uint32_t v) {\n"
+  "  *(volatile uint32_t *) p = v;\n"
+  "}\n"
+  "\n"
+  "static inline void setS32(void *p, uint32_t v) {\n"
+  "  *(volatile int32_t *) p = (int32_t) v;\n"
+  "}\n"
+  "\n"
+  "static inline void setFloat(void *p, uint32_t v) {\n"
+  "  float f;\n"
+  "  memcpy(&f, &v, sizeof(f));\n"
+  "  *(volatile double *) p = f;\n"
+  "}\n";
+
+static uint64_t hashInt(uint64_t hash, int val) {
+  int i;
+
+  // FNV-1a 64, like the XML hash
+  for (i = 0; i < sizeof(val); i++) {
+    hash ^= (uint8_t) (val >> (i * 8));
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+static uint64_t tableLayout(LCMBS_CONF_REGS_T *regs) {
+  uint64_t hash = 14695981039346656037ULL;
+  size_t i;
+
+  for (i = 0; i < regs->regs.count; i++) {
+    LCMBS_CONF_REG_T *reg = lcmbsVectGet(&regs->regs, i);
+    hash = hashInt(hash, reg->addr);
+    hash = hashInt(hash, reg->index);
+    hash = hashInt(hash, reg->vreg);
+    hash = hashInt(hash, reg->bitpins != NULL);
+    if (reg->pin != NULL) {
+      hash = hashInt(hash, reg->pin - (LCMBS_CONF_REG_PIN_T *) regs->pins.data);
+      hash = hashInt(hash, reg->pin->type);
+      hash = hashInt(hash, reg->pin->regCount);
+      hash = hashInt(hash, reg->pin->flags);
+    } else {
+      hash = hashInt(hash, -1);
+    }
+  }
+
+  return hash;
+}
+
+static LCMBS_CONF_REG_PIN_T *plainPin(LCMBS_CONF_REGS_T *regs, int addr) {
+  LCMBS_CONF_REG_T *reg = lcmbsPtabGet(&regs->map, addr);
+  LCMBS_CONF_REG_PIN_T *pin;
+  int i;
+
+  // first register of a pin with all its registers in place
+  if (reg == NULL || reg->pin == NULL || reg->index != 0) {
+    return NULL;
+  }
+  pin = reg->pin;
+  if (addr + pin->regCount > ADDR_COUNT) {
+    return NULL;
+  }
+  for (i = 1; i < pin->regCount; i++) {
+    reg = lcmbsPtabGet(&regs->map, addr + i);
+    if (reg == NULL || reg->pin != pin || reg->index != i) {
+      return NULL;
+    }
+  }
+
+  return pin;
+}
+
+static int collectPins(LCMBS_CONF_REGS_T *regs, LCMBS_VECT_T *list) {
+  LCMBS_CONF_REG_PIN_T *pin;
+  GEN_PIN_T *p, *next = NULL;
+  int addr;
+  size_t i;
+
+  // plain pins in address order
+  for (addr = 0; addr < ADDR_COUNT; ) {
+    pin = plainPin(regs, addr);
+    if (pin == NULL) {
+      addr++;
+      continue;
+    }
+    p = lcmbsVectPut(list);
+    if (p == NULL) {
+      return -1;
+    }
+    p->addr = addr;
+    p->index = pin - (LCMBS_CONF_REG_PIN_T *) regs->pins.data;
+    p->pin = pin;
+    addr += pin->regCount;
+  }
+
+  // end of the gapless run each pin belongs to
+  for (i = list->count; i-- > 0; next = p) {
+    p = lcmbsVectGet(list, i);
+    p->runEnd = p->addr + p->pin->regCount;
+    if (next != NULL && next->addr == p->runEnd) {
+      p->runEnd = next->runEnd;
+    }
+  }
+
+  return 0;
+}
+
+static void pinShifts(LCMBS_CONF_REG_PIN_T *pin, int *shifts) {
+  static const int words[2][2] = { { 24, 16 }, { 8, 0 } };
+  int i, w;
+
+  // shift of each wire byte within the 32 bit value
+  for (i = 0; i < pin->regCount; i++) {
+    w = 2 - pin->regCount + i;
+    if (pin->flags & LCMBS_PINFLAG_WORDSWAP) {
+      w = 1 - w;
+    }
+    if (pin->flags & LCMBS_PINFLAG_BYTESWAP) {
+      shifts[i * 2] = words[w][1];
+      shifts[i * 2 + 1] = words[w][0];
+    } else {
+      shifts[i * 2] = words[w][0];
+      shifts[i * 2 + 1] = words[w][1];
+    }
+  }
+}
+
+static const char *pinTypeName(LCMBS_CONF_REG_PIN_T *pin) {
+  switch (pin->type) {
+    case LCMBS_PINTYPE_U16:
+      return "U16";
+    case LCMBS_PINTYPE_S16:
+      return "S16";
+    case LCMBS_PINTYPE_U32:
+      return "U32";
+    case LCMBS_PINTYPE_S32:
+      return "S32";
+    default:
+      return "Float";
+  }
+}
+
+static void writeString(FILE *file, const char *str) {
+  fputc('"', file);
+  for (; *str; str++) {
+    if (*str == '"' || *str == '\\') {
+      fprintf(file, "\\%c", *str);
+    } else if (isprint((unsigned char) *str)) {
+      fputc(*str, file);
+    } else {
+      fprintf(file, "\\%03o", (unsigned char) *str);
+    }
+  }
+  fputc('"', file);
+}
+
+static void writeComment(FILE *file, const char *str) {
+  fputs("      // ", file);
+  for (; *str; str++) {
+    fputc(isprint((unsigned char) *str) ? *str : '?', file);
+  }
+  fputc('\n', file);
+}
+
+static void writeValid(FILE *file, LCMBS_VECT_T *list, const char *name) {
+  size_t i;
+
+  // a range has to start and end on a pin of the same run
+  fprintf(file, "\nstatic int valid%s(uint16_t start, uint16_t count) {\n", name);
+  fprintf(file, "  int run;\n\n");
+  fprintf(file, "  switch (start) {\n");
+  for (i = 0; i < list->count; i++) {
+    GEN_PIN_T *p = lcmbsVectGet(list, i);
+    fprintf(file, "    case %d: run = %d; break;\n", p->addr, p->runEnd - p->addr);
+  }
+  fprintf(file, "    default: return 0;\n");
+  fprintf(file, "  }\n");
+  fprintf(file, "  if (count == 0 || count > run) {\n    return 0;\n  }\n\n");
+  fprintf(file, "  switch (start + count) {\n");
+  for (i = 0; i < list->count; i++) {
+    GEN_PIN_T *p = lcmbsVectGet(list, i);
+    fprintf(file, "    case %d:\n", p->addr + p->pin->regCount);
+  }
+  fprintf(file, "      return 1;\n");
+  fprintf(file, "  }\n\n");
+  fprintf(file, "  return 0;\n");
+  fprintf(file, "}\n");
+}
+
+static void writeAccess(FILE *file, LCMBS_VECT_T *list, const char *name, int write) {
+  const char *buf = write ? "in" : "out";
+  int shifts[4];
+  size_t i;
+  int j;
+
+  if (write) {
+    fprintf(file, "\nstatic int write%s(void *const *pins, uint16_t start, uint16_t count, const uint8_t *in) {\n", name);
+  } else {
+    fprintf(file, "\nstatic int read%s(void *const *pins, uint16_t start, uint16_t count, uint8_t *out) {\n", name);
+  }
+  fprintf(file, "  uint32_t v;\n\n");
+  fprintf(file, "  if (!valid%s(start, count)) {\n    return -1;\n  }\n\n", name);
+  fprintf(file, "  switch (start) {\n");
+
+  // one case per pin, falling through to the next pin of the run
+  for (i = 0; i < list->count; i++) {
+    GEN_PIN_T *p = lcmbsVectGet(list, i);
+    int bytes = p->pin->regCount * 2;
+
+    fprintf(file, "    case %d:\n", p->addr);
+    writeComment(file, p->pin->name);
+    pinShifts(p->pin, shifts);
+    if (write) {
+      fprintf(file, "      v = ");
+      for (j = 0; j < bytes; j++) {
+        fprintf(file, "%s(uint32_t) in[%d]", j > 0 ? " | " : "", j);
+        if (shifts[j] > 0) {
+          fprintf(file, " << %d", shifts[j]);
+        }
+      }
+      fprintf(file, ";\n");
+      fprintf(file, "      set%s(pins[%d], v);\n", pinTypeName(p->pin), p->index);
+    } else {
+      fprintf(file, "      v = get%s(pins[%d]);\n", pinTypeName(p->pin), p->index);
+      for (j = 0; j < bytes; j++) {
+        if (shifts[j] > 0) {
+          fprintf(file, "      out[%d] = v >> %d;\n", j, shifts[j]);
+        } else {
+          fprintf(file, "      out[%d] = v;\n", j);
+        }
+      }
+    }
+
+    if (p->addr + p->pin->regCount == p->runEnd) {
+      fprintf(file, "      return 0;\n");
+      continue;
+    }
+    fprintf(file, "      if ((count -= %d) == 0) {\n        return 0;\n      }\n", p->pin->regCount);
+    fprintf(file, "      %s += %d;\n", buf, bytes);
+    fprintf(file, "      /* fall through */\n");
+  }
+
+  fprintf(file, "  }\n\n");
+  fprintf(file, "  return -1;\n");
+  fprintf(file, "}\n");
+}
+
+static int writeTable(FILE *file, LCMBS_CONF_REGS_T *regs, const char *name, int writable, int *used) {
+  LCMBS_VECT_T list;
+
+  lcmbsVectInit(&list, sizeof(GEN_PIN_T));
+  if (collectPins(regs, &list)) {
+    lcmbsVectFree(&list);
+    return -1;
+  }
+
+  // tables without plain pins are left to the generic code
+  *used = list.count > 0;
+  if (*used) {
+    writeValid(file, &list, name);
+    writeAccess(file, &list, name, 0);
+    if (writable) {
+      writeAccess(file, &list, name, 1);
+    }
+  }
+
+  lcmbsVectFree(&list);
+  return 0;
+}
+
+static void writeTableDesc(FILE *file, LCMBS_CONF_REGS_T *regs, const char *name, int used, int writable) {
+  fprintf(file, "    { %u, %u, 0x%016llxULL, ", (unsigned) regs->regs.count, (unsigned) regs->pins.count, (unsigned long long) tableLayout(regs));
+  if (used) {
+    fprintf(file, "read%s, ", name);
+  } else {
+    fprintf(file, "NULL, ");
+  }
+  if (used && writable) {
+    fprintf(file, "write%s }", name);
+  } else {
+    fprintf(file, "NULL }");
+  }
+}
+
+int lcmbsGenWrite(LCMBS_CONF_T *conf, const char *filename, uint64_t xmlHash) {
+  char name[32];
+  int *used;
+  FILE *file;
+  size_t i;
+
+  used = calloc(conf->slaves.count * 2 + 1, sizeof(int));
+  if (!used) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for handler generation\n", compName);
+    goto fail0;
+  }
+
+  file = fopen(filename, "w");
+  if (!file) {
+    fprintf(stderr, "%s: ERROR: unable to create handler source %s\n", compName, filename);
+    goto fail1;
+  }
+
+  fprintf(file, "// generated by mbslave --generate, do not edit\n\n");
+  fputs(preamble, file);
+
+  for (i = 0; i < conf->slaves.count; i++) {
+    LCMBS_CONF_SLAVE_T *slave = lcmbsVectGet(&conf->slaves, i);
+    snprintf(name, sizeof(name), "Holding%u", (unsigned) i);
+    if (writeTable(file, &slave->holdingRegs, name, 1, &used[i * 2])) {
+      goto fail2;
+    }
+    snprintf(name, sizeof(name), "Input%u", (unsigned) i);
+    if (writeTable(file, &slave->inputRegs, name, 0, &used[i * 2 + 1])) {
+      goto fail2;
+    }
+  }
+
+  fprintf(file, "\nstatic const LCMBS_GEN_SLAVE_T slaves[] = {\n");
+  for (i = 0; i < conf->slaves.count; i++) {
+    LCMBS_CONF_SLAVE_T *slave = lcmbsVectGet(&conf->slaves, i);
+    fprintf(file, "  {\n    ");
+    writeString(file, slave->name);
+    fprintf(file, ",\n");
+    snprintf(name, sizeof(name), "Holding%u", (unsigned) i);
+    writeTableDesc(file, &slave->holdingRegs, name, used[i * 2], 1);
+    fprintf(file, ",\n");
+    snprintf(name, sizeof(name), "Input%u", (unsigned) i);
+    writeTableDesc(file, &slave->inputRegs, name, used[i * 2 + 1], 0);
+    fprintf(file, "\n  },\n");
+  }
+  fprintf(file, "};\n\n");
+
+  fprintf(file, "const LCMBS_GEN_MODULE_T lcmbsGenModule = {\n");
+  fprintf(file, "  LCMBS_GEN_MAGIC, LCMBS_GEN_VERSION, 0x%016llxULL,\n", (unsigned long long) xmlHash);
+  fprintf(file, "  %u, slaves\n", (unsigned) conf->slaves.count);
+  fprintf(file, "};\n");
+
+  if (ferror(file)) {
+    goto fail2;
+  }
+  if (fclose(file)) {
+    file = NULL;
+    goto fail2;
+  }
+
+  free(used);
+  return 0;
+
+fail2:
+  fprintf(stderr, "%s: ERROR: Couldn't write handler source %s\n", compName, filename);
+  if (file) {
+    fclose(file);
+  }
+  unlink(filename);
+fail1:
+  free(used);
+fail0:
+  return -1;
+}
+
+LCMBS_GEN_T *lcmbsGenOpen(const char *filename) {
+  LCMBS_GEN_T *gen;
+  const LCMBS_GEN_MODULE_T *module;
+
+  gen = calloc(1, sizeof(LCMBS_GEN_T));
+  if (!gen) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for handler module\n", compName);
+    goto fail0;
+  }
+  gen->filename = filename;
+
+  gen->dl = dlopen(filename, RTLD_NOW | RTLD_LOCAL);
+  if (!gen->dl) {
+    fprintf(stderr, "%s: WARNING: unable to load handler module, using generic handlers: %s\n", compName, dlerror());
+    goto fail1;
+  }
+
+  module = dlsym(gen->dl, LCMBS_GEN_SYMBOL);
+  if (!module || module->magic != LCMBS_GEN_MAGIC || module->version != LCMBS_GEN_VERSION) {
+    fprintf(stderr, "%s: WARNING: %s is no handler module of this mbslave version, using generic handlers\n", compName, filename);
+    goto fail2;
+  }
+  gen->module = module;
+
+  return gen;
+
+fail2:
+  dlclose(gen->dl);
+fail1:
+  free(gen);
+fail0:
+  return NULL;
+}
+
+void lcmbsGenClose(LCMBS_GEN_T *gen) {
+  if (gen == NULL) {
+    return;
+  }
+
+  dlclose(gen->dl);
+  free(gen);
+}
+
+int lcmbsGenMatches(LCMBS_GEN_T *gen, uint64_t xmlHash) {
+  if (gen->module->xmlHash != xmlHash) {
+    fprintf(stderr, "%s: WARNING: handler module %s was generated from a different config, using generic handlers\n", compName, gen->filename);
+    return 0;
+  }
+
+  return 1;
+}
+
+static int bindRegs(LCMBS_CONF_T *conf, LCMBS_CONF_SLAVE_T *slave, LCMBS_CONF_REGS_T *regs, const LCMBS_GEN_TABLE_T *table, int writable, const char *type) {
+  void **pins;
+  size_t i;
+
+  if (table->read == NULL) {
+    return 0;
+  }
+
+  // the XML hash matched, so this only fails if the
+  // module was generated by a different mbslave build
+  if (table->regCount != regs->regs.count || table->pinCount != regs->pins.count || table->layout != tableLayout(regs)) {
+    fprintf(stderr, "%s: WARNING: %s of slave %s differ from handler module, using generic handlers\n", compName, type, slave->name);
+    return 0;
+  }
+
+  // pins are bound, their HAL pointers stay the same for this config
+  pins = lcmbsArenaAlloc(&conf->arena, regs->pins.count * sizeof(void *));
+  if (!pins) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for %s handlers\n", compName, type);
+    return -1;
+  }
+  for (i = 0; i < regs->pins.count; i++) {
+    LCMBS_CONF_REG_PIN_T *pin = lcmbsVectGet(&regs->pins, i);
+    pins[i] = (void *) *pin->pin.u;
+  }
+
+  regs->genPins = pins;
+  regs->genRead = table->read;
+  regs->genWrite = writable ? table->write : NULL;
+
+  return 0;
+}
+
+int lcmbsGenBind(LCMBS_GEN_T *gen, LCMBS_CONF_T *conf, LCMBS_CONF_SLAVE_T *slave) {
+  const LCMBS_GEN_SLAVE_T *mod = NULL;
+  uint32_t i;
+
+  for (i = 0; i < gen->module->slaveCount && mod == NULL; i++) {
+    if (strcmp(gen->module->slaves[i].name, slave->name) == 0) {
+      mod = &gen->module->slaves[i];
+    }
+  }
+  if (mod == NULL) {
+    fprintf(stderr, "%s: WARNING: no handlers for slave %s in %s, using generic handlers\n", compName, slave->name, gen->filename);
+    return 0;
+  }
+
+  // writes of realtime slaves have to be queued for mbslave_rt
+  return bindRegs(conf, slave, &slave->holdingRegs, &mod->holdingRegs, !slave->rtx.enabled, "holdingRegisters") ||
+    bindRegs(conf, slave, &slave->inputRegs, &mod->inputRegs, 0, "inputRegisters");
+}
@@ -0,0 +1,22 @@
+#ifndef _LCMBS_GEN_H
+#define _LCMBS_GEN_H
+
+#include <stdint.h>
+
+#include "mbslave_conf.h"
+#include "mbslave_genfmt.h"
+
+typedef struct {
+  const char *filename;
+  void *dl;
+  const LCMBS_GEN_MODULE_T *module;
+} LCMBS_GEN_T;
+
+int lcmbsGenWrite(LCMBS_CONF_T *conf, const char *filename, uint64_t xmlHash);
+
+LCMBS_GEN_T *lcmbsGenOpen(const char *filename);
+void lcmbsGenClose(LCMBS_GEN_T *gen);
+int lcmbsGenMatches(LCMBS_GEN_T *gen, uint64_t xmlHash);
+int lcmbsGenBind(LCMBS_GEN_T *gen, LCMBS_CONF_T *conf, LCMBS_CONF_SLAVE_T *slave);
+
+#endif
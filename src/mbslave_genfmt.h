@@ -0,0 +1,51 @@
+#ifndef _LCMBS_GENFMT_H
+#define _LCMBS_GENFMT_H
+
+#include <stdint.h>
+
+// Interface of a generated register handler module
+//
+// mbslave --generate writes C code with one read and one write function per
+// register table of each slave. Built as shared object, the module exports
+// lcmbsGenModule, which mbslave --handlers loads with dlopen(). The module
+// is only used if xmlHash matches the hash of the loaded XML file, and each
+// table only if its layout hash matches the parsed table.
+//
+// The functions get the HAL pointers of the pins of a table, in the order of
+// their definition. HAL floats are doubles. A read function stores count
+// registers as they go over the wire, a write function takes them from the
+// request data. Both return 0 on success. They return -1 without touching
+// any pin if the range is not a run of plain pins, e.g. misaligned or
+// containing bit mapped or virtual registers; mbslave handles the request
+// with its generic code then.
+
+#define LCMBS_GEN_MAGIC   0x4e47424d
+#define LCMBS_GEN_VERSION 1
+#define LCMBS_GEN_SYMBOL  "lcmbsGenModule"
+
+typedef int (*LCMBS_GEN_READ_T)(void *const *pins, uint16_t start, uint16_t count, uint8_t *out);
+typedef int (*LCMBS_GEN_WRITE_T)(void *const *pins, uint16_t start, uint16_t count, const uint8_t *in);
+
+typedef struct {
+  uint32_t regCount;
+  uint32_t pinCount;
+  uint64_t layout;
+  LCMBS_GEN_READ_T read;
+  LCMBS_GEN_WRITE_T write;
+} LCMBS_GEN_TABLE_T;
+
+typedef struct {
+  const char *name;
+  LCMBS_GEN_TABLE_T holdingRegs;
+  LCMBS_GEN_TABLE_T inputRegs;
+} LCMBS_GEN_SLAVE_T;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t xmlHash;
+  uint32_t slaveCount;
+  const LCMBS_GEN_SLAVE_T *slaves;
+} LCMBS_GEN_MODULE_T;
+
+#endif
@@ -0,0 +1,880 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <link.h>
+#include <elf.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mbslave_image.h"
+
+#define BUFFSIZE 4096
+
+// The image holds the compiled tables of all slaves as flat records
+// in host byte order. Pointers are not stored, they are rebuilt by the
+// same compile step the XML parser uses. The build id of the executable
+// and the record sizes are part of the header, so images written by a
+// different build are rejected.
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t xmlHash;
+  uint64_t buildId;
+  uint32_t recSizes[13];
+  uint32_t slaveCount;
+  uint32_t reserved;
+} LCMBS_IMAGE_HDR_T;
+
+typedef struct {
+  char name[HAL_NAME_LEN];
+  uint32_t halSize;
+  uint32_t listenerCount;
+  uint32_t unixListenerCount;
+  uint32_t udpListenerCount;
+  uint32_t tlsListenerCount;
+  int32_t chgEnabled;
+  int32_t chgRegsBlockSize;
+  int32_t chgBitsBlockSize;
+  int32_t cacheSize;
+  int32_t coalSize;
+  LCMBS_CONF_SHM_T shm;
+  LCMBS_CONF_RTX_T rtx;
+  int32_t fifoPeriod;
+  uint32_t fifoCount;
+  uint32_t sampleCount;
+  uint32_t tableCount;
+} LCMBS_IMAGE_SLAVE_T;
+
+typedef struct {
+  uint32_t regCount;
+  uint32_t pinCount;
+} LCMBS_IMAGE_TABLE_T;
+
+typedef struct {
+  int32_t addr;
+  int32_t index;
+  int32_t vreg;
+  int32_t hasPin;
+  int32_t bitpinCount;
+} LCMBS_IMAGE_REG_T;
+
+typedef struct {
+  const uint8_t *pos;
+  const uint8_t *end;
+} LCMBS_IMAGE_CURSOR_T;
+
+static int hashStream(FILE *file, uint64_t *hash) {
+  uint8_t buffer[BUFFSIZE];
+  size_t len, i;
+
+  // FNV-1a 64
+  *hash = 14695981039346656037ULL;
+  while ((len = fread(buffer, 1, BUFFSIZE, file)) > 0) {
+    for (i = 0; i < len; i++) {
+      *hash ^= buffer[i];
+      *hash *= 1099511628211ULL;
+    }
+  }
+
+  return ferror(file) ? -1 : 0;
+}
+
+static int findBuildNote(struct dl_phdr_info *info, size_t size, void *data) {
+  uint64_t *id = data;
+  const uint8_t *pos, *end;
+  const ElfW(Nhdr) *note;
+  size_t nameLen, descLen, i;
+  int j;
+
+  // the executable is reported first
+  for (j = 0; j < info->dlpi_phnum; j++) {
+    if (info->dlpi_phdr[j].p_type != PT_NOTE) {
+      continue;
+    }
+
+    pos = (const uint8_t *) (info->dlpi_addr + info->dlpi_phdr[j].p_vaddr);
+    end = pos + info->dlpi_phdr[j].p_memsz;
+    while (pos + sizeof(ElfW(Nhdr)) <= end) {
+      note = (const ElfW(Nhdr) *) pos;
+      nameLen = (note->n_namesz + 3) & ~3;
+      descLen = (note->n_descsz + 3) & ~3;
+      pos += sizeof(ElfW(Nhdr));
+      if (pos + nameLen + descLen > end) {
+        break;
+      }
+
+      if (note->n_type == NT_GNU_BUILD_ID && note->n_namesz == 4 && memcmp(pos, "GNU", 4) == 0) {
+        // FNV-1a 64, same as the XML hash
+        *id = 14695981039346656037ULL;
+        for (i = 0; i < note->n_descsz; i++) {
+          *id ^= pos[nameLen + i];
+          *id *= 1099511628211ULL;
+        }
+        return 1;
+      }
+      pos += nameLen + descLen;
+    }
+  }
+
+  return 1;
+}
+
+static uint64_t getBuildId(void) {
+  static uint64_t id = 0;
+  FILE *file;
+
+  if (id != 0) {
+    return id;
+  }
+
+  // the linker's build id note, hash the executable if it was linked without
+  dl_iterate_phdr(findBuildNote, &id);
+  if (id == 0 && (file = fopen("/proc/self/exe", "r")) != NULL) {
+    if (hashStream(file, &id)) {
+      id = 0;
+    }
+    fclose(file);
+  }
+
+  return id;
+}
+
+static void initHeader(LCMBS_IMAGE_HDR_T *hdr, uint64_t xmlHash) {
+  memset(hdr, 0, sizeof(LCMBS_IMAGE_HDR_T));
+  hdr->magic = LCMBS_IMAGE_MAGIC;
+  hdr->version = LCMBS_IMAGE_VERSION;
+  hdr->xmlHash = xmlHash;
+  hdr->buildId = getBuildId();
+  hdr->recSizes[0] = sizeof(LCMBS_IMAGE_SLAVE_T);
+  hdr->recSizes[1] = sizeof(LCMBS_CONF_TCP_LSNR_T);
+  hdr->recSizes[2] = sizeof(LCMBS_IMAGE_REG_T);
+  hdr->recSizes[3] = sizeof(LCMBS_CONF_REG_PIN_T);
+  hdr->recSizes[4] = sizeof(LCMBS_CONF_REG_BIT_PIN_T);
+  hdr->recSizes[5] = sizeof(LCMBS_CONF_BIT_PIN_T);
+  hdr->recSizes[6] = sizeof(LCMBS_CONF_UNIX_LSNR_T);
+  hdr->recSizes[7] = sizeof(LCMBS_CONF_UDP_LSNR_T);
+  hdr->recSizes[8] = sizeof(LCMBS_CONF_TLS_LSNR_T);
+  hdr->recSizes[9] = sizeof(LCMBS_CONF_FIFO_T);
+  hdr->recSizes[10] = sizeof(LCMBS_CONF_SAMPLE_T);
+  hdr->recSizes[11] = sizeof(LCMBS_CONF_SAMPLE_PIN_T);
+  hdr->recSizes[12] = sizeof(LCMBS_CONF_TABLE_T);
+}
+
+int lcmbsImageHashFile(const char *filename, uint64_t *hash) {
+  FILE *file;
+
+  file = fopen(filename, "r");
+  if (!file) {
+    fprintf(stderr, "%s: ERROR: unable to open config file %s\n", compName, filename);
+    return -1;
+  }
+
+  if (hashStream(file, hash)) {
+    fprintf(stderr, "%s: ERROR: Couldn't read from file %s\n", compName, filename);
+    fclose(file);
+    return -1;
+  }
+
+  fclose(file);
+  return 0;
+}
+
+static int writeRegs(FILE *file, LCMBS_CONF_REGS_T *regs) {
+  LCMBS_IMAGE_TABLE_T table;
+  LCMBS_IMAGE_REG_T rec;
+  LCMBS_CONF_REG_PIN_T pin;
+  LCMBS_CONF_REG_BIT_PIN_T bitpin;
+  size_t i, j;
+
+  table.regCount = regs->regs.count;
+  table.pinCount = regs->pins.count;
+  if (fwrite(&table, sizeof(table), 1, file) != 1) {
+    return -1;
+  }
+
+  for (i = 0; i < regs->regs.count; i++) {
+    LCMBS_CONF_REG_T *reg = lcmbsVectGet(&regs->regs, i);
+    memset(&rec, 0, sizeof(rec));
+    rec.addr = reg->addr;
+    rec.index = reg->index;
+    rec.vreg = reg->vreg;
+    rec.hasPin = reg->pin != NULL;
+    rec.bitpinCount = reg->bitpins != NULL ? reg->bitpins->count : -1;
+    if (fwrite(&rec, sizeof(rec), 1, file) != 1) {
+      return -1;
+    }
+
+    if (reg->bitpins != NULL) {
+      for (j = 0; j < reg->bitpins->count; j++) {
+        bitpin = *((LCMBS_CONF_REG_BIT_PIN_T *) lcmbsVectGet(reg->bitpins, j));
+        bitpin.pin = NULL;
+        if (fwrite(&bitpin, sizeof(bitpin), 1, file) != 1) {
+          return -1;
+        }
+      }
+    }
+  }
+
+  for (i = 0; i < regs->pins.count; i++) {
+    pin = *((LCMBS_CONF_REG_PIN_T *) lcmbsVectGet(&regs->pins, i));
+    memset(&pin.pin, 0, sizeof(pin.pin));
+    if (fwrite(&pin, sizeof(pin), 1, file) != 1) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int writeBits(FILE *file, LCMBS_CONF_BITS_T *bits) {
+  LCMBS_IMAGE_TABLE_T table;
+  LCMBS_CONF_BIT_PIN_T pin;
+  size_t i;
+
+  table.regCount = 0;
+  table.pinCount = bits->pins.count;
+  if (fwrite(&table, sizeof(table), 1, file) != 1) {
+    return -1;
+  }
+
+  for (i = 0; i < bits->pins.count; i++) {
+    pin = *((LCMBS_CONF_BIT_PIN_T *) lcmbsVectGet(&bits->pins, i));
+    pin.pin = NULL;
+    if (fwrite(&pin, sizeof(pin), 1, file) != 1) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int writeFifos(FILE *file, LCMBS_CONF_FIFOS_T *fifos) {
+  LCMBS_CONF_FIFO_T fifo;
+  size_t i;
+
+  for (i = 0; i < fifos->queues.count; i++) {
+    fifo = *((LCMBS_CONF_FIFO_T *) lcmbsVectGet(&fifos->queues, i));
+    memset(&fifo.value, 0, sizeof(fifo.value));
+    fifo.strobe = NULL;
+    fifo.count = NULL;
+    fifo.overruns = NULL;
+    fifo.ring = NULL;
+    fifo.event = -1;
+    if (fwrite(&fifo, sizeof(fifo), 1, file) != 1) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int writeSamples(FILE *file, LCMBS_VECT_T *samples) {
+  LCMBS_IMAGE_TABLE_T table;
+  LCMBS_CONF_SAMPLE_T sample;
+  LCMBS_CONF_SAMPLE_PIN_T pin;
+  size_t i, j;
+
+  for (i = 0; i < samples->count; i++) {
+    LCMBS_CONF_SAMPLE_T *src = lcmbsVectGet(samples, i);
+    sample = *src;
+
+    table.regCount = 0;
+    table.pinCount = sample.pins.count;
+    if (fwrite(&table, sizeof(table), 1, file) != 1) {
+      return -1;
+    }
+
+    memset(&sample.pins, 0, sizeof(sample.pins));
+    sample.trigger = NULL;
+    sample.arm = NULL;
+    sample.ring = NULL;
+    if (fwrite(&sample, sizeof(sample), 1, file) != 1) {
+      return -1;
+    }
+
+    for (j = 0; j < table.pinCount; j++) {
+      pin = *((LCMBS_CONF_SAMPLE_PIN_T *) lcmbsVectGet(&src->pins, j));
+      memset(&pin.pin, 0, sizeof(pin.pin));
+      if (fwrite(&pin, sizeof(pin), 1, file) != 1) {
+        return -1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+static int writeTables(FILE *file, LCMBS_CONF_TABLES_T *tables) {
+  LCMBS_CONF_TABLE_T table;
+  size_t i;
+
+  for (i = 0; i < tables->tables.count; i++) {
+    table = *((LCMBS_CONF_TABLE_T *) lcmbsVectGet(&tables->tables, i));
+    table.pins = NULL;
+    table.commits = NULL;
+    table.staged = 0;
+    table.staging = NULL;
+    if (fwrite(&table, sizeof(table), 1, file) != 1) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int writeSlave(FILE *file, LCMBS_CONF_SLAVE_T *slave) {
+  LCMBS_IMAGE_SLAVE_T rec;
+
+  memset(&rec, 0, sizeof(rec));
+  strcpy(rec.name, slave->name);
+  rec.halSize = slave->halSize;
+  rec.listenerCount = slave->tcpListeners.count;
+  rec.unixListenerCount = slave->unixListeners.count;
+  rec.udpListenerCount = slave->udpListeners.count;
+  rec.tlsListenerCount = slave->tlsListeners.count;
+  rec.chgEnabled = slave->chg.enabled;
+  rec.chgRegsBlockSize = slave->chg.regsBlockSize;
+  rec.chgBitsBlockSize = slave->chg.bitsBlockSize;
+  rec.cacheSize = slave->cache.size;
+  rec.coalSize = slave->coal.size;
+  rec.shm = slave->shm;
+  rec.rtx = slave->rtx;
+  rec.fifoPeriod = slave->fifos.defined ? slave->fifos.period : 0;
+  rec.fifoCount = slave->fifos.queues.count;
+  rec.sampleCount = slave->samples.count;
+  rec.tableCount = slave->tables.tables.count;
+  if (fwrite(&rec, sizeof(rec), 1, file) != 1) {
+    return -1;
+  }
+
+  if (slave->tcpListeners.count > 0 && fwrite(slave->tcpListeners.data, sizeof(LCMBS_CONF_TCP_LSNR_T), slave->tcpListeners.count, file) != slave->tcpListeners.count) {
+    return -1;
+  }
+  if (slave->unixListeners.count > 0 && fwrite(slave->unixListeners.data, sizeof(LCMBS_CONF_UNIX_LSNR_T), slave->unixListeners.count, file) != slave->unixListeners.count) {
+    return -1;
+  }
+  if (slave->udpListeners.count > 0 && fwrite(slave->udpListeners.data, sizeof(LCMBS_CONF_UDP_LSNR_T), slave->udpListeners.count, file) != slave->udpListeners.count) {
+    return -1;
+  }
+  if (slave->tlsListeners.count > 0 && fwrite(slave->tlsListeners.data, sizeof(LCMBS_CONF_TLS_LSNR_T), slave->tlsListeners.count, file) != slave->tlsListeners.count) {
+    return -1;
+  }
+
+  if (writeRegs(file, &slave->holdingRegs) || writeRegs(file, &slave->inputRegs)) {
+    return -1;
+  }
+
+  if (writeBits(file, &slave->inputs) || writeBits(file, &slave->coils)) {
+    return -1;
+  }
+
+  if (writeFifos(file, &slave->fifos) || writeSamples(file, &slave->samples) || writeTables(file, &slave->tables)) {
+    return -1;
+  }
+
+  return 0;
+}
+
+int lcmbsImageWrite(LCMBS_CONF_T *conf, const char *filename, uint64_t xmlHash) {
+  LCMBS_IMAGE_HDR_T hdr;
+  char tmpname[4096];
+  FILE *file;
+  size_t i;
+
+  // write to a temporary file and rename it, so a crash
+  // never leaves a partial image behind
+  if (snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename) >= sizeof(tmpname)) {
+    fprintf(stderr, "%s: ERROR: config image file name too long\n", compName);
+    goto fail0;
+  }
+
+  file = fopen(tmpname, "w");
+  if (!file) {
+    fprintf(stderr, "%s: ERROR: unable to create config image %s\n", compName, tmpname);
+    goto fail0;
+  }
+
+  initHeader(&hdr, xmlHash);
+  hdr.slaveCount = conf->slaves.count;
+  if (fwrite(&hdr, sizeof(hdr), 1, file) != 1) {
+    goto fail1;
+  }
+
+  for (i = 0; i < conf->slaves.count; i++) {
+    if (writeSlave(file, lcmbsVectGet(&conf->slaves, i))) {
+      goto fail1;
+    }
+  }
+
+  if (fclose(file)) {
+    file = NULL;
+    goto fail1;
+  }
+
+  if (rename(tmpname, filename)) {
+    fprintf(stderr, "%s: ERROR: unable to rename config image to %s\n", compName, filename);
+    goto fail2;
+  }
+
+  return 0;
+
+fail1:
+  fprintf(stderr, "%s: ERROR: Couldn't write config image %s\n", compName, tmpname);
+  if (file) {
+    fclose(file);
+  }
+fail2:
+  unlink(tmpname);
+fail0:
+  return -1;
+}
+
+static const void *take(LCMBS_IMAGE_CURSOR_T *cur, size_t len) {
+  const void *p = cur->pos;
+
+  if ((size_t) (cur->end - cur->pos) < len) {
+    return NULL;
+  }
+
+  cur->pos += len;
+  return p;
+}
+
+// records are only trusted as far as the XML parser would have
+// produced them, anything else falls back to parsing the XML
+static int checkPinType(int type, hal_type_t halType, int regCount) {
+  switch (type) {
+    case LCMBS_PINTYPE_U16:
+      return (halType == HAL_U32 && regCount == 1) ? 0 : -1;
+    case LCMBS_PINTYPE_S16:
+      return (halType == HAL_S32 && regCount == 1) ? 0 : -1;
+    case LCMBS_PINTYPE_U32:
+      return (halType == HAL_U32 && regCount == 2) ? 0 : -1;
+    case LCMBS_PINTYPE_S32:
+      return (halType == HAL_S32 && regCount == 2) ? 0 : -1;
+    case LCMBS_PINTYPE_FLOAT:
+      return (halType == HAL_FLOAT && regCount == 2) ? 0 : -1;
+    case LCMBS_PINTYPE_BIT:
+      return (halType == HAL_BIT && regCount == 1) ? 0 : -1;
+  }
+
+  return -1;
+}
+
+static int checkRegPin(const LCMBS_CONF_REG_PIN_T *pin) {
+  if (pin->type == LCMBS_PINTYPE_BIT || checkPinType(pin->type, pin->halType, pin->regCount)) {
+    return -1;
+  }
+
+  if (pin->flags & ~(LCMBS_PINFLAG_BYTESWAP | LCMBS_PINFLAG_WORDSWAP)) {
+    return -1;
+  }
+
+  return 0;
+}
+
+// the registers of a pin follow each other with ascending index
+static int checkRegIndexes(LCMBS_CONF_REGS_T *regs) {
+  LCMBS_CONF_REG_PIN_T *pin = NULL;
+  size_t i, pinIdx = 0;
+  int next = 0, addr = 0;
+
+  for (i = 0; i < regs->regs.count; i++) {
+    LCMBS_CONF_REG_T *reg = lcmbsVectGet(&regs->regs, i);
+
+    if (reg->pin == NULL) {
+      if (pin != NULL && next < pin->regCount) {
+        return -1;
+      }
+      continue;
+    }
+
+    if (reg->index == 0) {
+      if ((pin != NULL && next < pin->regCount) || pinIdx >= regs->pins.count) {
+        return -1;
+      }
+      pin = lcmbsVectGet(&regs->pins, pinIdx++);
+      next = 0;
+      addr = reg->addr;
+    }
+
+    if (pin == NULL || reg->index != next || reg->index >= pin->regCount || reg->addr != addr + next) {
+      return -1;
+    }
+    next++;
+  }
+
+  if (pin != NULL && next < pin->regCount) {
+    return -1;
+  }
+
+  return 0;
+}
+
+static int loadRegs(LCMBS_IMAGE_CURSOR_T *cur, LCMBS_CONF_T *conf, LCMBS_CONF_REGS_T *regs, const char *type) {
+  const LCMBS_IMAGE_TABLE_T *table;
+  const LCMBS_IMAGE_REG_T *rec;
+  const void *data;
+  uint32_t i, pinRefs = 0;
+  int32_t j;
+
+  if (!(table = take(cur, sizeof(LCMBS_IMAGE_TABLE_T)))) {
+    return -1;
+  }
+
+  // registers and their bit pins
+  for (i = 0; i < table->regCount; i++) {
+    LCMBS_CONF_REG_T *reg = lcmbsVectPut(&regs->regs);
+    if (!reg || !(rec = take(cur, sizeof(LCMBS_IMAGE_REG_T)))) {
+      return -1;
+    }
+    if (rec->addr < 0 || rec->addr > 0xffff || rec->index < 0 || rec->index > 1 ||
+        rec->vreg < LCMBS_VREG_NONE || rec->vreg > LCMBS_VREG_CYCLETS ||
+        rec->bitpinCount < -1 || rec->bitpinCount > 16) {
+      return -1;
+    }
+    // a register is either a pin, a bit register or virtual
+    if ((rec->hasPin != 0) + (rec->bitpinCount >= 0) + (rec->vreg != LCMBS_VREG_NONE) > 1) {
+      return -1;
+    }
+    reg->addr = rec->addr;
+    reg->index = rec->index;
+    reg->vreg = rec->vreg;
+
+    if (rec->bitpinCount >= 0) {
+      reg->bitpins = lcmbsArenaAlloc(&conf->arena, sizeof(LCMBS_VECT_T));
+      if (!reg->bitpins) {
+        return -1;
+      }
+      lcmbsVectInit(reg->bitpins, sizeof(LCMBS_CONF_REG_BIT_PIN_T));
+      for (j = 0; j < rec->bitpinCount; j++) {
+        LCMBS_CONF_REG_BIT_PIN_T *pin = lcmbsVectPut(reg->bitpins);
+        if (!pin || !(data = take(cur, sizeof(LCMBS_CONF_REG_BIT_PIN_T)))) {
+          return -1;
+        }
+        memcpy(pin, data, sizeof(LCMBS_CONF_REG_BIT_PIN_T));
+        pin->name[HAL_NAME_LEN - 1] = 0;
+        pin->pin = NULL;
+        if (pin->bit < 0 || pin->bit > 15) {
+          return -1;
+        }
+      }
+    }
+
+    // any non NULL value marks a pin register, resolved by compile
+    if (rec->hasPin) {
+      reg->pin = (LCMBS_CONF_REG_PIN_T *) rec;
+      if (rec->index == 0) {
+        pinRefs++;
+      }
+    }
+  }
+
+  // register pins
+  for (i = 0; i < table->pinCount; i++) {
+    LCMBS_CONF_REG_PIN_T *pin = lcmbsVectPut(&regs->pins);
+    if (!pin || !(data = take(cur, sizeof(LCMBS_CONF_REG_PIN_T)))) {
+      return -1;
+    }
+    memcpy(pin, data, sizeof(LCMBS_CONF_REG_PIN_T));
+    pin->name[HAL_NAME_LEN - 1] = 0;
+    memset(&pin->pin, 0, sizeof(pin->pin));
+    if (checkRegPin(pin)) {
+      return -1;
+    }
+  }
+
+  // every pin must be referenced by exactly one first register
+  if (pinRefs != table->pinCount || checkRegIndexes(regs)) {
+    return -1;
+  }
+
+  return lcmbsConfCompileRegs(conf, regs, type);
+}
+
+static int loadBits(LCMBS_IMAGE_CURSOR_T *cur, LCMBS_CONF_T *conf, LCMBS_CONF_BITS_T *bits, const char *type) {
+  const LCMBS_IMAGE_TABLE_T *table;
+  const void *data;
+  uint32_t i;
+
+  if (!(table = take(cur, sizeof(LCMBS_IMAGE_TABLE_T)))) {
+    return -1;
+  }
+
+  for (i = 0; i < table->pinCount; i++) {
+    LCMBS_CONF_BIT_PIN_T *pin = lcmbsVectPut(&bits->pins);
+    if (!pin || !(data = take(cur, sizeof(LCMBS_CONF_BIT_PIN_T)))) {
+      return -1;
+    }
+    memcpy(pin, data, sizeof(LCMBS_CONF_BIT_PIN_T));
+    pin->name[HAL_NAME_LEN - 1] = 0;
+    pin->pin = NULL;
+    if (pin->addr < 0 || pin->addr > 0xffff) {
+      return -1;
+    }
+  }
+
+  return lcmbsConfCompileBits(conf, bits, type);
+}
+
+static int loadFifos(LCMBS_IMAGE_CURSOR_T *cur, LCMBS_CONF_T *conf, LCMBS_CONF_FIFOS_T *fifos, uint32_t count) {
+  const void *data;
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    LCMBS_CONF_FIFO_T *fifo = lcmbsVectPut(&fifos->queues);
+    if (!fifo || !(data = take(cur, sizeof(LCMBS_CONF_FIFO_T)))) {
+      return -1;
+    }
+    memcpy(fifo, data, sizeof(LCMBS_CONF_FIFO_T));
+    fifo->name[HAL_NAME_LEN - 1] = 0;
+    memset(&fifo->value, 0, sizeof(fifo->value));
+    fifo->strobe = NULL;
+    fifo->count = NULL;
+    fifo->overruns = NULL;
+    fifo->ring = NULL;
+    fifo->event = -1;
+    if (fifo->addr < 0 || fifo->addr > 0xffff || fifo->size <= 0 || fifo->size > LCMBS_FIFO_SIZE_MAX ||
+        (fifo->type != LCMBS_PINTYPE_U16 && fifo->type != LCMBS_PINTYPE_S16) || checkPinType(fifo->type, fifo->halType, 1)) {
+      return -1;
+    }
+  }
+
+  return lcmbsConfCompileFifos(conf, fifos);
+}
+
+static int loadSamples(LCMBS_IMAGE_CURSOR_T *cur, LCMBS_VECT_T *samples, uint32_t count) {
+  const LCMBS_IMAGE_TABLE_T *table;
+  const void *data;
+  uint32_t i, j;
+  int frameRegs;
+
+  for (i = 0; i < count; i++) {
+    LCMBS_CONF_SAMPLE_T *sample = lcmbsVectPut(samples);
+    if (!sample || !(table = take(cur, sizeof(LCMBS_IMAGE_TABLE_T))) || !(data = take(cur, sizeof(LCMBS_CONF_SAMPLE_T)))) {
+      return -1;
+    }
+    memcpy(sample, data, sizeof(LCMBS_CONF_SAMPLE_T));
+    sample->name[HAL_NAME_LEN - 1] = 0;
+    sample->trigger = NULL;
+    sample->arm = NULL;
+    sample->ring = NULL;
+    lcmbsVectInit(&sample->pins, sizeof(LCMBS_CONF_SAMPLE_PIN_T));
+    if (sample->slots <= 0 || sample->slots > LCMBS_SAMPLE_SLOTS_MAX || table->pinCount == 0 || table->pinCount > LCMBS_SAMPLE_PINS_MAX) {
+      return -1;
+    }
+
+    frameRegs = 0;
+    for (j = 0; j < table->pinCount; j++) {
+      LCMBS_CONF_SAMPLE_PIN_T *pin = lcmbsVectPut(&sample->pins);
+      if (!pin || !(data = take(cur, sizeof(LCMBS_CONF_SAMPLE_PIN_T)))) {
+        return -1;
+      }
+      memcpy(pin, data, sizeof(LCMBS_CONF_SAMPLE_PIN_T));
+      pin->name[HAL_NAME_LEN - 1] = 0;
+      memset(&pin->pin, 0, sizeof(pin->pin));
+      if (checkPinType(pin->type, pin->halType, pin->regCount)) {
+        return -1;
+      }
+      frameRegs += pin->regCount;
+    }
+
+    // the ring is sized from the frame, it must match the pins
+    if (sample->frameRegs != frameRegs ||
+        sample->dataFiles != ((size_t) sample->slots * frameRegs + LCMBS_SAMPLE_FILE_RECORDS - 1) / LCMBS_SAMPLE_FILE_RECORDS) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int loadTables(LCMBS_IMAGE_CURSOR_T *cur, LCMBS_CONF_TABLES_T *tables, uint32_t count) {
+  const void *data;
+  uint32_t i;
+
+  for (i = 0; i < count; i++) {
+    LCMBS_CONF_TABLE_T *table = lcmbsVectPut(&tables->tables);
+    if (!table || !(data = take(cur, sizeof(LCMBS_CONF_TABLE_T)))) {
+      return -1;
+    }
+    memcpy(table, data, sizeof(LCMBS_CONF_TABLE_T));
+    table->name[HAL_NAME_LEN - 1] = 0;
+    table->pins = NULL;
+    table->commits = NULL;
+    table->staged = 0;
+    table->staging = NULL;
+    if (table->type == LCMBS_PINTYPE_BIT || checkPinType(table->type, table->halType, table->regCount) || table->size <= 0 || table->records != table->size * table->regCount ||
+        table->records > LCMBS_TABLE_RECORDS_MAX || table->files < 1 || table->files > 2) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int loadSlave(LCMBS_IMAGE_CURSOR_T *cur, LCMBS_CONF_T *conf) {
+  const LCMBS_IMAGE_SLAVE_T *rec;
+  const void *data;
+  LCMBS_CONF_SLAVE_T *slave;
+  size_t arenaUsed;
+  uint32_t i;
+
+  if (!(rec = take(cur, sizeof(LCMBS_IMAGE_SLAVE_T)))) {
+    return -1;
+  }
+
+  slave = lcmbsConfAddSlave(conf);
+  if (!slave) {
+    return -1;
+  }
+  arenaUsed = conf->arena.used;
+
+  memcpy(slave->name, rec->name, HAL_NAME_LEN);
+  slave->name[HAL_NAME_LEN - 1] = 0;
+  slave->halSize = rec->halSize;
+  slave->chg.enabled = rec->chgEnabled;
+  slave->chg.regsBlockSize = rec->chgRegsBlockSize;
+  slave->chg.bitsBlockSize = rec->chgBitsBlockSize;
+  slave->cache.size = rec->cacheSize;
+  slave->coal.size = rec->coalSize;
+  slave->shm = rec->shm;
+  slave->shm.name[LCMBS_SHM_NAME_LEN - 1] = 0;
+  slave->rtx = rec->rtx;
+  slave->fifos.defined = rec->fifoPeriod > 0;
+  slave->fifos.period = rec->fifoPeriod;
+
+  for (i = 0; i < rec->listenerCount; i++) {
+    LCMBS_CONF_TCP_LSNR_T *listener = lcmbsVectPut(&slave->tcpListeners);
+    if (!listener || !(data = take(cur, sizeof(LCMBS_CONF_TCP_LSNR_T)))) {
+      return -1;
+    }
+    memcpy(listener, data, sizeof(LCMBS_CONF_TCP_LSNR_T));
+    listener->highPriorityClients[LCMBS_PRIO_ADDRS_LEN - 1] = 0;
+  }
+
+  for (i = 0; i < rec->unixListenerCount; i++) {
+    LCMBS_CONF_UNIX_LSNR_T *listener = lcmbsVectPut(&slave->unixListeners);
+    if (!listener || !(data = take(cur, sizeof(LCMBS_CONF_UNIX_LSNR_T)))) {
+      return -1;
+    }
+    memcpy(listener, data, sizeof(LCMBS_CONF_UNIX_LSNR_T));
+    listener->path[LCMBS_UNIX_PATH_LEN - 1] = 0;
+  }
+
+  for (i = 0; i < rec->udpListenerCount; i++) {
+    LCMBS_CONF_UDP_LSNR_T *listener = lcmbsVectPut(&slave->udpListeners);
+    if (!listener || !(data = take(cur, sizeof(LCMBS_CONF_UDP_LSNR_T)))) {
+      return -1;
+    }
+    memcpy(listener, data, sizeof(LCMBS_CONF_UDP_LSNR_T));
+    if (listener->batch < 1 || listener->batch > LCMBS_UDP_BATCH_MAX) {
+      return -1;
+    }
+  }
+
+  for (i = 0; i < rec->tlsListenerCount; i++) {
+    LCMBS_CONF_TLS_LSNR_T *listener = lcmbsVectPut(&slave->tlsListeners);
+    if (!listener || !(data = take(cur, sizeof(LCMBS_CONF_TLS_LSNR_T)))) {
+      return -1;
+    }
+    memcpy(listener, data, sizeof(LCMBS_CONF_TLS_LSNR_T));
+    listener->cert[LCMBS_TLS_PATH_LEN - 1] = 0;
+    listener->key[LCMBS_TLS_PATH_LEN - 1] = 0;
+    listener->ca[LCMBS_TLS_PATH_LEN - 1] = 0;
+    listener->readRoles[LCMBS_TLS_ROLES_LEN - 1] = 0;
+    listener->writeRoles[LCMBS_TLS_ROLES_LEN - 1] = 0;
+  }
+
+  if (loadRegs(cur, conf, &slave->holdingRegs, "holdingRegisters") || loadRegs(cur, conf, &slave->inputRegs, "inputRegisters")) {
+    return -1;
+  }
+
+  if (loadBits(cur, conf, &slave->inputs, "inputs") || loadBits(cur, conf, &slave->coils, "coils")) {
+    return -1;
+  }
+
+  if (loadFifos(cur, conf, &slave->fifos, rec->fifoCount) || loadSamples(cur, &slave->samples, rec->sampleCount) ||
+      loadTables(cur, &slave->tables, rec->tableCount)) {
+    return -1;
+  }
+
+  if (lcmbsConfSetupSlave(conf, slave)) {
+    return -1;
+  }
+
+  slave->confSize = conf->arena.used - arenaUsed;
+  return 0;
+}
+
+LCMBS_CONF_T *lcmbsImageLoad(const char *filename, uint64_t xmlHash) {
+  LCMBS_IMAGE_HDR_T expected;
+  const LCMBS_IMAGE_HDR_T *hdr;
+  LCMBS_IMAGE_CURSOR_T cur;
+  LCMBS_CONF_T *conf = NULL;
+  struct stat st;
+  void *map;
+  uint32_t i;
+  int fd;
+
+  // a missing image is not an error
+  fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    goto fail0;
+  }
+
+  if (fstat(fd, &st) || st.st_size < sizeof(LCMBS_IMAGE_HDR_T)) {
+    goto fail1;
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    goto fail1;
+  }
+  cur.pos = map;
+  cur.end = cur.pos + st.st_size;
+
+  // check image matches XML and build
+  hdr = take(&cur, sizeof(LCMBS_IMAGE_HDR_T));
+  initHeader(&expected, xmlHash);
+  expected.slaveCount = hdr->slaveCount;
+  if (memcmp(hdr, &expected, sizeof(LCMBS_IMAGE_HDR_T)) != 0) {
+    goto fail2;
+  }
+
+  conf = lcmbsConfAlloc();
+  if (!conf) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for config\n", compName);
+    goto fail2;
+  }
+
+  for (i = 0; i < hdr->slaveCount; i++) {
+    if (loadSlave(&cur, conf)) {
+      goto fail3;
+    }
+  }
+
+  if (cur.pos != cur.end || lcmbsConfFinish(conf)) {
+    goto fail3;
+  }
+
+  munmap(map, st.st_size);
+  close(fd);
+  return conf;
+
+fail3:
+  fprintf(stderr, "%s: WARNING: Invalid config image %s, ignoring it\n", compName, filename);
+  lcmbsConfFree(conf);
+  conf = NULL;
+fail2:
+  munmap(map, st.st_size);
+fail1:
+  close(fd);
+fail0:
+  return conf;
+}
+
@@ -0,0 +1,16 @@
+#ifndef _LCMBS_IMAGE_H
+#define _LCMBS_IMAGE_H
+
+#include <stdint.h>
+
+#include "mbslave_conf.h"
+
+#define LCMBS_IMAGE_MAGIC   0x4953424d
+#define LCMBS_IMAGE_VERSION 13
+
+int lcmbsImageHashFile(const char *filename, uint64_t *hash);
+int lcmbsImageWrite(LCMBS_CONF_T *conf, const char *filename, uint64_t xmlHash);
+LCMBS_CONF_T *lcmbsImageLoad(const char *filename, uint64_t xmlHash);
+
+#endif
+
@@ -4,16 +4,86 @@
 #include <signal.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
+#include <getopt.h>
 #include <sys/eventfd.h>
+#include <sys/select.h>
 
 #include "mbslave_util.h"
 #include "mbslave_conf.h"
 #include "mbslave_tcp.h"
+#include "mbslave_udp.h"
+#include "mbslave_image.h"
+#include "mbslave_shm.h"
+#include "mbslave_trace.h"
+#include "mbslave_capture.h"
+#include "mbslave_fifo.h"
+#include "mbslave_sample.h"
+#include "mbslave_diag.h"
+#include "mbslave_rtx.h"
+#include "mbslave_gen.h"
 
 const char *compName = "mbslave";
 
+typedef struct {
+  hal_type_t type;
+  hal_pin_dir_t dir;
+  void **pin;
+  uint32_t bound;
+} LCMBS_RUN_PIN_T;
+
+typedef struct {
+  char name[HAL_NAME_LEN];
+  LCMBS_RCU_T conf;
+  LCMBS_HSET_T pins;
+  uint32_t bindPass;
+  LCMBS_ARENA_T arena;
+  LCMBS_VECT_T servers;
+  LCMBS_VECT_T udpServers;
+  LCMBS_SHM_DATA_T *shm;
+  LCMBS_HSET_T fifoRings;
+  LCMBS_FIFO_DATA_T *fifo;
+  LCMBS_HSET_T samples;
+  LCMBS_DIAG_T diag;
+  LCMBS_TCP_PRIO_T prio;
+  LCMBS_RTX_T *rtx;
+} LCMBS_RUN_SLAVE_T;
+
+typedef int (*LCMBS_PIN_FUNC_T)(LCMBS_RUN_SLAVE_T *run, const char *name, hal_type_t type, hal_pin_dir_t dir, void ***pin, void *arg);
+
 static int compId;
 static int exitEvent;
+static int reloadEvent;
+
+static LCMBS_VECT_T runSlaves;
+
+static char pinName[HAL_NAME_LEN + 1];
+static size_t pinPrefixLen;
+
+static const char *imageFile;
+static const char *traceFile = LCMBS_TRACE_FILE_DEFAULT;
+static int traceThreshold;
+static const char *captureFile;
+static const char *generateFile;
+static const char *handlersFile;
+static LCMBS_GEN_T *handlers;
+static int handlersValid;
+
+static uint64_t timeParse;
+static uint64_t timeHalMalloc;
+static uint64_t timeExport;
+static uint64_t timeListen;
+
+static const struct option longOptions[] = {
+  { "stats", no_argument, NULL, 's' },
+  { "cache", required_argument, NULL, 'c' },
+  { "trace", required_argument, NULL, 't' },
+  { "trace-threshold", required_argument, NULL, 'T' },
+  { "capture", required_argument, NULL, 'C' },
+  { "generate", required_argument, NULL, 'g' },
+  { "handlers", required_argument, NULL, 'H' },
+  { NULL, 0, NULL, 0 }
+};
 
 static void sigtermHandler(int sig) {
   uint64_t u = 1;
@@ -22,48 +92,68 @@ static void sigtermHandler(int sig) {
   }
 }
 
-int exportRegPins(LCMBS_CONF_SLAVE_T *slave, void **halData, LCMBS_CONF_REGS_T *regs, hal_pin_dir_t dir, const char *type) {
+static void sighupHandler(int sig) {
+  uint64_t u = 1;
+  if (write(reloadEvent, &u, sizeof(uint64_t)) < 0) {
+    fprintf(stderr, "%s: ERROR: error writing reload event\n", compName);
+  }
+}
+
+static void sigusr1Handler(int sig) {
+  lcmbsTraceTrigger();
+}
+
+void setPinPrefix(LCMBS_CONF_SLAVE_T *slave) {
+  // format common name part only once per slave
+  pinPrefixLen = snprintf(pinName, sizeof(pinName), "%s.%s.", compName, slave->name);
+}
+
+int formatPinName(const char *name) {
+  size_t len = strlen(name);
+
+  if (pinPrefixLen + len >= sizeof(pinName)) {
+    return -1;
+  }
+
+  memcpy(pinName + pinPrefixLen, name, len + 1);
+  return 0;
+}
+
+int newPin(const char *name, hal_type_t type, hal_pin_dir_t dir, void **pin) {
+  if (formatPinName(name)) {
+    return -1;
+  }
+
+  return hal_pin_new(pinName, type, dir, pin, compId);
+}
+
+void **newRtxPin(LCMBS_RTX_T *rtx, const char *name, hal_type_t type, hal_pin_dir_t dir) {
+  if (formatPinName(name)) {
+    return NULL;
+  }
+
+  // mbslave_rt exports the pin once loaded
+  return lcmbsRtxAddPin(rtx, pinName, type, dir);
+}
+
+int forEachRegPin(LCMBS_RUN_SLAVE_T *run, LCMBS_CONF_REGS_T *regs, hal_pin_dir_t dir, LCMBS_PIN_FUNC_T func, void *arg) {
   int i, j;
 
-  // export normal register pins
+  // normal register pins
   for (i = 0; i < regs->pins.count; i++) {
     LCMBS_CONF_REG_PIN_T *pin = lcmbsVectGet(&regs->pins, i);
-    int ret;
-    switch (pin->halType) {
-      case HAL_U32:
-        pin->pin.u = (hal_u32_t **) *halData;
-        *halData += sizeof(hal_u32_t *);
-        ret = hal_pin_u32_newf(dir, pin->pin.u, compId, "%s.%s.%s", compName, slave->name, pin->name);
-        break;
-      case HAL_S32:
-        pin->pin.s = (hal_s32_t **) *halData;
-        *halData += sizeof(hal_s32_t *);
-        ret = hal_pin_s32_newf(dir, pin->pin.s, compId, "%s.%s.%s", compName, slave->name, pin->name);
-        break;
-      case HAL_FLOAT:
-        pin->pin.f = (hal_float_t **) *halData;
-        *halData += sizeof(hal_float_t *);
-        ret = hal_pin_float_newf(dir, pin->pin.f, compId, "%s.%s.%s", compName, slave->name, pin->name);
-        break;
-      default:
-        ret = 0;
-    }
-    if (ret) {
-      fprintf(stderr, "%s: ERROR: Unable to export %s pin %s.%s.\n", compName, type, slave->name, pin->name);
+    if (func(run, pin->name, pin->halType, dir, (void ***) &pin->pin.u, arg)) {
       return -1;
     }
   }
 
-  // export bit mapped pins
+  // bit mapped pins
   for (i = 0; i < regs->regs.count; i++) {
     LCMBS_CONF_REG_T *reg = lcmbsVectGet(&regs->regs, i);
     if (reg->bitpins != NULL) {
       for (j = 0; j < reg->bitpins->count; j++) {
         LCMBS_CONF_REG_BIT_PIN_T *pin = lcmbsVectGet(reg->bitpins, j);
-        pin->pin = (hal_bit_t **) *halData;
-        *halData += sizeof(hal_bit_t *);
-        if (hal_pin_bit_newf(dir, pin->pin, compId, "%s.%s.%s", compName, slave->name, pin->name)) {
-          fprintf(stderr, "%s: ERROR: Unable to export %s pin %s.%s.\n", compName, type, slave->name, pin->name);
+        if (func(run, pin->name, HAL_BIT, dir, (void ***) &pin->pin, arg)) {
           return -1;
         }
       }
@@ -73,15 +163,12 @@ int exportRegPins(LCMBS_CONF_SLAVE_T *slave, void **halData, LCMBS_CONF_REGS_T *
   return 0;
 }
 
-int exportBitPins(LCMBS_CONF_SLAVE_T *slave, void **halData, LCMBS_CONF_BITS_T *bits, hal_pin_dir_t dir, const char *type) {
+int forEachBitPin(LCMBS_RUN_SLAVE_T *run, LCMBS_CONF_BITS_T *bits, hal_pin_dir_t dir, LCMBS_PIN_FUNC_T func, void *arg) {
   int i;
 
   for (i = 0; i < bits->pins.count; i++) {
     LCMBS_CONF_BIT_PIN_T *pin = lcmbsVectGet(&bits->pins, i);
-    pin->pin = (hal_bit_t **) *halData;
-    *halData += sizeof(hal_bit_t *);
-    if (hal_pin_bit_newf(dir, pin->pin, compId, "%s.%s.%s", compName, slave->name, pin->name)) {
-      fprintf(stderr, "%s: ERROR: Unable to export %s pin %s.%s.\n", compName, type, slave->name, pin->name);
+    if (func(run, pin->name, HAL_BIT, dir, (void ***) &pin->pin, arg)) {
       return -1;
     }
   }
@@ -89,18 +176,417 @@ int exportBitPins(LCMBS_CONF_SLAVE_T *slave, void **halData, LCMBS_CONF_BITS_T *
   return 0;
 }
 
-int startTcpListeners(LCMBS_CONF_SLAVE_T *slave) {
+int forEachFifoPin(LCMBS_RUN_SLAVE_T *run, LCMBS_CONF_FIFOS_T *fifos, LCMBS_PIN_FUNC_T func, void *arg) {
+  char name[HAL_NAME_LEN + 16];
+  size_t i;
+
+  // the parser made sure the suffixed names fit
+  for (i = 0; i < fifos->queues.count; i++) {
+    LCMBS_CONF_FIFO_T *fifo = lcmbsVectGet(&fifos->queues, i);
+    snprintf(name, sizeof(name), "%s.value", fifo->name);
+    if (func(run, name, fifo->halType, HAL_IN, (void ***) &fifo->value.u, arg)) {
+      return -1;
+    }
+    snprintf(name, sizeof(name), "%s.strobe", fifo->name);
+    if (func(run, name, HAL_BIT, HAL_IN, (void ***) &fifo->strobe, arg)) {
+      return -1;
+    }
+    snprintf(name, sizeof(name), "%s.count", fifo->name);
+    if (func(run, name, HAL_U32, HAL_OUT, (void ***) &fifo->count, arg)) {
+      return -1;
+    }
+    snprintf(name, sizeof(name), "%s.overruns", fifo->name);
+    if (func(run, name, HAL_U32, HAL_OUT, (void ***) &fifo->overruns, arg)) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int forEachSamplePin(LCMBS_RUN_SLAVE_T *run, LCMBS_VECT_T *samples, LCMBS_PIN_FUNC_T func, void *arg) {
+  char name[HAL_NAME_LEN + 16];
+  size_t i, j;
+
+  for (i = 0; i < samples->count; i++) {
+    LCMBS_CONF_SAMPLE_T *sample = lcmbsVectGet(samples, i);
+    for (j = 0; j < sample->pins.count; j++) {
+      LCMBS_CONF_SAMPLE_PIN_T *pin = lcmbsVectGet(&sample->pins, j);
+      if (func(run, pin->name, pin->halType, HAL_IN, (void ***) &pin->pin.u, arg)) {
+        return -1;
+      }
+    }
+
+    if (sample->mode == LCMBS_SAMPLE_TRIGGERED) {
+      snprintf(name, sizeof(name), "%s.trigger", sample->name);
+      if (func(run, name, HAL_BIT, HAL_IN, (void ***) &sample->trigger, arg)) {
+        return -1;
+      }
+      snprintf(name, sizeof(name), "%s.arm", sample->name);
+      if (func(run, name, HAL_BIT, HAL_IN, (void ***) &sample->arm, arg)) {
+        return -1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+int forEachTablePin(LCMBS_RUN_SLAVE_T *run, LCMBS_CONF_TABLES_T *tables, LCMBS_PIN_FUNC_T func, void *arg) {
+  char name[HAL_NAME_LEN + 16];
+  size_t i;
+  int j;
+
+  for (i = 0; i < tables->tables.count; i++) {
+    LCMBS_CONF_TABLE_T *table = lcmbsVectGet(&tables->tables, i);
+    for (j = 0; j < table->size; j++) {
+      snprintf(name, sizeof(name), "%s.%d", table->name, j);
+      if (func(run, name, table->halType, HAL_OUT, (void ***) &table->pins[j].u, arg)) {
+        return -1;
+      }
+    }
+    snprintf(name, sizeof(name), "%s.commits", table->name);
+    if (func(run, name, HAL_U32, HAL_OUT, (void ***) &table->commits, arg)) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int forEachPin(LCMBS_RUN_SLAVE_T *run, LCMBS_CONF_SLAVE_T *slave, LCMBS_PIN_FUNC_T func, void *arg) {
+  if (forEachRegPin(run, &slave->holdingRegs, HAL_IO, func, arg)) {
+    return -1;
+  }
+  if (forEachRegPin(run, &slave->inputRegs, HAL_IN, func, arg)) {
+    return -1;
+  }
+  if (forEachBitPin(run, &slave->inputs, HAL_IN, func, arg)) {
+    return -1;
+  }
+  if (forEachBitPin(run, &slave->coils, HAL_IO, func, arg)) {
+    return -1;
+  }
+  if (forEachFifoPin(run, &slave->fifos, func, arg)) {
+    return -1;
+  }
+  if (forEachSamplePin(run, &slave->samples, func, arg)) {
+    return -1;
+  }
+  if (forEachTablePin(run, &slave->tables, func, arg)) {
+    return -1;
+  }
+  return 0;
+}
+
+int bindPin(LCMBS_RUN_SLAVE_T *run, const char *name, hal_type_t type, hal_pin_dir_t dir, void ***pin, void *arg) {
+  LCMBS_RUN_PIN_T *exported = lcmbsHsetGet(&run->pins, name);
+  size_t *halSize = (size_t *) arg;
+
+  // new pins need hal memory
+  if (exported == NULL) {
+    if (run->rtx != NULL) {
+      fprintf(stderr, "%s: ERROR: Pin %s.%s added to realtime slave, restart required.\n", compName, run->name, name);
+      return -1;
+    }
+    *halSize += sizeof(void *);
+    return 0;
+  }
+
+  // a config binding a pin twice has a duplicate name
+  if (exported->bound == run->bindPass) {
+    fprintf(stderr, "%s: ERROR: Duplicate pin name %s.%s\n", compName, run->name, name);
+    return -1;
+  }
+  exported->bound = run->bindPass;
+
+  // HAL pins can't be changed once exported
+  if (exported->type != type || exported->dir != dir) {
+    fprintf(stderr, "%s: ERROR: Pin %s.%s changed type or direction, restart required.\n", compName, run->name, name);
+    return -1;
+  }
+
+  // reuse existing pin
+  *pin = exported->pin;
+  return 0;
+}
+
+int exportPin(LCMBS_RUN_SLAVE_T *run, const char *name, hal_type_t type, hal_pin_dir_t dir, void ***pin, void *arg) {
+  void **halData = (void **) arg;
+  LCMBS_RUN_PIN_T *exported;
+  int ret;
+
+  // skip pins bound to existing ones
+  if (*pin != NULL) {
+    return 0;
+  }
+
+  if (run->rtx != NULL) {
+    *pin = newRtxPin(run->rtx, name, type, dir);
+  } else {
+    *pin = (void **) *halData;
+    *halData += sizeof(void *);
+    if (newPin(name, type, dir, *pin)) {
+      *pin = NULL;
+    }
+  }
+  if (*pin == NULL) {
+    fprintf(stderr, "%s: ERROR: Unable to export pin %s.%s.\n", compName, run->name, name);
+    return -1;
+  }
+
+  // remember pin for later reloads, the name is hashed here anyway,
+  // so duplicates are found here and not while parsing
+  exported = lcmbsArenaAlloc(&run->arena, sizeof(LCMBS_RUN_PIN_T));
+  if (exported == NULL || (ret = lcmbsHsetPut(&run->pins, name, exported)) < 0) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for pin %s.%s.\n", compName, run->name, name);
+    return -1;
+  }
+  if (ret > 0) {
+    fprintf(stderr, "%s: ERROR: Duplicate pin name %s.%s\n", compName, run->name, name);
+    return -1;
+  }
+  exported->type = type;
+  exported->dir = dir;
+  exported->pin = *pin;
+  exported->bound = run->bindPass;
+
+  return 0;
+}
+
+int addFifoEvents(LCMBS_RUN_SLAVE_T *run, LCMBS_CONF_SLAVE_T *slave) {
+  size_t i;
+
+  // mbslave_rt latches the fifo values on the strobe edges
+  for (i = 0; i < slave->fifos.queues.count; i++) {
+    LCMBS_CONF_FIFO_T *fifo = lcmbsVectGet(&slave->fifos.queues, i);
+    if (lcmbsRtxAddEvent(run->rtx, (void **) fifo->strobe, (void **) fifo->value.u) < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int exportSlavePins(LCMBS_RUN_SLAVE_T *run, LCMBS_CONF_SLAVE_T *slave, size_t halSize) {
+  uint64_t t;
+  void *halData = NULL;
+
+  // allocate hal memory for new pins
+  t = lcmbsTimeNs();
+  if (halSize > 0 && run->rtx == NULL) {
+    halData = hal_malloc(halSize);
+    if (!halData) {
+      fprintf(stderr, "%s: ERROR: Unable alloc hal data for slave %s.\n", compName, slave->name);
+      return -1;
+    }
+  }
+  slave->halData = halData;
+  timeHalMalloc += lcmbsTimeNs() - t;
+
+  // export new pins
+  t = lcmbsTimeNs();
+  setPinPrefix(slave);
+  if (forEachPin(run, slave, exportPin, &halData)) {
+    return -1;
+  }
+  if (run->rtx != NULL && (addFifoEvents(run, slave) || lcmbsRtxPublish(run->rtx))) {
+    return -1;
+  }
+  timeExport += lcmbsTimeNs() - t;
+
+  return 0;
+}
+
+int bindFifos(LCMBS_RUN_SLAVE_T *run, LCMBS_CONF_SLAVE_T *slave) {
+  LCMBS_FIFO_RING_T *ring;
+  size_t i;
+
+  for (i = 0; i < slave->fifos.queues.count; i++) {
+    LCMBS_CONF_FIFO_T *fifo = lcmbsVectGet(&slave->fifos.queues, i);
+
+    // queued events are kept across reloads
+    ring = lcmbsHsetGet(&run->fifoRings, fifo->name);
+    if (ring != NULL) {
+      if (!lcmbsFifoRingMatches(ring, fifo)) {
+        fprintf(stderr, "%s: ERROR: Fifo %s.%s changed size or type, restart required.\n", compName, run->name, fifo->name);
+        return -1;
+      }
+      fifo->ring = ring;
+      fifo->event = (run->rtx != NULL) ? lcmbsRtxFindEvent(run->rtx, (void **) fifo->strobe, (void **) fifo->value.u) : -1;
+      continue;
+    }
+
+    ring = lcmbsFifoRingAlloc(fifo);
+    if (ring == NULL || lcmbsHsetPut(&run->fifoRings, fifo->name, ring) < 0) {
+      if (ring != NULL) {
+        lcmbsFifoRingFree(ring);
+      }
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for fifo %s.%s.\n", compName, run->name, fifo->name);
+      return -1;
+    }
+    fifo->ring = ring;
+    fifo->event = (run->rtx != NULL) ? lcmbsRtxFindEvent(run->rtx, (void **) fifo->strobe, (void **) fifo->value.u) : -1;
+
+    // losses of an earlier mbslave run are not ours
+    if (fifo->event >= 0) {
+      ring->rtLost = lcmbsRtxEventLost(run->rtx, fifo->event);
+    }
+  }
+
+  return 0;
+}
+
+int startFifos(LCMBS_RUN_SLAVE_T *run, LCMBS_CONF_SLAVE_T *slave) {
+  // one sampler per slave, started with its first queue
+  if (run->fifo != NULL || slave->fifos.queues.count == 0) {
+    return 0;
+  }
+
+  run->fifo = lcmbsFifoStart(&run->conf);
+  if (!run->fifo) {
+    fprintf(stderr, "%s: ERROR: Unable to start fifo sampler of slave %s.\n", compName, run->name);
+    return -1;
+  }
+
+  return 0;
+}
+
+void freeFifos(LCMBS_RUN_SLAVE_T *run) {
+  size_t i;
+
+  for (i = 0; i < run->fifoRings.size; i++) {
+    if (run->fifoRings.vals[i] != NULL) {
+      lcmbsFifoRingFree(run->fifoRings.vals[i]);
+    }
+  }
+  lcmbsHsetFree(&run->fifoRings);
+}
+
+int bindSamples(LCMBS_RUN_SLAVE_T *run, LCMBS_CONF_SLAVE_T *slave) {
+  LCMBS_SAMPLE_DATA_T *data;
+  size_t i;
+
+  for (i = 0; i < slave->samples.count; i++) {
+    LCMBS_CONF_SAMPLE_T *sample = lcmbsVectGet(&slave->samples, i);
+
+    // running captures keep their samples across reloads
+    data = lcmbsHsetGet(&run->samples, sample->name);
+    if (data != NULL) {
+      if (!lcmbsSampleMatches(data, sample)) {
+        fprintf(stderr, "%s: ERROR: sampleCapture %s.%s changed layout or mode, restart required.\n", compName, run->name, sample->name);
+        return -1;
+      }
+      sample->ring = data->ring;
+      continue;
+    }
+
+    data = lcmbsSampleStart(sample, &run->conf);
+    if (data == NULL) {
+      fprintf(stderr, "%s: ERROR: Unable to start sampleCapture %s.%s.\n", compName, run->name, sample->name);
+      return -1;
+    }
+    if (lcmbsHsetPut(&run->samples, sample->name, data) < 0) {
+      lcmbsSampleStop(data);
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for sampleCapture %s.%s.\n", compName, run->name, sample->name);
+      return -1;
+    }
+    sample->ring = data->ring;
+  }
+
+  return 0;
+}
+
+void stopSamples(LCMBS_RUN_SLAVE_T *run) {
+  size_t i;
+
+  for (i = 0; i < run->samples.size; i++) {
+    if (run->samples.vals[i] != NULL) {
+      lcmbsSampleStop(run->samples.vals[i]);
+    }
+  }
+  lcmbsHsetFree(&run->samples);
+}
+
+LCMBS_RUN_SLAVE_T *findRunSlave(const char *name) {
+  size_t i;
+
+  for (i = 0; i < runSlaves.count; i++) {
+    LCMBS_RUN_SLAVE_T *run = *((LCMBS_RUN_SLAVE_T **) lcmbsVectGet(&runSlaves, i));
+    if (strcmp(run->name, name) == 0) {
+      return run;
+    }
+  }
+
+  return NULL;
+}
+
+int addServer(LCMBS_RUN_SLAVE_T *run, LCMBS_TCP_SERVER_DATA_T *server) {
+  LCMBS_TCP_SERVER_DATA_T **p = lcmbsVectPut(&run->servers);
+  if (!p) {
+    lcmbsTcpStop(server);
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for listener.\n", compName);
+    return -1;
+  }
+
+  *p = server;
+  return 0;
+}
+
+int startListeners(LCMBS_RUN_SLAVE_T *run, LCMBS_CONF_SLAVE_T *slave) {
+  LCMBS_TCP_SERVER_DATA_T *server;
   int i;
 
   for (i = 0; i < slave->tcpListeners.count; i++) {
     LCMBS_CONF_TCP_LSNR_T *listener = lcmbsVectGet(&slave->tcpListeners, i);
-    LCMBS_TCP_SERVER_DATA_T *server = lcmbsTcpStart(listener);
+    server = lcmbsTcpStart(listener, &run->conf, &run->prio);
     if (!server) {
       fprintf(stderr, "%s: ERROR: Unable to start tcp listener on port %d.\n", compName, listener->port);
       return -1;
     }
+    if (addServer(run, server)) {
+      return -1;
+    }
+  }
 
-    listener->server = server;
+  for (i = 0; i < slave->unixListeners.count; i++) {
+    LCMBS_CONF_UNIX_LSNR_T *listener = lcmbsVectGet(&slave->unixListeners, i);
+    server = lcmbsUnixStart(listener, &run->conf, &run->prio);
+    if (!server) {
+      fprintf(stderr, "%s: ERROR: Unable to start unix listener on %s (%s).\n", compName, listener->path, strerror(errno));
+      return -1;
+    }
+    if (addServer(run, server)) {
+      return -1;
+    }
+  }
+
+  for (i = 0; i < slave->tlsListeners.count; i++) {
+    LCMBS_CONF_TLS_LSNR_T *listener = lcmbsVectGet(&slave->tlsListeners, i);
+    server = lcmbsTlsStart(listener, &run->conf, &run->prio);
+    if (!server) {
+      fprintf(stderr, "%s: ERROR: Unable to start tls listener on port %d.\n", compName, listener->port);
+      return -1;
+    }
+    if (addServer(run, server)) {
+      return -1;
+    }
+  }
+
+  for (i = 0; i < slave->udpListeners.count; i++) {
+    LCMBS_CONF_UDP_LSNR_T *listener = lcmbsVectGet(&slave->udpListeners, i);
+    LCMBS_UDP_SERVER_DATA_T *udpServer = lcmbsUdpStart(listener, &run->conf);
+    if (!udpServer) {
+      fprintf(stderr, "%s: ERROR: Unable to start udp listener on port %d (%s).\n", compName, listener->port, strerror(errno));
+      return -1;
+    }
+    LCMBS_UDP_SERVER_DATA_T **p = lcmbsVectPut(&run->udpServers);
+    if (!p) {
+      lcmbsUdpStop(udpServer);
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for listener.\n", compName);
+      return -1;
+    }
+    *p = udpServer;
   }
 
   return 0;
@@ -108,39 +594,74 @@ int startTcpListeners(LCMBS_CONF_SLAVE_T *slave) {
 
 int startSlaves(LCMBS_CONF_T *conf) {
   size_t i;
+  uint64_t t;
+  size_t halSize;
+
+  lcmbsVectInit(&runSlaves, sizeof(LCMBS_RUN_SLAVE_T *));
 
   for (i = 0; i < conf->slaves.count; i++) {
     LCMBS_CONF_SLAVE_T *slave = lcmbsVectGet(&conf->slaves, i);
 
-    void *halData = hal_malloc(slave->halSize);
-    if (!halData) {
-      fprintf(stderr, "%s: ERROR: Unable alloc hal data for slave %s.\n", compName, slave->name);
+    // create runtime slave, it outlives config reloads
+    LCMBS_RUN_SLAVE_T **p = lcmbsVectPut(&runSlaves);
+    if (!p || !(*p = calloc(1, sizeof(LCMBS_RUN_SLAVE_T)))) {
+      fprintf(stderr, "%s: ERROR: Couldn't allocate memory for slave %s.\n", compName, slave->name);
       return -1;
     }
-    slave->halData = halData;
+    LCMBS_RUN_SLAVE_T *run = *p;
+    strcpy(run->name, slave->name);
+    run->conf.ptr = slave;
+    slave->diag = &run->diag;
+    lcmbsHsetInit(&run->pins);
+    lcmbsHsetInit(&run->fifoRings);
+    lcmbsHsetInit(&run->samples);
+    lcmbsArenaInit(&run->arena);
+    lcmbsTcpPrioInit(&run->prio);
+    lcmbsVectInit(&run->servers, sizeof(LCMBS_TCP_SERVER_DATA_T *));
+    lcmbsVectInit(&run->udpServers, sizeof(LCMBS_UDP_SERVER_DATA_T *));
 
-    // export holding register pins
-    if (exportRegPins(slave, &halData, &slave->holdingRegs, HAL_IO, "holdingRegister")) {
+    // export pins
+    halSize = 0;
+    run->bindPass++;
+    if (forEachPin(run, slave, bindPin, &halSize)) {
       return -1;
     }
-
-    // export input register pins
-    if (exportRegPins(slave, &halData, &slave->inputRegs, HAL_IN, "inputRegister")) {
+    if (slave->rtx.enabled) {
+      // realtime slaves only publish their pin table
+      run->rtx = lcmbsRtxCreate(compId, slave->name, &slave->rtx, halSize / sizeof(void *), slave->fifos.queues.count);
+      if (!run->rtx) {
+        return -1;
+      }
+      slave->exchange = run->rtx;
+    }
+    if (exportSlavePins(run, slave, halSize)) {
       return -1;
     }
-
-    // export input pins
-    if (exportBitPins(slave, &halData, &slave->inputs, HAL_IN, "input")) {
+    if (bindFifos(run, slave) || bindSamples(run, slave)) {
+      return -1;
+    }
+    if (handlersValid && lcmbsGenBind(handlers, conf, slave)) {
       return -1;
     }
 
-    // export coil pins
-    if (exportBitPins(slave, &halData, &slave->coils, HAL_IO, "coil")) {
+    // start listeners
+    t = lcmbsTimeNs();
+    if (startListeners(run, slave)) {
       return -1;
     }
+    timeListen += lcmbsTimeNs() - t;
+
+    // start shared memory image
+    if (slave->shm.enabled) {
+      run->shm = lcmbsShmStart(&slave->shm, &run->conf);
+      if (!run->shm) {
+        fprintf(stderr, "%s: ERROR: Unable to start shared memory image %s.\n", compName, slave->shm.name);
+        return -1;
+      }
+    }
 
-    // start TCP listeners
-    if (startTcpListeners(slave)) {
+    // start fifo sampler
+    if (startFifos(run, slave)) {
       return -1;
     }
   }
@@ -148,38 +669,405 @@ int startSlaves(LCMBS_CONF_T *conf) {
   return 0;
 }
 
-void stopSlaves(LCMBS_CONF_T *conf) {
+int vectsDiffer(LCMBS_VECT_T *a, LCMBS_VECT_T *b) {
+  if (a->count != b->count) {
+    return 1;
+  }
+
+  return a->count > 0 && memcmp(a->data, b->data, a->count * a->typeSize) != 0;
+}
+
+int listenersChanged(LCMBS_CONF_SLAVE_T *old, LCMBS_CONF_SLAVE_T *slave) {
+  if (memcmp(&old->shm, &slave->shm, sizeof(LCMBS_CONF_SHM_T)) != 0 || memcmp(&old->rtx, &slave->rtx, sizeof(LCMBS_CONF_RTX_T)) != 0) {
+    return 1;
+  }
+
+  return vectsDiffer(&old->tcpListeners, &slave->tcpListeners) || vectsDiffer(&old->unixListeners, &slave->unixListeners) ||
+    vectsDiffer(&old->udpListeners, &slave->udpListeners) || vectsDiffer(&old->tlsListeners, &slave->tlsListeners);
+}
+
+int regsMatch(LCMBS_CONF_REGS_T *a, LCMBS_CONF_REGS_T *b) {
+  size_t i, j;
+
+  if (a->regs.count != b->regs.count) {
+    return 0;
+  }
+
+  // same addresses on the same HAL pins
+  for (i = 0; i < a->regs.count; i++) {
+    LCMBS_CONF_REG_T *ra = lcmbsVectGet(&a->regs, i);
+    LCMBS_CONF_REG_T *rb = lcmbsVectGet(&b->regs, i);
+    if (ra->addr != rb->addr || ra->index != rb->index || ra->vreg != rb->vreg ||
+      (ra->pin == NULL) != (rb->pin == NULL) || (ra->bitpins == NULL) != (rb->bitpins == NULL)) {
+      return 0;
+    }
+    if (ra->pin != NULL && (ra->pin->pin.u != rb->pin->pin.u || ra->pin->type != rb->pin->type || ra->pin->flags != rb->pin->flags)) {
+      return 0;
+    }
+    if (ra->bitpins == NULL) {
+      continue;
+    }
+    if (ra->bitpins->count != rb->bitpins->count) {
+      return 0;
+    }
+    for (j = 0; j < ra->bitpins->count; j++) {
+      LCMBS_CONF_REG_BIT_PIN_T *pa = lcmbsVectGet(ra->bitpins, j);
+      LCMBS_CONF_REG_BIT_PIN_T *pb = lcmbsVectGet(rb->bitpins, j);
+      if (pa->bit != pb->bit || pa->pin != pb->pin) {
+        return 0;
+      }
+    }
+  }
+
+  return 1;
+}
+
+int bitsMatch(LCMBS_CONF_BITS_T *a, LCMBS_CONF_BITS_T *b) {
+  size_t i;
+
+  if (a->pins.count != b->pins.count) {
+    return 0;
+  }
+
+  for (i = 0; i < a->pins.count; i++) {
+    LCMBS_CONF_BIT_PIN_T *pa = lcmbsVectGet(&a->pins, i);
+    LCMBS_CONF_BIT_PIN_T *pb = lcmbsVectGet(&b->pins, i);
+    if (pa->addr != pb->addr || pa->pin != pb->pin) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+void takeSlaveState(LCMBS_CONF_SLAVE_T *old, LCMBS_CONF_SLAVE_T *slave) {
+  LCMBS_CONF_CHG_T *chg = &slave->chg;
+  LCMBS_CONF_CACHE_T *cache = &slave->cache;
+  int inputsSame = regsMatch(&old->inputRegs, &slave->inputRegs) && bitsMatch(&old->inputs, &slave->inputs);
+  int holdingSame = regsMatch(&old->holdingRegs, &slave->holdingRegs);
+
+  // reloads export no pins, the block stays in use
+  slave->halData = old->halData;
+
+  // change detection goes on where it was, a changed
+  // layout counts as change and takes a new snapshot
+  if (chg->enabled && old->chg.enabled) {
+    pthread_mutex_lock(&old->chg.lock);
+    if (inputsSame && chg->regsBlockSize == old->chg.regsBlockSize && chg->bitsBlockSize == old->chg.bitsBlockSize) {
+      chg->valid = old->chg.valid;
+      chg->counter = old->chg.counter;
+      chg->regsMap = old->chg.regsMap;
+      chg->bitsMap = old->chg.bitsMap;
+      memcpy(chg->regsSnap, old->chg.regsSnap, slave->inputRegs.regs.count * sizeof(uint32_t));
+      memcpy(chg->bitsSnap, old->chg.bitsSnap, slave->inputs.pins.count * sizeof(uint8_t));
+    } else {
+      chg->counter = old->chg.counter + 1;
+      chg->regsMap = 0xffff;
+      chg->bitsMap = 0xffff;
+    }
+    pthread_mutex_unlock(&old->chg.lock);
+  }
+
+  // cached responses stay valid on the same register map,
+  // hits still compare the pin values
+  if (cache->size > 0 && cache->size == old->cache.size && inputsSame && holdingSame) {
+    pthread_mutex_lock(&old->cache.lock);
+    memcpy(cache->entries, old->cache.entries, cache->size * sizeof(LCMBS_CONF_CACHE_ENTRY_T));
+    slave->holdingRegs.gen = __atomic_load_n(&old->holdingRegs.gen, __ATOMIC_RELAXED);
+    slave->inputRegs.gen = __atomic_load_n(&old->inputRegs.gen, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&old->cache.lock);
+  }
+}
+
+int tablesMatch(LCMBS_CONF_TABLE_T *a, LCMBS_CONF_TABLE_T *b) {
+  return a->file == b->file && a->type == b->type && a->size == b->size && a->commit == b->commit &&
+    memcmp(a->pins, b->pins, a->size * sizeof(LCMBS_CONF_TABLE_PIN_T)) == 0;
+}
+
+void takeTableStaging(LCMBS_CONF_SLAVE_T *old, LCMBS_CONF_SLAVE_T *slave) {
   size_t i, j;
 
+  // the old config has no readers left, only
+  // requests on the new one may stage meanwhile
+  pthread_mutex_lock(&slave->tables.lock);
+  for (i = 0; i < slave->tables.tables.count; i++) {
+    LCMBS_CONF_TABLE_T *table = lcmbsVectGet(&slave->tables.tables, i);
+    for (j = 0; j < old->tables.tables.count; j++) {
+      LCMBS_CONF_TABLE_T *prev = lcmbsVectGet(&old->tables.tables, j);
+      if (strcmp(prev->name, table->name) == 0) {
+        if (prev->staged && !table->staged && tablesMatch(prev, table)) {
+          memcpy(table->staging, prev->staging, table->records * sizeof(uint16_t));
+          __atomic_store_n(&table->staged, 1, __ATOMIC_RELAXED);
+        }
+        break;
+      }
+    }
+  }
+  pthread_mutex_unlock(&slave->tables.lock);
+}
+
+LCMBS_CONF_T *loadConf(const char *filename) {
+  LCMBS_CONF_T *conf;
+  uint64_t hash;
+
+  if (!imageFile && !handlers) {
+    return lcmbsConfParse(filename);
+  }
+
+  // handler module has to be generated from this very file
+  if (lcmbsImageHashFile(filename, &hash)) {
+    return NULL;
+  }
+  handlersValid = handlers != NULL && lcmbsGenMatches(handlers, hash);
+  if (!imageFile) {
+    return lcmbsConfParse(filename);
+  }
+
+  // try precompiled image first
+  conf = lcmbsImageLoad(imageFile, hash);
+  if (conf) {
+    return conf;
+  }
+
+  // image missing or stale, parse and rebuild it
+  conf = lcmbsConfParse(filename);
+  if (conf && lcmbsImageWrite(conf, imageFile, hash)) {
+    fprintf(stderr, "%s: WARNING: config image not updated, parsing XML on next start\n", compName);
+  }
+
+  return conf;
+}
+
+int generateHandlers(const char *filename) {
+  LCMBS_CONF_T *conf;
+  uint64_t hash;
+  int ret;
+
+  if (lcmbsImageHashFile(filename, &hash)) {
+    return -1;
+  }
+  conf = lcmbsConfParse(filename);
+  if (!conf) {
+    return -1;
+  }
+
+  ret = lcmbsGenWrite(conf, generateFile, hash);
+  lcmbsConfFree(conf);
+  return ret;
+}
+
+int reloadSlaves(const char *filename, LCMBS_CONF_T **conf) {
+  LCMBS_CONF_T *newConf;
+  size_t halSize;
+  size_t i;
+  int ret = -1;
+
+  // parse new config
+  newConf = loadConf(filename);
+  if (!newConf) {
+    goto fail0;
+  }
+
+  // slaves are bound to their listeners, so the set must not change
+  if (newConf->slaves.count != runSlaves.count) {
+    fprintf(stderr, "%s: ERROR: Slaves added or removed, restart required.\n", compName);
+    goto fail1;
+  }
+  for (i = 0; i < newConf->slaves.count; i++) {
+    LCMBS_CONF_SLAVE_T *slave = lcmbsVectGet(&newConf->slaves, i);
+    if (findRunSlave(slave->name) == NULL) {
+      fprintf(stderr, "%s: ERROR: Slave %s not running, restart required.\n", compName, slave->name);
+      goto fail1;
+    }
+  }
+
+  // bind pins by name for all slaves, HAL takes no
+  // new pins once ready, so nothing is exported
+  for (i = 0; i < newConf->slaves.count; i++) {
+    LCMBS_CONF_SLAVE_T *slave = lcmbsVectGet(&newConf->slaves, i);
+    LCMBS_RUN_SLAVE_T *run = findRunSlave(slave->name);
+    halSize = 0;
+    run->bindPass++;
+    if (forEachPin(run, slave, bindPin, &halSize)) {
+      goto fail1;
+    }
+    if (halSize > 0) {
+      fprintf(stderr, "%s: ERROR: Pins added to slave %s, restart required.\n", compName, slave->name);
+      goto fail1;
+    }
+  }
+
+  for (i = 0; i < newConf->slaves.count; i++) {
+    LCMBS_CONF_SLAVE_T *slave = lcmbsVectGet(&newConf->slaves, i);
+    LCMBS_RUN_SLAVE_T *run = findRunSlave(slave->name);
+    if (bindFifos(run, slave) || bindSamples(run, slave)) {
+      goto fail1;
+    }
+    if (handlersValid && lcmbsGenBind(handlers, newConf, slave)) {
+      goto fail1;
+    }
+    slave->diag = &run->diag;
+    slave->exchange = run->rtx;
+  }
+
+  // publish new tables, in-flight requests finish on the old ones
+  for (i = 0; i < newConf->slaves.count; i++) {
+    LCMBS_CONF_SLAVE_T *slave = lcmbsVectGet(&newConf->slaves, i);
+    LCMBS_RUN_SLAVE_T *run = findRunSlave(slave->name);
+    LCMBS_CONF_SLAVE_T *old;
+    takeSlaveState(lcmbsRcuDeref(&run->conf), slave);
+    old = lcmbsRcuPublish(&run->conf, slave);
+    takeTableStaging(old, slave);
+    if (listenersChanged(old, slave)) {
+      fprintf(stderr, "%s: WARNING: Listener or shared memory changes of slave %s require a restart.\n", compName, slave->name);
+    }
+    if (startFifos(run, slave)) {
+      fprintf(stderr, "%s: WARNING: Fifo queues of slave %s are not sampled.\n", compName, slave->name);
+    }
+  }
+
+  // no reader is left on the old config
+  lcmbsConfFree(*conf);
+  *conf = newConf;
+  newConf = NULL;
+  ret = 0;
+
+fail1:
+  lcmbsConfFree(newConf);
+fail0:
+  return ret;
+}
+
+void printStats(LCMBS_CONF_T *conf) {
+  size_t i;
+
   for (i = 0; i < conf->slaves.count; i++) {
     LCMBS_CONF_SLAVE_T *slave = lcmbsVectGet(&conf->slaves, i);
 
+    fprintf(stdout, "%s: slave %s: %u holding regs, %u input regs, %u inputs, %u coils\n", compName, slave->name,
+      (unsigned int) slave->holdingRegs.regs.count, (unsigned int) slave->inputRegs.regs.count,
+      (unsigned int) slave->inputs.pins.count, (unsigned int) slave->coils.pins.count);
+    fprintf(stdout, "%s: slave %s: %u map pages, %u bytes config, %u bytes hal\n", compName, slave->name,
+      slave->holdingRegs.map.pageCount + slave->inputRegs.map.pageCount + slave->inputs.map.pageCount + slave->coils.map.pageCount,
+      (unsigned int) slave->confSize, (unsigned int) slave->halSize);
+  }
+
+  fprintf(stdout, "%s: config arena: %u bytes used, %u bytes allocated\n", compName,
+    (unsigned int) conf->arena.used, (unsigned int) conf->arena.allocated);
+  fflush(stdout);
+}
+
+void printTimes(void) {
+  fprintf(stdout, "%s: startup: parse %.3f ms, hal_malloc %.3f ms, export %.3f ms, listener start %.3f ms\n", compName,
+    timeParse / 1e6, timeHalMalloc / 1e6, timeExport / 1e6, timeListen / 1e6);
+  fflush(stdout);
+}
+
+void stopSlaves(void) {
+  size_t i, j;
+
+  for (i = 0; i < runSlaves.count; i++) {
+    LCMBS_RUN_SLAVE_T *run = *((LCMBS_RUN_SLAVE_T **) lcmbsVectGet(&runSlaves, i));
+    if (run == NULL) {
+      continue;
+    }
+
+    // stop shared memory image
+    if (run->shm) {
+      lcmbsShmStop(run->shm);
+    }
+
+    // stop fifo sampler
+    if (run->fifo) {
+      lcmbsFifoStop(run->fifo);
+    }
+
     // stop TCP listeners
-    for (j = 0; j < slave->tcpListeners.count; j++) {
-      LCMBS_CONF_TCP_LSNR_T *listener = lcmbsVectGet(&slave->tcpListeners, j);
-      LCMBS_TCP_SERVER_DATA_T *server = (LCMBS_TCP_SERVER_DATA_T *) listener->server;
+    for (j = 0; j < run->servers.count; j++) {
+      LCMBS_TCP_SERVER_DATA_T *server = *((LCMBS_TCP_SERVER_DATA_T **) lcmbsVectGet(&run->servers, j));
+      lcmbsTcpStop(server);
+    }
 
-      if (server != NULL) {
-        lcmbsTcpStop(server);
-      }
+    // stop UDP listeners
+    for (j = 0; j < run->udpServers.count; j++) {
+      LCMBS_UDP_SERVER_DATA_T *server = *((LCMBS_UDP_SERVER_DATA_T **) lcmbsVectGet(&run->udpServers, j));
+      lcmbsUdpStop(server);
+    }
 
-      listener->server = server;
+    lcmbsVectFree(&run->servers);
+    lcmbsVectFree(&run->udpServers);
+    lcmbsTcpPrioFree(&run->prio);
+    freeFifos(run);
+    stopSamples(run);
+    if (run->rtx) {
+      lcmbsRtxFree(run->rtx, compId);
     }
+    lcmbsHsetFree(&run->pins);
+    lcmbsArenaFree(&run->arena);
+    free(run);
   }
+
+  lcmbsVectFree(&runSlaves);
 }
 
 int main(int argc, char **argv) {
   int ret = 1;
+  int stats = 0;
+  int opt;
   char *filename;
   LCMBS_CONF_T *conf;
   uint64_t u;
+  fd_set set;
+  int max_fd, traceEvent;
+
+  // parse options
+  while ((opt = getopt_long(argc, argv, "sc:t:T:C:g:H:", longOptions, NULL)) != -1) {
+    switch (opt) {
+      case 's':
+        stats = 1;
+        break;
+      case 'c':
+        imageFile = optarg;
+        break;
+      case 't':
+        traceFile = optarg;
+        break;
+      case 'T':
+        traceThreshold = atoi(optarg);
+        if (traceThreshold < 0) {
+          fprintf(stderr, "%s: ERROR: invalid trace threshold %s\n", compName, optarg);
+          goto fail0;
+        }
+        break;
+      case 'C':
+        captureFile = optarg;
+        break;
+      case 'g':
+        generateFile = optarg;
+        break;
+      case 'H':
+        handlersFile = optarg;
+        break;
+      default:
+        fprintf(stderr, "%s: ERROR: invalid arguments\n", compName);
+        goto fail0;
+    }
+  }
 
   // get config file name
-  if (argc != 2) {
+  if (optind != argc - 1) {
     fprintf(stderr, "%s: ERROR: invalid arguments\n", compName);
     goto fail0;
   }
-  filename = argv[1];
+  filename = argv[optind];
+
+  // write specialized register handlers for this config and exit
+  if (generateFile != NULL) {
+    if (generateHandlers(filename) == 0) {
+      ret = 0;
+    }
+    goto fail0;
+  }
 
   // initialize hal
   compId = hal_init(compName);
@@ -188,11 +1076,18 @@ int main(int argc, char **argv) {
     goto fail0;
   }
 
+  // load specialized register handlers, the generic ones are used without
+  if (handlersFile != NULL) {
+    handlers = lcmbsGenOpen(handlersFile);
+  }
+
   // parse config file
-  conf = lcmbsConfParse(filename);
+  timeParse = lcmbsTimeNs();
+  conf = loadConf(filename);
   if (!conf) {
     goto fail1;
   }
+  timeParse = lcmbsTimeNs() - timeParse;
 
   // create exit event
   exitEvent = eventfd(0, 0);
@@ -201,6 +1096,12 @@ int main(int argc, char **argv) {
     goto fail2;
   }
 
+  // create reload event
+  reloadEvent = eventfd(0, 0);
+  if (reloadEvent < 0) {
+    fprintf(stderr, "%s: ERROR: unable to create reload event\n", compName);
+    goto fail3;
+  }
 
   // install signal handler
   struct sigaction act;
@@ -209,28 +1110,107 @@ int main(int argc, char **argv) {
   if (sigaction(SIGTERM, &act, NULL) < 0)
   {
     fprintf(stderr, "%s: ERROR: Unable to register SIGTERM handler.", compName);
-    goto fail3;
+    goto fail4;
+  }
+  act.sa_handler = &sighupHandler;
+  if (sigaction(SIGHUP, &act, NULL) < 0)
+  {
+    fprintf(stderr, "%s: ERROR: Unable to register SIGHUP handler.", compName);
+    goto fail4;
+  }
+
+  act.sa_handler = &sigusr1Handler;
+  if (sigaction(SIGUSR1, &act, NULL) < 0)
+  {
+    fprintf(stderr, "%s: ERROR: Unable to register SIGUSR1 handler.", compName);
+    goto fail4;
+  }
+
+  // TLS connections write through OpenSSL and can't pass MSG_NOSIGNAL
+  act.sa_handler = SIG_IGN;
+  if (sigaction(SIGPIPE, &act, NULL) < 0)
+  {
+    fprintf(stderr, "%s: ERROR: Unable to ignore SIGPIPE.", compName);
+    goto fail4;
+  }
+
+  // set up request trace, dumped on SIGUSR1 and slow requests
+  if (lcmbsTraceInit(traceFile, traceThreshold)) {
+    goto fail4;
+  }
+  traceEvent = lcmbsTraceEventFd();
+
+  // record all requests for later replay
+  if (captureFile != NULL && lcmbsCaptureOpen(captureFile)) {
+    goto fail5;
   }
 
   // start slaves
   if (startSlaves(conf)) {
-    goto fail4;
+    goto fail5;
+  }
+
+  // print memory footprint
+  if (stats) {
+    printStats(conf);
+    printTimes();
   }
 
   // everything is fine
   ret = 0;
   hal_ready(compId);
 
-  // wait for SIGTERM
-  read(exitEvent, &u, sizeof(uint64_t));
+  // wait for SIGTERM, reload config on SIGHUP, dump trace on request
+  while (1) {
+    FD_ZERO(&set);
+    max_fd = -1;
+    FD_SET(exitEvent, &set);
+    if (max_fd < exitEvent) max_fd = exitEvent;
+    FD_SET(reloadEvent, &set);
+    if (max_fd < reloadEvent) max_fd = reloadEvent;
+    FD_SET(traceEvent, &set);
+    if (max_fd < traceEvent) max_fd = traceEvent;
+    if (select(max_fd + 1, &set, 0, 0, NULL) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    if (FD_ISSET(exitEvent, &set)) {
+      break;
+    }
+
+    if (FD_ISSET(traceEvent, &set)) {
+      lcmbsTraceDump();
+    }
+
+    if (FD_ISSET(reloadEvent, &set)) {
+      read(reloadEvent, &u, sizeof(uint64_t));
+      if (reloadSlaves(filename, &conf)) {
+        fprintf(stderr, "%s: ERROR: Config reload failed, keeping current config.\n", compName);
+        continue;
+      }
+      fprintf(stdout, "%s: Config reloaded.\n", compName);
+      fflush(stdout);
+      if (stats) {
+        printStats(conf);
+      }
+    }
+  }
 
+fail5:
+  stopSlaves();
+  lcmbsCaptureClose();
+  lcmbsTraceFree();
 fail4:
-  stopSlaves(conf);
+  close(reloadEvent);
 fail3:
   close(exitEvent);
 fail2:
   lcmbsConfFree(conf);
 fail1:
+  lcmbsGenClose(handlers);
   hal_exit(compId);
 fail0:
   return ret;
@@ -5,6 +5,38 @@
 #include <limits.h>
 
 #include "mbslave_prot.h"
+#include "mbslave_chg.h"
+#include "mbslave_cache.h"
+#include "mbslave_coal.h"
+#include "mbslave_fifo.h"
+#include "mbslave_sample.h"
+#include "mbslave_table.h"
+#include "mbslave_diag.h"
+#include "mbslave_rtx.h"
+
+// byte counts limit register requests to 127 words
+#define WORDS_MAX 127
+
+#define FILE_REF_TYPE    6
+#define FILE_REQ_LEN     7
+#define FILE_BYTES_MAX   0xf5
+#define FILE_WRITE_MAX   0xfb
+#define FILE_WRITES_MAX  (FILE_WRITE_MAX / (FILE_REQ_LEN + 2))
+
+#define DIAG_RETURN_QUERY_DATA     0x00
+#define DIAG_RESTART_COMM          0x01
+#define DIAG_RETURN_DIAG_REG       0x02
+#define DIAG_CLEAR_COUNTERS        0x0a
+#define DIAG_BUS_MESSAGES          0x0b
+#define DIAG_BUS_COMM_ERRORS       0x0c
+#define DIAG_BUS_EXCEPTIONS        0x0d
+#define DIAG_SLAVE_MESSAGES        0x0e
+#define DIAG_SLAVE_NO_RESPONSES    0x0f
+#define DIAG_SLAVE_NAKS            0x10
+#define DIAG_SLAVE_BUSY            0x11
+#define DIAG_BUS_OVERRUNS          0x12
+#define DIAG_CLEAR_OVERRUNS        0x14
+#define DIAG_CLEAR_LOG             0xff00
 
 typedef union {
   uint32_t u;
@@ -14,15 +46,23 @@ typedef union {
   uint8_t b[4];
 } MODBUS_VAL_T;
 
+typedef struct {
+  LCMBS_CONF_TABLE_T *table;
+  uint16_t file;
+  uint16_t record;
+  uint16_t count;
+  uint16_t *regs;
+} FILE_WRITE_T;
+
 static void writeRegBitpins(LCMBS_VECT_T *bitpins, uint16_t val) {
   int i;
   for (i = 0; i < bitpins->count; i++) {
     LCMBS_CONF_REG_BIT_PIN_T *pin = lcmbsVectGet(bitpins, i);
-    **pin->pin = (val & (1 << pin->bit)) ? 1 : 0;
+    lcmbsPinSetBit(pin->pin, (val & (1 << pin->bit)) ? 1 : 0);
   }
 }
 
-static uint16_t readRegBitpins(LCMBS_VECT_T *bitpins) {
+uint16_t lcmbsProtReadBitpins(LCMBS_VECT_T *bitpins) {
   int i;
   uint16_t val = 0;
   for (i = 0; i < bitpins->count; i++) {
@@ -34,6 +74,198 @@ static uint16_t readRegBitpins(LCMBS_VECT_T *bitpins) {
   return val;
 }
 
+uint32_t lcmbsProtReadPin(LCMBS_CONF_REG_PIN_T *pin) {
+  MODBUS_VAL_T pinval;
+
+  switch (pin->halType) {
+    case HAL_U32:
+      pinval.u = **pin->pin.u;
+      break;
+    case HAL_S32:
+      pinval.s = **pin->pin.s;
+      break;
+    case HAL_FLOAT:
+      pinval.f = **pin->pin.f;
+      break;
+    default:
+      pinval.u = 0;
+  }
+
+  return pinval.u;
+}
+
+uint32_t lcmbsProtEncodePin(LCMBS_CONF_REG_PIN_T *pin, uint32_t raw) {
+  MODBUS_VAL_T pinval;
+
+  pinval.u = raw;
+
+  // limit single word values
+  switch(pin->type) {
+    case LCMBS_PINTYPE_U16:
+      // limit range
+      if (pinval.u > USHRT_MAX) pinval.u = USHRT_MAX;
+      break;
+    case LCMBS_PINTYPE_S16:
+      // limit range
+      if (pinval.s < SHRT_MIN) pinval.s = SHRT_MIN;
+      if (pinval.s > SHRT_MAX) pinval.s = SHRT_MAX;
+      break;
+  }
+
+  // convert to network byte order
+  pinval.u = htonl(pinval.u);
+
+  // reorder words on request
+  if (pin->flags & LCMBS_PINFLAG_WORDSWAP) {
+    uint16_t tmp = pinval.w[0];
+    pinval.w[0] = pinval.w[1];
+    pinval.w[1] = tmp;
+  }
+
+  return pinval.u;
+}
+
+uint16_t lcmbsProtPinWord(LCMBS_CONF_REG_PIN_T *pin, uint32_t enc, int index) {
+  MODBUS_VAL_T pinval;
+
+  // get register value
+  pinval.u = enc;
+  uint16_t val = pinval.w[2 - pin->regCount + index];
+
+  // reorder bytes on request
+  if (pin->flags & LCMBS_PINFLAG_BYTESWAP) {
+    val = bswap_16(val);
+  }
+
+  return val;
+}
+
+static int isPlainWord(LCMBS_CONF_REG_PIN_T *pin) {
+  return pin != NULL && pin->regCount == 1 && pin->flags == 0;
+}
+
+static int collectWordRun(LCMBS_CONF_REGS_T *regs, uint16_t addr, int max, LCMBS_CONF_REG_PIN_T **pins) {
+  int n;
+
+  // the range has been checked, all registers are mapped
+  for (n = 0; n < max; n++) {
+    LCMBS_CONF_REG_T *reg = lcmbsPtabGet(&regs->map, addr + n);
+    if (!isPlainWord(reg->pin)) {
+      break;
+    }
+    pins[n] = reg->pin;
+  }
+
+  return n;
+}
+
+static uint16_t clampWord(LCMBS_CONF_REG_PIN_T *pin, uint32_t raw) {
+  int32_t s = raw;
+
+  // limit range like lcmbsProtEncodePin()
+  if (pin->type == LCMBS_PINTYPE_S16) {
+    if (s < SHRT_MIN) s = SHRT_MIN;
+    if (s > SHRT_MAX) s = SHRT_MAX;
+    return (uint16_t) s;
+  }
+
+  return raw > USHRT_MAX ? USHRT_MAX : raw;
+}
+
+static int putWords(LCMBS_VECT_T *out, const uint16_t *words, int n) {
+  if (!lcmbsVectEnsureSize(out, out->count + n * 2)) {
+    return 0;
+  }
+
+  // convert straight into the response
+  lcmbsSwapWords((uint8_t *) out->data + out->count, words, n);
+  out->count += n * 2;
+
+  return 1;
+}
+
+static int genReadRegs(LCMBS_CONF_REGS_T *regs, uint8_t sid, uint8_t fnk, uint16_t start, uint16_t count, LCMBS_VECT_T *out) {
+  int bytes = count << 1;
+  uint8_t *data;
+
+  if (!lcmbsVectEnsureSize(out, out->count + 3 + bytes)) {
+    return 0;
+  }
+
+  // registers go right behind the header
+  data = (uint8_t *) out->data + out->count;
+  if (regs->genRead(regs->genPins, start, count, data + 3)) {
+    return 0;
+  }
+  data[0] = sid;
+  data[1] = fnk;
+  data[2] = bytes;
+  out->count += 3 + bytes;
+
+  return 1;
+}
+
+static int genPresetRegs(LCMBS_CONF_REGS_T *regs, uint8_t sid, uint8_t fnk, uint16_t start, uint16_t count, LCMBS_VECT_T *in, LCMBS_VECT_T *out) {
+  // response can't fail once pins are written
+  if (!lcmbsVectEnsureSize(out, out->count + 6)) {
+    return 0;
+  }
+
+  if (regs->genWrite(regs->genPins, start, count, (uint8_t *) in->data + in->pos)) {
+    return 0;
+  }
+  in->pos += count << 1;
+
+  // invalidate cached responses
+  __sync_add_and_fetch(&regs->gen, 1);
+
+  lcmbsVectPutByte(out, sid);
+  lcmbsVectPutByte(out, fnk);
+  lcmbsVectPutWord(out, htons(start));
+  lcmbsVectPutWord(out, htons(count));
+
+  return 1;
+}
+
+static int checkBitRange(LCMBS_CONF_BITS_T *bits, uint16_t start, uint16_t count) {
+  int i;
+
+  // all addresses have to be mapped
+  if ((start + count) > 65536) {
+    return 0;
+  }
+  for (i = 0; i < count; i++) {
+    if (lcmbsPtabGet(&bits->map, start + i) == NULL) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+static int checkRegRange(LCMBS_CONF_REGS_T *regs, uint16_t start, uint16_t count) {
+  LCMBS_CONF_REG_T *reg;
+
+  // all addresses have to be mapped, i.e. lie in the run of the first
+  if ((start + count) > 65536) {
+    return 0;
+  }
+
+  // check aligned data boundaries
+  if (count > 0) {
+    reg = lcmbsPtabGet(&regs->map, start);
+    if (reg == NULL || start + count > reg->runEnd || reg->index > 0) {
+      return 0;
+    }
+    reg = lcmbsPtabGet(&regs->map, start + count - 1);
+    if (reg->pin != NULL && reg->index < (reg->pin->regCount - 1)) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
 int lcmbsProtReadBits(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out, LCMBS_CONF_BITS_T *bits) {
   uint16_t start, count;
 
@@ -46,8 +278,8 @@ int lcmbsProtReadBits(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *
   start = ntohs(start);
   count = ntohs(count);
 
-  // check valid register range
-  if (start < bits->start || (start + count) > (bits->start + bits->pins.count)) {
+  // check address space
+  if ((start + count) > 65536) {
     return MB_ERR_ILLEGAL_DATA_ADDRESS;
   }
 
@@ -71,9 +303,11 @@ int lcmbsProtReadBits(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *
   // iterate single bits
   int i = 0;
   uint8_t val = 0;
-  start -= bits->start;
   while(i < count) {
-    LCMBS_CONF_BIT_PIN_T *pin = lcmbsVectGet(&bits->pins, start + i);
+    LCMBS_CONF_BIT_PIN_T *pin = lcmbsPtabGet(&bits->map, start + i);
+    if (pin == NULL) {
+      return MB_ERR_ILLEGAL_DATA_ADDRESS;
+    }
     if (**pin->pin) {
       val |= 1 << (i & 7);
     }
@@ -102,7 +336,8 @@ int lcmbsProtForceBit(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *
   val = ntohs(val);
 
   // check valid register range
-  if (addr < bits->start || addr >= (bits->start + bits->pins.count)) {
+  LCMBS_CONF_BIT_PIN_T *pin = lcmbsPtabGet(&bits->map, addr);
+  if (pin == NULL) {
     return MB_ERR_ILLEGAL_DATA_ADDRESS;
   }
 
@@ -112,8 +347,10 @@ int lcmbsProtForceBit(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *
   }
   
   // set bit
-  LCMBS_CONF_BIT_PIN_T *pin = lcmbsVectGet(&bits->pins, addr - bits->start);
-  **pin->pin = val ? 1 : 0;
+  lcmbsPinSetBit(pin->pin, val ? 1 : 0);
+
+  // reads in flight can't be joined any more
+  __sync_add_and_fetch(&bits->gen, 1);
 
   // setup response
   if (
@@ -140,12 +377,7 @@ int lcmbsProtForceBits(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T
   start = ntohs(start);
   count = ntohs(count);
 
-  // check valid register range
-  if (start < bits->start || (start + count) > (bits->start + bits->pins.count)) {
-    return MB_ERR_ILLEGAL_DATA_ADDRESS;
-  }
-
-  // check number of bytes
+  // check number of bytes first, it bounds the range lookup
   int bytes = count >> 3;
   if (count & 7) {
     bytes++;
@@ -153,6 +385,11 @@ int lcmbsProtForceBits(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T
   if (bytes != bc) {
     return MB_ERR_ILLEGAL_DATA_ADDRESS;
   }
+
+  // check valid register range
+  if (!checkBitRange(bits, start, count)) {
+    return MB_ERR_ILLEGAL_DATA_ADDRESS;
+  }
   if (bytes != (in->count - in->pos)) {
     return MB_ERR_ILLEGAL_DATA_VALUE;
   }
@@ -160,18 +397,20 @@ int lcmbsProtForceBits(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T
   // iterate single bits
   int i = 0;
   uint8_t val = 0;
-  start -= bits->start;
   while(i < count) {
-    LCMBS_CONF_BIT_PIN_T *pin = lcmbsVectGet(&bits->pins, start + i);
+    LCMBS_CONF_BIT_PIN_T *pin = lcmbsPtabGet(&bits->map, start + i);
     if ((i & 7) == 0) {
       if (!lcmbsVectPullByte(in, &val)) {
         return MB_ERR_ILLEGAL_DATA_VALUE;
       }
     }
-    **pin->pin = (val & (1 << (i & 7))) ? 1 : 0;
+    lcmbsPinSetBit(pin->pin, (val & (1 << (i & 7))) ? 1 : 0);
     i++;
   }
 
+  // reads in flight can't be joined any more
+  __sync_add_and_fetch(&bits->gen, 1);
+
   // setup response
   if (
     !lcmbsVectPutByte(out, sid) ||
@@ -184,9 +423,14 @@ int lcmbsProtForceBits(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T
   return MB_ERR_OK;
 }
 
-int lcmbsProtReadRegs(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out, LCMBS_CONF_REGS_T *regs) {
+int lcmbsProtReadRegs(LCMBS_CONF_SLAVE_T *slave, uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out, LCMBS_CONF_REGS_T *regs) {
   uint16_t start, count;
   LCMBS_CONF_REG_T *reg;
+  int chgUpdated = 0;
+  uint64_t cycle, stamp;
+  LCMBS_CONF_REG_PIN_T *pins[WORDS_MAX];
+  uint16_t words[WORDS_MAX];
+  int j, n;
 
   // get parameters
   if (!lcmbsVectPullWord(in, &start) || !lcmbsVectPullWord(in, &count)) {
@@ -197,17 +441,23 @@ int lcmbsProtReadRegs(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *
   start = ntohs(start);
   count = ntohs(count);
 
-  // check valid register range
-  if (start < regs->start || (start + count) > (regs->start + regs->regs.count)) {
-    return MB_ERR_ILLEGAL_DATA_ADDRESS;
+  // specialized handler of the handler module, it leaves
+  // anything but runs of plain pins to the generic code
+  if (regs->genRead != NULL && count > 0 && (count << 1) <= 255 && genReadRegs(regs, sid, fnk, start, count, out)) {
+    return MB_ERR_OK;
   }
 
-  // calculate number of bytes
+  // calculate number of bytes first, it bounds the range lookup
   int bytes = count << 1;
   if (bytes > 255) {
     return MB_ERR_ILLEGAL_DATA_ADDRESS;
   }
 
+  // check valid register range
+  if (!checkRegRange(regs, start, count)) {
+    return MB_ERR_ILLEGAL_DATA_ADDRESS;
+  }
+
   // prepare header
   if (
     !lcmbsVectPutByte(out, sid) ||
@@ -221,89 +471,102 @@ int lcmbsProtReadRegs(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *
     return MB_ERR_OK;
   }
 
-  // check aligned data boundaries
-  start -= regs->start;
-  reg = lcmbsVectGet(&regs->regs, start);
-  if (reg->index > 0) {
-    return MB_ERR_ILLEGAL_DATA_ADDRESS;
-  }
-  reg = lcmbsVectGet(&regs->regs, start + count - 1);
-  if (reg->pin != NULL && reg->index < (reg->pin->regCount - 1)) {
-    return MB_ERR_ILLEGAL_DATA_ADDRESS;
+  // serve from response cache if pin values are unchanged
+  uint32_t rawbuf[LCMBS_CACHE_REGS_MAX];
+  uint32_t *raw = NULL;
+  uint32_t gen = 0;
+  if (slave->cache.size > 0) {
+    if (lcmbsCacheRead(&slave->cache, regs, fnk, start, count, out)) {
+      return MB_ERR_OK;
+    }
+    raw = rawbuf;
+    gen = regs->gen;
   }
 
-  int i, pad;
-  MODBUS_VAL_T pinval;
-  pinval.u = 0;
+  int i;
+  uint32_t enc = 0;
   for (i=0; i<count; i++) {
     // get register and pin
-    reg = lcmbsVectGet(&regs->regs, start + i);
+    reg = lcmbsPtabGet(&regs->map, start + i);
 
-    // normal register pins
+    // runs of plain 16 bit pins are converted in one go
     LCMBS_CONF_REG_PIN_T *pin = reg->pin;
-    if (pin != NULL) {
-      pad = 2 - pin->regCount;
+    if (isPlainWord(pin)) {
+      n = collectWordRun(regs, start + i, count - i, pins);
+      for (j = 0; j < n; j++) {
+        uint32_t val = lcmbsProtReadPin(pins[j]);
+        if (raw != NULL) {
+          raw[i + j] = val;
+        }
+        words[j] = clampWord(pins[j], val);
+      }
+      if (!putWords(out, words, n)) {
+        return MB_ERR_SLAVE_DEVICE_FAILURE;
+      }
 
+      i += n - 1;
+      continue;
+    }
+
+    // normal register pins
+    if (pin != NULL) {
       // read pin (triggerd by first register access)
       if (reg->index == 0) {
-        // read value
-        switch (pin->halType) {
-          case HAL_U32:
-            pinval.u = **pin->pin.u;
-            break;
-          case HAL_S32:
-            pinval.s = **pin->pin.s;
-            break;
-          case HAL_FLOAT:
-            pinval.f = **pin->pin.f;
-            break;
-          default:
-            pinval.u = 0;
+        uint32_t val = lcmbsProtReadPin(pin);
+        if (raw != NULL) {
+          raw[i] = val;
         }
+        enc = lcmbsProtEncodePin(pin, val);
+      } else if (raw != NULL) {
+        raw[i] = 0;
+      }
 
-        // limit single word values
-        switch(pin->type) {
-          case LCMBS_PINTYPE_U16:
-            // limit range
-            if (pinval.u > USHRT_MAX) pinval.u = USHRT_MAX;
-            break;
-          case LCMBS_PINTYPE_S16:
-            // limit range
-            if (pinval.s < SHRT_MIN) pinval.s = SHRT_MIN;
-            if (pinval.s > SHRT_MAX) pinval.s = SHRT_MAX;
-            break;
-        }
+      if (!lcmbsVectPutWord(out, lcmbsProtPinWord(pin, enc, reg->index))) {
+        return MB_ERR_SLAVE_DEVICE_FAILURE;
+      }
 
-        // convert to network byte order
-        pinval.u = htonl(pinval.u);
+      continue;
+    }
 
-        // reorder words on request
-        if (pin->flags & LCMBS_PINFLAG_WORDSWAP) {
-          uint16_t tmp = pinval.w[0];
-          pinval.w[0] = pinval.w[1];
-          pinval.w[1] = tmp;
-        }
+    // handle bit mapped register pins
+    LCMBS_VECT_T *bitpins = reg->bitpins;
+    if (bitpins != NULL) {
+      uint16_t val = lcmbsProtReadBitpins(bitpins);
+      if (raw != NULL) {
+        raw[i] = val;
+      }
+      if (!lcmbsVectPutWord(out, htons(val))) {
+        return MB_ERR_SLAVE_DEVICE_FAILURE;
       }
 
-      // get register value;
-      uint16_t val = pinval.w[pad + reg->index];
+      continue;
+    }
 
-      // reorder bytes on request
-      if (pin->flags & LCMBS_PINFLAG_BYTESWAP) {
-        val = bswap_16(val);
+    // handle cycle registers (period of the image copy, high word first)
+    if (reg->vreg == LCMBS_VREG_CYCLE || reg->vreg == LCMBS_VREG_CYCLETS) {
+      raw = NULL;
+      lcmbsRtxGetCycle(slave->exchange, &cycle, &stamp);
+      uint16_t val;
+      if (reg->vreg == LCMBS_VREG_CYCLE) {
+        val = (uint32_t) cycle >> (16 * (1 - reg->index));
+      } else {
+        val = stamp >> (16 * (3 - reg->index));
       }
-
-      if (!lcmbsVectPutWord(out, val)) {
+      if (!lcmbsVectPutWord(out, htons(val))) {
         return MB_ERR_SLAVE_DEVICE_FAILURE;
       }
 
       continue;
     }
 
-    // handle bit mapped register pins
-    LCMBS_VECT_T *bitpins = reg->bitpins;
-    if (bitpins != NULL) {
-      if (!lcmbsVectPutWord(out, htons(readRegBitpins(bitpins)))) {
+    // handle change sequence registers (diff once per request)
+    if (reg->vreg != LCMBS_VREG_NONE) {
+      raw = NULL;
+      if (!chgUpdated) {
+        lcmbsChgUpdate(slave);
+        chgUpdated = 1;
+      }
+      if (!lcmbsVectPutWord(out, htons(lcmbsChgGetReg(slave, reg->vreg)))) {
         return MB_ERR_SLAVE_DEVICE_FAILURE;
       }
 
@@ -311,6 +574,11 @@ int lcmbsProtReadRegs(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *
     }
   }
 
+  // update response cache
+  if (raw != NULL) {
+    lcmbsCacheStore(&slave->cache, fnk, start, count, gen, raw, out->data + out->count - bytes);
+  }
+
   return MB_ERR_OK;
 }
 
@@ -327,13 +595,11 @@ int lcmbsProtPresetReg(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T
   val = ntohs(val);
 
   // check valid register range
-  if (addr < regs->start || addr >= (regs->start + regs->regs.count)) {
+  LCMBS_CONF_REG_T *reg = lcmbsPtabGet(&regs->map, addr);
+  if (reg == NULL) {
     return MB_ERR_ILLEGAL_DATA_ADDRESS;
   }
 
-  // get register
-  LCMBS_CONF_REG_T *reg = lcmbsVectGet(&regs->regs, addr - regs->start);
-
   // handle normal register pins
   LCMBS_CONF_REG_PIN_T *pin = reg->pin;
   if (pin != NULL) {
@@ -347,10 +613,10 @@ int lcmbsProtPresetReg(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T
     // set register
     switch(pin->type) {
       case LCMBS_PINTYPE_U16:
-        **pin->pin.u = (hal_u32_t) pinval;
+        lcmbsPinSetU32(pin->pin.u, pinval);
         break;
       case LCMBS_PINTYPE_S16:
-        **pin->pin.s = (hal_s32_t) ((int16_t) pinval);
+        lcmbsPinSetS32(pin->pin.s, (int16_t) pinval);
         break;
       default:
         // only single word pins are allowd here
@@ -364,6 +630,9 @@ int lcmbsProtPresetReg(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T
     writeRegBitpins(bitpins, val);
   }
 
+  // invalidate cached responses
+  __sync_add_and_fetch(&regs->gen, 1);
+
   // setup response
   if (
     !lcmbsVectPutByte(out, sid) ||
@@ -390,16 +659,22 @@ int lcmbsProtPresetRegs(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T
   start = ntohs(start);
   count = ntohs(count);
 
-  // check valid register range
-  if (start < regs->start || (start + count) > (regs->start + regs->regs.count)) {
-    return MB_ERR_ILLEGAL_DATA_ADDRESS;
+  // specialized handler of the handler module
+  if (regs->genWrite != NULL && count > 0 && bc == (count << 1) && bc == (in->count - in->pos) &&
+    genPresetRegs(regs, sid, fnk, start, count, in, out)) {
+    return MB_ERR_OK;
   }
 
-  // check number of bytes
+  // check number of bytes first, it bounds the range lookup
   int bytes = count << 1;
   if (bytes != bc) {
     return MB_ERR_ILLEGAL_DATA_ADDRESS;
   }
+
+  // check valid register range
+  if (!checkRegRange(regs, start, count)) {
+    return MB_ERR_ILLEGAL_DATA_ADDRESS;
+  }
   if (bytes != (in->count - in->pos)) {
     return MB_ERR_ILLEGAL_DATA_VALUE;
   }
@@ -418,26 +693,34 @@ int lcmbsProtPresetRegs(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T
     return MB_ERR_OK;
   }
 
-  // check aligned data boundaries
-  start -= regs->start;
-  reg = lcmbsVectGet(&regs->regs, start);
-  if (reg->index > 0) {
-    return MB_ERR_ILLEGAL_DATA_ADDRESS;
-  }
-  reg = lcmbsVectGet(&regs->regs, start + count - 1);
-  if (reg->pin != NULL && reg->index < (reg->pin->regCount - 1)) {
-    return MB_ERR_ILLEGAL_DATA_ADDRESS;
-  }
-
-  int i, pad;
+  LCMBS_CONF_REG_PIN_T *pins[WORDS_MAX];
+  uint16_t words[WORDS_MAX];
+  int i, j, n, pad;
   MODBUS_VAL_T pinval;
   pinval.u = 0;
   for (i=0; i<count; i++) {
     // get register
-    reg = lcmbsVectGet(&regs->regs, start + i);
+    reg = lcmbsPtabGet(&regs->map, start + i);
 
-    // handle normal register pins
+    // runs of plain 16 bit pins are converted in one go
     LCMBS_CONF_REG_PIN_T *pin = reg->pin;
+    if (isPlainWord(pin)) {
+      n = collectWordRun(regs, start + i, count - i, pins);
+      lcmbsSwapWords(words, (uint8_t *) in->data + in->pos, n);
+      in->pos += n * 2;
+      for (j = 0; j < n; j++) {
+        if (pins[j]->type == LCMBS_PINTYPE_S16) {
+          lcmbsPinSetS32(pins[j]->pin.s, (int16_t) words[j]);
+        } else {
+          lcmbsPinSetU32(pins[j]->pin.u, words[j]);
+        }
+      }
+
+      i += n - 1;
+      continue;
+    }
+
+    // handle normal register pins
     if (pin != NULL) {
       pad = 2 - pin->regCount;
 
@@ -485,13 +768,13 @@ int lcmbsProtPresetRegs(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T
         // read value
         switch (pin->halType) {
           case HAL_U32:
-            **pin->pin.u = pinval.u;
+            lcmbsPinSetU32(pin->pin.u, pinval.u);
             break;
           case HAL_S32:
-            **pin->pin.s = pinval.s;
+            lcmbsPinSetS32(pin->pin.s, pinval.s);
             break;
           case HAL_FLOAT:
-            **pin->pin.f = pinval.f;
+            lcmbsPinSetFloat(pin->pin.f, pinval.f);
             break;
           default:
             break;
@@ -515,20 +798,400 @@ int lcmbsProtPresetRegs(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T
     }
   }
 
+  // invalidate cached responses
+  __sync_add_and_fetch(&regs->gen, 1);
+
   return MB_ERR_OK;
 }
 
-int lcmbsProtProc(LCMBS_CONF_SLAVE_T *slave, LCMBS_VECT_T *in, LCMBS_VECT_T *out) {
-  uint8_t sid, fnk;
+int lcmbsProtReadFifo(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out, LCMBS_CONF_FIFOS_T *fifos) {
+  LCMBS_CONF_FIFO_T *fifo = NULL;
+  uint16_t addr, vals[LCMBS_FIFO_VALS_MAX];
+  size_t q;
+  int i, n;
 
-  // get slave and function
-  if (!lcmbsVectPullByte(in, &sid) || !lcmbsVectPullByte(in, &fnk)) {
-    return 0;
+  // get parameters
+  if (!lcmbsVectPullWord(in, &addr)) {
+    return MB_ERR_INVALID_FUNCTION;
   }
 
-  // reset output buffer
-  uint8_t err = MB_ERR_INVALID_FUNCTION;
-  lcmbsVectClear(out);
+  // adjust byte order
+  addr = ntohs(addr);
+
+  // find queue
+  for (q = 0; q < fifos->queues.count && fifo == NULL; q++) {
+    LCMBS_CONF_FIFO_T *f = lcmbsVectGet(&fifos->queues, q);
+    if (f->addr == addr) {
+      fifo = f;
+    }
+  }
+  if (fifo == NULL) {
+    return MB_ERR_ILLEGAL_DATA_ADDRESS;
+  }
+
+  // drain up to one frame of values, the rest stays queued
+  // for the next request instead of failing with more than 31
+  n = lcmbsFifoRead(fifo->ring, vals, LCMBS_FIFO_VALS_MAX);
+
+  // prepare header
+  if (
+    !lcmbsVectPutByte(out, sid) ||
+    !lcmbsVectPutByte(out, fnk) ||
+    !lcmbsVectPutWord(out, htons(2 + n * 2)) ||
+    !lcmbsVectPutWord(out, htons(n))) {
+    return MB_ERR_SLAVE_DEVICE_FAILURE;
+  }
+
+  for (i = 0; i < n; i++) {
+    if (!lcmbsVectPutWord(out, htons(vals[i]))) {
+      return MB_ERR_SLAVE_DEVICE_FAILURE;
+    }
+  }
+
+  return MB_ERR_OK;
+}
+
+static LCMBS_CONF_SAMPLE_T *findSampleFile(LCMBS_VECT_T *samples, uint16_t file) {
+  size_t i;
+
+  for (i = 0; i < samples->count; i++) {
+    LCMBS_CONF_SAMPLE_T *sample = lcmbsVectGet(samples, i);
+    if (file >= sample->file && file <= sample->file + sample->dataFiles) {
+      return sample;
+    }
+  }
+
+  return NULL;
+}
+
+static LCMBS_CONF_TABLE_T *findTableFile(LCMBS_CONF_TABLES_T *tables, uint16_t file) {
+  size_t i;
+
+  for (i = 0; i < tables->tables.count; i++) {
+    LCMBS_CONF_TABLE_T *table = lcmbsVectGet(&tables->tables, i);
+    if (file >= table->file && file < table->file + table->files) {
+      return table;
+    }
+  }
+
+  return NULL;
+}
+
+int lcmbsProtReadFileRecords(LCMBS_CONF_SLAVE_T *slave, uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out) {
+  LCMBS_CONF_SAMPLE_T *sample;
+  LCMBS_CONF_TABLE_T *table;
+  uint16_t file, record, count, regs[FILE_BYTES_MAX / 2];
+  uint8_t bytes, refType, *len;
+  int i, j, err, total = 0;
+
+  // get byte count of sub requests
+  if (!lcmbsVectPullByte(in, &bytes)) {
+    return MB_ERR_INVALID_FUNCTION;
+  }
+  if (bytes < FILE_REQ_LEN || bytes > FILE_BYTES_MAX || (bytes % FILE_REQ_LEN) != 0) {
+    return MB_ERR_ILLEGAL_DATA_VALUE;
+  }
+
+  // prepare header, the length is known at the end
+  if (
+    !lcmbsVectPutByte(out, sid) ||
+    !lcmbsVectPutByte(out, fnk) ||
+    !lcmbsVectPutByte(out, 0)) {
+    return MB_ERR_SLAVE_DEVICE_FAILURE;
+  }
+
+  for (i = 0; i < bytes / FILE_REQ_LEN; i++) {
+    // get sub request
+    if (
+      !lcmbsVectPullByte(in, &refType) ||
+      !lcmbsVectPullWord(in, &file) ||
+      !lcmbsVectPullWord(in, &record) ||
+      !lcmbsVectPullWord(in, &count)) {
+      return MB_ERR_INVALID_FUNCTION;
+    }
+
+    // adjust byte order
+    file = ntohs(file);
+    record = ntohs(record);
+    count = ntohs(count);
+
+    // whole response has to fit a frame
+    total += 2 + count * 2;
+    if (count == 0 || total > FILE_BYTES_MAX) {
+      return MB_ERR_ILLEGAL_DATA_VALUE;
+    }
+
+    // read records
+    err = -1;
+    if (refType == FILE_REF_TYPE) {
+      if ((sample = findSampleFile(&slave->samples, file)) != NULL) {
+        err = lcmbsSampleRead(sample, file, record, count, regs);
+      } else if ((table = findTableFile(&slave->tables, file)) != NULL) {
+        err = lcmbsTableRead(table, file, record, count, regs);
+      }
+    }
+    if (err) {
+      return MB_ERR_ILLEGAL_DATA_ADDRESS;
+    }
+
+    // add sub response
+    if (
+      !lcmbsVectPutByte(out, 1 + count * 2) ||
+      !lcmbsVectPutByte(out, FILE_REF_TYPE)) {
+      return MB_ERR_SLAVE_DEVICE_FAILURE;
+    }
+    for (j = 0; j < count; j++) {
+      if (!lcmbsVectPutWord(out, htons(regs[j]))) {
+        return MB_ERR_SLAVE_DEVICE_FAILURE;
+      }
+    }
+  }
+
+  // set response length
+  len = lcmbsVectGet(out, 2);
+  *len = total;
+
+  return MB_ERR_OK;
+}
+
+int lcmbsProtWriteFileRecords(LCMBS_CONF_SLAVE_T *slave, uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out) {
+  FILE_WRITE_T writes[FILE_WRITES_MAX], *w;
+  uint16_t regs[FILE_WRITE_MAX / 2], *data = regs;
+  uint8_t bytes, refType;
+  size_t start;
+  int i, j, n, left;
+
+  // get byte count of sub requests
+  if (!lcmbsVectPullByte(in, &bytes)) {
+    return MB_ERR_INVALID_FUNCTION;
+  }
+  if (bytes < FILE_REQ_LEN + 2 || bytes > FILE_WRITE_MAX || bytes != (in->count - in->pos)) {
+    return MB_ERR_ILLEGAL_DATA_VALUE;
+  }
+  start = in->pos;
+
+  // check all sub requests before any table is touched
+  for (n = 0, left = bytes; left > 0; n++, left -= FILE_REQ_LEN + w->count * 2) {
+    w = &writes[n];
+    if (
+      left < FILE_REQ_LEN + 2 ||
+      !lcmbsVectPullByte(in, &refType) ||
+      !lcmbsVectPullWord(in, &w->file) ||
+      !lcmbsVectPullWord(in, &w->record) ||
+      !lcmbsVectPullWord(in, &w->count)) {
+      return MB_ERR_ILLEGAL_DATA_VALUE;
+    }
+
+    // adjust byte order
+    w->file = ntohs(w->file);
+    w->record = ntohs(w->record);
+    w->count = ntohs(w->count);
+
+    // get record data
+    if (w->count == 0 || FILE_REQ_LEN + w->count * 2 > left) {
+      return MB_ERR_ILLEGAL_DATA_VALUE;
+    }
+    w->regs = data;
+    for (j = 0; j < w->count; j++) {
+      if (!lcmbsVectPullWord(in, data)) {
+        return MB_ERR_ILLEGAL_DATA_VALUE;
+      }
+      *data = ntohs(*data);
+      data++;
+    }
+
+    // check target records
+    w->table = findTableFile(&slave->tables, w->file);
+    if (refType != FILE_REF_TYPE || w->table == NULL) {
+      return MB_ERR_ILLEGAL_DATA_ADDRESS;
+    }
+    if (w->file == w->table->file) {
+      if (w->record + w->count > w->table->records) {
+        return MB_ERR_ILLEGAL_DATA_ADDRESS;
+      }
+    } else {
+      // control file only takes a commit (1) or discard (0)
+      if (w->record != 0 || w->count != 1) {
+        return MB_ERR_ILLEGAL_DATA_ADDRESS;
+      }
+      if (w->regs[0] > 1) {
+        return MB_ERR_ILLEGAL_DATA_VALUE;
+      }
+    }
+  }
+
+  // response echoes the request
+  if (
+    !lcmbsVectPutByte(out, sid) ||
+    !lcmbsVectPutByte(out, fnk) ||
+    !lcmbsVectPutByte(out, bytes) ||
+    !lcmbsVectPutData(out, lcmbsVectGet(in, start), bytes)) {
+    return MB_ERR_SLAVE_DEVICE_FAILURE;
+  }
+
+  pthread_mutex_lock(&slave->tables.lock);
+
+  for (i = 0; i < n; i++) {
+    w = &writes[i];
+    if (w->file == w->table->file) {
+      lcmbsTableStage(w->table, w->record, w->count, w->regs);
+    } else if (w->regs[0]) {
+      lcmbsTableCommit(w->table);
+    } else {
+      lcmbsTableDiscard(w->table);
+    }
+  }
+
+  // without explicit commits every request is one update
+  for (i = 0; i < n; i++) {
+    if (writes[i].table->commit == LCMBS_TABLE_COMMIT_REQUEST) {
+      lcmbsTableCommit(writes[i].table);
+    }
+  }
+
+  pthread_mutex_unlock(&slave->tables.lock);
+
+  return MB_ERR_OK;
+}
+
+int lcmbsProtDiagnostics(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out, LCMBS_DIAG_T *diag) {
+  uint16_t sub, data, val;
+  uint32_t *counter = NULL;
+
+  // get parameters
+  if (!lcmbsVectPullWord(in, &sub)) {
+    return MB_ERR_INVALID_FUNCTION;
+  }
+
+  // adjust byte order
+  sub = ntohs(sub);
+
+  // query data is echoed as is
+  if (sub == DIAG_RETURN_QUERY_DATA) {
+    if (
+      !lcmbsVectPutByte(out, sid) ||
+      !lcmbsVectPutByte(out, fnk) ||
+      !lcmbsVectPutWord(out, htons(sub)) ||
+      !lcmbsVectPutData(out, lcmbsVectGet(in, in->pos), in->count - in->pos)) {
+      return MB_ERR_SLAVE_DEVICE_FAILURE;
+    }
+    return MB_ERR_OK;
+  }
+
+  // all other sub functions take a single data word
+  if (!lcmbsVectPullWord(in, &data)) {
+    return MB_ERR_INVALID_FUNCTION;
+  }
+  data = ntohs(data);
+  if (in->pos != in->count || (sub != DIAG_RESTART_COMM && data != 0)) {
+    return MB_ERR_ILLEGAL_DATA_VALUE;
+  }
+
+  switch (sub) {
+    case DIAG_RESTART_COMM:
+      // there is no listen only mode to leave, only
+      // counters and optionally the event log are reset
+      if (data != 0 && data != DIAG_CLEAR_LOG) {
+        return MB_ERR_ILLEGAL_DATA_VALUE;
+      }
+      lcmbsDiagClear(diag, data == DIAG_CLEAR_LOG);
+      lcmbsDiagLog(diag, LCMBS_DIAG_EV_RESTART);
+      val = data;
+      break;
+    case DIAG_RETURN_DIAG_REG:
+    case DIAG_SLAVE_NAKS:
+      val = 0;
+      break;
+    case DIAG_CLEAR_COUNTERS:
+      lcmbsDiagClear(diag, 0);
+      val = 0;
+      break;
+    case DIAG_CLEAR_OVERRUNS:
+      lcmbsDiagClearOverruns(diag);
+      val = 0;
+      break;
+    case DIAG_BUS_MESSAGES:
+      counter = &diag->busMessages;
+      break;
+    case DIAG_BUS_COMM_ERRORS:
+      counter = &diag->commErrors;
+      break;
+    case DIAG_BUS_EXCEPTIONS:
+      counter = &diag->exceptions;
+      break;
+    case DIAG_SLAVE_MESSAGES:
+      val = lcmbsDiagSlaveMessages(diag);
+      break;
+    case DIAG_SLAVE_NO_RESPONSES:
+      counter = &diag->noResponses;
+      break;
+    case DIAG_SLAVE_BUSY:
+      counter = &diag->busy;
+      break;
+    case DIAG_BUS_OVERRUNS:
+      val = lcmbsDiagOverruns(diag);
+      break;
+    default:
+      return MB_ERR_INVALID_FUNCTION;
+  }
+
+  // counters wrap at 16 bits on the wire
+  if (counter != NULL) {
+    val = __atomic_load_n(counter, __ATOMIC_RELAXED);
+  }
+
+  // setup response
+  if (
+    !lcmbsVectPutByte(out, sid) ||
+    !lcmbsVectPutByte(out, fnk) ||
+    !lcmbsVectPutWord(out, htons(sub)) ||
+    !lcmbsVectPutWord(out, htons(val))) {
+    return MB_ERR_SLAVE_DEVICE_FAILURE;
+  }
+
+  return MB_ERR_OK;
+}
+
+int lcmbsProtGetCommEvents(uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out, LCMBS_DIAG_T *diag) {
+  uint8_t events[LCMBS_DIAG_LOG_SIZE];
+  int n;
+
+  // no parameters
+  if (in->pos != in->count) {
+    return MB_ERR_ILLEGAL_DATA_VALUE;
+  }
+
+  // status is never busy, requests are not queued
+  if (
+    !lcmbsVectPutByte(out, sid) ||
+    !lcmbsVectPutByte(out, fnk)) {
+    return MB_ERR_SLAVE_DEVICE_FAILURE;
+  }
+
+  if (fnk == MB_FNK_GET_COMM_EVENT_COUNTER) {
+    if (
+      !lcmbsVectPutWord(out, 0) ||
+      !lcmbsVectPutWord(out, htons(lcmbsDiagEvents(diag)))) {
+      return MB_ERR_SLAVE_DEVICE_FAILURE;
+    }
+    return MB_ERR_OK;
+  }
+
+  n = lcmbsDiagReadLog(diag, events);
+  if (
+    !lcmbsVectPutByte(out, 6 + n) ||
+    !lcmbsVectPutWord(out, 0) ||
+    !lcmbsVectPutWord(out, htons(lcmbsDiagEvents(diag))) ||
+    !lcmbsVectPutWord(out, htons(__atomic_load_n(&diag->busMessages, __ATOMIC_RELAXED))) ||
+    (n > 0 && !lcmbsVectPutData(out, events, n))) {
+    return MB_ERR_SLAVE_DEVICE_FAILURE;
+  }
+
+  return MB_ERR_OK;
+}
+
+int lcmbsProtProcFnk(LCMBS_CONF_SLAVE_T *slave, uint8_t sid, uint8_t fnk, LCMBS_VECT_T *in, LCMBS_VECT_T *out) {
+  int err;
 
   // process function
   switch (fnk) {
@@ -549,11 +1212,11 @@ int lcmbsProtProc(LCMBS_CONF_SLAVE_T *slave, LCMBS_VECT_T *in, LCMBS_VECT_T *out
       break;
 
     case MB_FNK_READ_HOLDING_REG:
-      err = lcmbsProtReadRegs(sid, fnk, in, out, &slave->holdingRegs);
+      err = lcmbsProtReadRegs(slave, sid, fnk, in, out, &slave->holdingRegs);
       break;
 
     case MB_FNK_READ_INPUT_REG:
-      err = lcmbsProtReadRegs(sid, fnk, in, out, &slave->inputRegs);
+      err = lcmbsProtReadRegs(slave, sid, fnk, in, out, &slave->inputRegs);
       break;
 
     case MB_FNK_PRESET_SINGLE_REG:
@@ -564,21 +1227,122 @@ int lcmbsProtProc(LCMBS_CONF_SLAVE_T *slave, LCMBS_VECT_T *in, LCMBS_VECT_T *out
       err = lcmbsProtPresetRegs(sid, fnk, in, out, &slave->holdingRegs);
       break;
 
+    case MB_FNK_DIAGNOSTICS:
+      err = lcmbsProtDiagnostics(sid, fnk, in, out, slave->diag);
+      break;
+
+    case MB_FNK_GET_COMM_EVENT_COUNTER:
+    case MB_FNK_GET_COMM_EVENT_LOG:
+      err = lcmbsProtGetCommEvents(sid, fnk, in, out, slave->diag);
+      break;
+
+    case MB_FNK_READ_FILE_RECORD:
+      err = lcmbsProtReadFileRecords(slave, sid, fnk, in, out);
+      break;
+
+    case MB_FNK_WRITE_FILE_RECORD:
+      err = lcmbsProtWriteFileRecords(slave, sid, fnk, in, out);
+      break;
+
+    case MB_FNK_READ_FIFO_QUEUE:
+      err = lcmbsProtReadFifo(sid, fnk, in, out, &slave->fifos);
+      break;
+
     default:
       err = MB_ERR_INVALID_FUNCTION;
   }
 
+  return err;
+}
+
+static int lcmbsProtPutException(LCMBS_VECT_T *out, uint8_t sid, uint8_t fnk, uint8_t err) {
+  lcmbsVectClear(out);
+  if (
+    !lcmbsVectPutByte(out, sid) ||
+    !lcmbsVectPutByte(out, fnk | 0x80) ||
+    !lcmbsVectPutByte(out, err)) {
+    return 0;
+  }
+
+  return out->count;
+}
+
+static int lcmbsProtIsWrite(uint8_t fnk, LCMBS_VECT_T *in) {
+  uint8_t *sub;
+
+  switch (fnk) {
+    case MB_FNK_FORCE_SINGLE_COIL:
+    case MB_FNK_FORCE_MULTI_COIL:
+    case MB_FNK_PRESET_SINGLE_REG:
+    case MB_FNK_PRESET_MULTI_REG:
+    case MB_FNK_WRITE_FILE_RECORD:
+      return 1;
+    case MB_FNK_DIAGNOSTICS:
+      // sub functions that reset counters or the event log change
+      // state too, a short request is refused by the handler
+      sub = lcmbsVectGet(in, in->pos);
+      if (sub == NULL || sub[0] != 0 || in->count - in->pos < 2) {
+        return 0;
+      }
+      return sub[1] == DIAG_RESTART_COMM || sub[1] == DIAG_CLEAR_COUNTERS || sub[1] == DIAG_CLEAR_OVERRUNS;
+  }
+
+  return 0;
+}
+
+int lcmbsProtProc(LCMBS_CONF_SLAVE_T *slave, LCMBS_VECT_T *in, LCMBS_VECT_T *out, int flags) {
+  uint8_t sid, fnk;
+
+  // get slave and function
+  if (!lcmbsVectPullByte(in, &sid) || !lcmbsVectPullByte(in, &fnk)) {
+    return 0;
+  }
+
+  // reset output buffer
+  uint8_t err = MB_ERR_INVALID_FUNCTION;
+  lcmbsVectClear(out);
+
+  // realtime slaves serve the request from one image copy
+  lcmbsRtxBegin(slave->exchange);
+
+  // process function (identical reads in flight are coalesced),
+  // read only clients get an illegal function on writes
+  switch (fnk) {
+    case MB_FNK_READ_COIL_STATUS:
+    case MB_FNK_READ_INPUT_STATUS:
+    case MB_FNK_READ_HOLDING_REG:
+    case MB_FNK_READ_INPUT_REG:
+      err = lcmbsCoalProc(slave, sid, fnk, in, out, lcmbsProtProcFnk);
+      break;
+
+    default:
+      if ((flags & LCMBS_PROT_READONLY) && lcmbsProtIsWrite(fnk, in)) {
+        break;
+      }
+      err = lcmbsProtProcFnk(slave, sid, fnk, in, out);
+  }
+
+  lcmbsRtxEnd(slave->exchange);
+
+  // update communication counters
+  lcmbsDiagRequest(slave->diag, fnk, err);
+
   // handle error
   if (err != MB_ERR_OK) {
-    lcmbsVectClear(out);
-    if (
-      !lcmbsVectPutByte(out, sid) ||
-      !lcmbsVectPutByte(out, fnk | 0x80) ||
-      !lcmbsVectPutByte(out, err)) {
-      return 0;
-    }
+    return lcmbsProtPutException(out, sid, fnk, err);
   }
 
   return out->count;
 }
 
+int lcmbsProtException(LCMBS_VECT_T *in, LCMBS_VECT_T *out, uint8_t err) {
+  uint8_t sid, fnk;
+
+  // answer a request with an exception without processing it
+  if (!lcmbsVectPullByte(in, &sid) || !lcmbsVectPullByte(in, &fnk)) {
+    return 0;
+  }
+
+  return lcmbsProtPutException(out, sid, fnk, err);
+}
+
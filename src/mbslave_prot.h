@@ -13,16 +13,31 @@
 #define MB_FNK_READ_INPUT_REG		4
 #define MB_FNK_FORCE_SINGLE_COIL	5
 #define MB_FNK_PRESET_SINGLE_REG	6
+#define MB_FNK_DIAGNOSTICS		8
+#define MB_FNK_GET_COMM_EVENT_COUNTER	11
+#define MB_FNK_GET_COMM_EVENT_LOG	12
 #define MB_FNK_FORCE_MULTI_COIL		15
 #define MB_FNK_PRESET_MULTI_REG		16
+#define MB_FNK_READ_FILE_RECORD		20
+#define MB_FNK_WRITE_FILE_RECORD	21
+#define MB_FNK_READ_FIFO_QUEUE		24
 
 #define MB_ERR_OK			0
 #define MB_ERR_INVALID_FUNCTION		1
 #define MB_ERR_ILLEGAL_DATA_ADDRESS	2
 #define MB_ERR_ILLEGAL_DATA_VALUE	3
 #define MB_ERR_SLAVE_DEVICE_FAILURE	4
+#define MB_ERR_SLAVE_DEVICE_BUSY	6
 
-int lcmbsProtProc(LCMBS_CONF_SLAVE_T *slave, LCMBS_VECT_T *in, LCMBS_VECT_T *out);
+#define LCMBS_PROT_READONLY (1 << 0)
+
+uint32_t lcmbsProtReadPin(LCMBS_CONF_REG_PIN_T *pin);
+uint16_t lcmbsProtReadBitpins(LCMBS_VECT_T *bitpins);
+uint32_t lcmbsProtEncodePin(LCMBS_CONF_REG_PIN_T *pin, uint32_t raw);
+uint16_t lcmbsProtPinWord(LCMBS_CONF_REG_PIN_T *pin, uint32_t enc, int index);
+
+int lcmbsProtProc(LCMBS_CONF_SLAVE_T *slave, LCMBS_VECT_T *in, LCMBS_VECT_T *out, int flags);
+int lcmbsProtException(LCMBS_VECT_T *in, LCMBS_VECT_T *out, uint8_t err);
 
 #endif
 
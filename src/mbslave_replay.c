@@ -0,0 +1,481 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "mbslave_capfmt.h"
+
+// Replays a mbslave traffic capture against a Modbus/TCP server. Every
+// captured connection gets its own connection and thread, requests are
+// sent one at a time per connection like the original clients did.
+
+#define HEADER_LEN      6
+#define PACKET_MAX      512
+#define RECV_TIMEOUT    2
+#define VERBOSE_MAX     20
+
+typedef struct {
+  LCMBS_CAPFMT_REC_T hdr;
+  const uint8_t *req;
+  const uint8_t *rsp;
+} REPLAY_REC_T;
+
+typedef struct {
+  REPLAY_REC_T **recs;
+  size_t count;
+  size_t size;
+  pthread_t thread;
+  int sd;
+  uint32_t *latency;
+  size_t done;
+  size_t errors;
+  size_t excMismatch;
+  size_t dataMismatch;
+} REPLAY_CONN_T;
+
+static const char *progName = "mbslave-replay";
+
+static const struct option longOptions[] = {
+  { "host", required_argument, NULL, 'h' },
+  { "port", required_argument, NULL, 'p' },
+  { "fast", no_argument, NULL, 'f' },
+  { "speed", required_argument, NULL, 's' },
+  { "verbose", no_argument, NULL, 'v' },
+  { NULL, 0, NULL, 0 }
+};
+
+static const char *host = "127.0.0.1";
+static const char *port = "502";
+static int fast;
+static double speed = 1.0;
+static int verbose;
+static int verboseCount;
+
+static uint64_t firstTs;
+static uint64_t startTime;
+static pthread_barrier_t startBarrier;
+static pthread_mutex_t printLock = PTHREAD_MUTEX_INITIALIZER;
+
+static REPLAY_CONN_T *conns[65536];
+
+
+static void usage(void) {
+  fprintf(stderr, "usage: %s [--host=HOST] [--port=PORT] [--fast | --speed=FACTOR] [--verbose] capturefile\n", progName);
+}
+
+static uint64_t timeNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *readFile(const char *filename, size_t *size) {
+  FILE *file;
+  void *data;
+  long len;
+
+  file = fopen(filename, "rb");
+  if (!file) {
+    goto fail0;
+  }
+  if (fseek(file, 0, SEEK_END) || (len = ftell(file)) < 0 || fseek(file, 0, SEEK_SET)) {
+    goto fail1;
+  }
+  data = malloc(len > 0 ? len : 1);
+  if (!data) {
+    goto fail1;
+  }
+  if (fread(data, 1, len, file) != len) {
+    goto fail2;
+  }
+
+  fclose(file);
+  *size = len;
+  return data;
+
+fail2:
+  free(data);
+fail1:
+  fclose(file);
+fail0:
+  return NULL;
+}
+
+static int connectServer(void) {
+  struct addrinfo hints, *res, *ai;
+  struct timeval tv;
+  int sd = -1, optval;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, port, &hints, &res)) {
+    return -1;
+  }
+
+  for (ai = res; ai != NULL; ai = ai->ai_next) {
+    sd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (sd < 0) {
+      continue;
+    }
+    if (connect(sd, ai->ai_addr, ai->ai_addrlen) == 0) {
+      break;
+    }
+    close(sd);
+    sd = -1;
+  }
+  freeaddrinfo(res);
+  if (sd < 0) {
+    return -1;
+  }
+
+  optval = 1;
+  setsockopt(sd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+  tv.tv_sec = RECV_TIMEOUT;
+  tv.tv_usec = 0;
+  setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  return sd;
+}
+
+static int recvAll(int sd, uint8_t *buf, size_t len) {
+  ssize_t rcvd;
+
+  while (len > 0) {
+    rcvd = recv(sd, buf, len, 0);
+    if (rcvd <= 0) {
+      return -1;
+    }
+    buf += rcvd;
+    len -= rcvd;
+  }
+
+  return 0;
+}
+
+static void printHex(const char *label, const uint8_t *data, size_t len) {
+  size_t i;
+
+  fprintf(stderr, "  %s", label);
+  for (i = 0; i < len; i++) {
+    fprintf(stderr, " %02x", data[i]);
+  }
+  fprintf(stderr, "\n");
+}
+
+static void compareResponse(REPLAY_CONN_T *conn, const REPLAY_REC_T *rec, const uint8_t *rsp, size_t len) {
+  const uint8_t *exp = rec->rsp;
+
+  if (len == rec->hdr.rspLen && memcmp(rsp, exp, len) == 0) {
+    return;
+  }
+
+  // an exception where none was captured or vice versa
+  // is worse than a register value that changed since
+  if (len < 3 || rec->hdr.rspLen < 3 || (rsp[1] & 0x80) != (exp[1] & 0x80) ||
+      ((rsp[1] & 0x80) && rsp[2] != exp[2])) {
+    conn->excMismatch++;
+  } else {
+    conn->dataMismatch++;
+  }
+
+  if (verbose) {
+    pthread_mutex_lock(&printLock);
+    if (verboseCount++ < VERBOSE_MAX) {
+      fprintf(stderr, "%s: response mismatch on connection %u\n", progName, rec->hdr.conn);
+      printHex("request: ", rec->req, rec->hdr.reqLen);
+      printHex("captured:", exp, rec->hdr.rspLen);
+      printHex("received:", rsp, len);
+    }
+    pthread_mutex_unlock(&printLock);
+  }
+}
+
+static void *replayThread(void *arg) {
+  REPLAY_CONN_T *conn = (REPLAY_CONN_T *) arg;
+  uint8_t packet[PACKET_MAX];
+  uint16_t tid = 0, len;
+  struct timespec ts;
+  uint64_t due, sent;
+  size_t i;
+
+  pthread_barrier_wait(&startBarrier);
+  if (conn->sd < 0) {
+    conn->errors = conn->count;
+    return NULL;
+  }
+
+  for (i = 0; i < conn->count; i++) {
+    const REPLAY_REC_T *rec = conn->recs[i];
+    const LCMBS_CAPFMT_REC_T *hdr = &rec->hdr;
+
+    // keep the captured inter-arrival times, scaled by speed
+    if (!fast) {
+      due = startTime + (uint64_t) ((hdr->ts - firstTs) / speed);
+      ts.tv_sec = due / 1000000000ULL;
+      ts.tv_nsec = due % 1000000000ULL;
+      while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0);
+    }
+
+    // send request with a fresh transaction id
+    tid++;
+    *((uint16_t *) &packet[0]) = htons(tid);
+    *((uint16_t *) &packet[2]) = 0;
+    *((uint16_t *) &packet[4]) = htons(hdr->reqLen);
+    memcpy(&packet[HEADER_LEN], rec->req, hdr->reqLen);
+    sent = timeNs();
+    if (send(conn->sd, packet, HEADER_LEN + hdr->reqLen, MSG_NOSIGNAL) != HEADER_LEN + hdr->reqLen) {
+      goto fail;
+    }
+
+    // nothing to wait for if the server didn't answer in the capture
+    if (hdr->rspLen == 0) {
+      continue;
+    }
+
+    if (recvAll(conn->sd, packet, HEADER_LEN)) {
+      goto fail;
+    }
+    len = ntohs(*((uint16_t *) &packet[4]));
+    if (ntohs(*((uint16_t *) &packet[0])) != tid || len > PACKET_MAX - HEADER_LEN ||
+        recvAll(conn->sd, &packet[HEADER_LEN], len)) {
+      goto fail;
+    }
+    conn->latency[conn->done++] = timeNs() - sent;
+
+    compareResponse(conn, rec, &packet[HEADER_LEN], len);
+  }
+
+  return NULL;
+
+fail:
+  conn->errors += conn->count - i;
+  return NULL;
+}
+
+static int compareTimes(const void *a, const void *b) {
+  uint32_t ta = *(const uint32_t *) a;
+  uint32_t tb = *(const uint32_t *) b;
+
+  return (ta > tb) - (ta < tb);
+}
+
+static void printLatency(const char *label, uint32_t *times, size_t count) {
+  uint64_t total = 0;
+  size_t i;
+
+  if (count == 0) {
+    return;
+  }
+
+  qsort(times, count, sizeof(uint32_t), compareTimes);
+  for (i = 0; i < count; i++) {
+    total += times[i];
+  }
+  printf("%-20s %10.1f %10.1f %10.1f %10.1f\n", label, total / 1000.0 / count,
+    times[count / 2] / 1000.0, times[(count * 99) / 100] / 1000.0, times[count - 1] / 1000.0);
+}
+
+static int addRecord(REPLAY_CONN_T *conn, REPLAY_REC_T *rec) {
+  REPLAY_REC_T **recs;
+  size_t size;
+
+  if (conn->count == conn->size) {
+    size = conn->size ? conn->size * 2 : 256;
+    recs = realloc(conn->recs, size * sizeof(REPLAY_REC_T *));
+    if (!recs) {
+      return -1;
+    }
+    conn->recs = recs;
+    conn->size = size;
+  }
+
+  conn->recs[conn->count++] = rec;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  int ret = 1;
+  int opt;
+  const LCMBS_CAPFMT_HDR_T *hdr;
+  const uint8_t *data, *pos, *end;
+  REPLAY_REC_T *recs;
+  REPLAY_CONN_T *conn;
+  uint32_t *captured, *latency;
+  size_t size, total, done, errors, excMismatch, dataMismatch, n;
+  int connCount, c;
+  uint64_t elapsed;
+
+  // parse options
+  while ((opt = getopt_long(argc, argv, "h:p:fs:v", longOptions, NULL)) != -1) {
+    switch (opt) {
+      case 'h':
+        host = optarg;
+        break;
+      case 'p':
+        port = optarg;
+        break;
+      case 'f':
+        fast = 1;
+        break;
+      case 's':
+        speed = atof(optarg);
+        if (speed <= 0) {
+          usage();
+          goto fail0;
+        }
+        break;
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        usage();
+        goto fail0;
+    }
+  }
+  if (optind != argc - 1) {
+    usage();
+    goto fail0;
+  }
+
+  // load and check capture
+  data = readFile(argv[optind], &size);
+  if (!data) {
+    fprintf(stderr, "%s: ERROR: unable to read %s\n", progName, argv[optind]);
+    goto fail0;
+  }
+  hdr = (const LCMBS_CAPFMT_HDR_T *) data;
+  if (size < sizeof(LCMBS_CAPFMT_HDR_T) || hdr->magic != LCMBS_CAPFMT_MAGIC || hdr->version != LCMBS_CAPFMT_VERSION) {
+    fprintf(stderr, "%s: ERROR: %s is not a capture of this version\n", progName, argv[optind]);
+    goto fail1;
+  }
+
+  // split records by connection, a truncated last record is ignored
+  n = size / sizeof(LCMBS_CAPFMT_REC_T) + 1;
+  recs = malloc(n * sizeof(REPLAY_REC_T));
+  captured = malloc(n * sizeof(uint32_t));
+  if (!recs || !captured) {
+    goto fail2;
+  }
+  pos = data + sizeof(LCMBS_CAPFMT_HDR_T);
+  end = data + size;
+  total = 0;
+  connCount = 0;
+  firstTs = 0;
+  while (end - pos >= sizeof(LCMBS_CAPFMT_REC_T)) {
+    // records are packed without alignment
+    REPLAY_REC_T *rec = &recs[total];
+    memcpy(&rec->hdr, pos, sizeof(LCMBS_CAPFMT_REC_T));
+    n = sizeof(LCMBS_CAPFMT_REC_T) + rec->hdr.reqLen + rec->hdr.rspLen;
+    if (end - pos < n) {
+      break;
+    }
+    rec->req = pos + sizeof(LCMBS_CAPFMT_REC_T);
+    rec->rsp = rec->req + rec->hdr.reqLen;
+    pos += n;
+
+    conn = conns[rec->hdr.conn];
+    if (!conn) {
+      conn = calloc(1, sizeof(REPLAY_CONN_T));
+      if (!conn) {
+        goto fail2;
+      }
+      conn->sd = -1;
+      conns[rec->hdr.conn] = conn;
+      connCount++;
+    }
+    if (addRecord(conn, rec)) {
+      goto fail2;
+    }
+    if (total == 0 || rec->hdr.ts < firstTs) {
+      firstTs = rec->hdr.ts;
+    }
+    captured[total++] = rec->hdr.service;
+  }
+  if (total == 0) {
+    fprintf(stderr, "%s: ERROR: %s contains no requests\n", progName, argv[optind]);
+    goto fail2;
+  }
+
+  // connect all connections before the clock starts
+  if (pthread_barrier_init(&startBarrier, NULL, connCount + 1)) {
+    goto fail2;
+  }
+  for (c = 0; c < 65536; c++) {
+    conn = conns[c];
+    if (!conn) {
+      continue;
+    }
+    conn->latency = malloc(conn->count * sizeof(uint32_t));
+    if (!conn->latency) {
+      goto fail2;
+    }
+    conn->sd = connectServer();
+    if (conn->sd < 0) {
+      fprintf(stderr, "%s: ERROR: unable to connect to %s:%s\n", progName, host, port);
+    }
+    if (pthread_create(&conn->thread, NULL, replayThread, conn)) {
+      fprintf(stderr, "%s: ERROR: unable to start replay thread\n", progName);
+      exit(1);
+    }
+  }
+
+  startTime = timeNs();
+  pthread_barrier_wait(&startBarrier);
+
+  // collect results
+  latency = malloc(total * sizeof(uint32_t));
+  if (!latency) {
+    goto fail2;
+  }
+  done = 0;
+  errors = 0;
+  excMismatch = 0;
+  dataMismatch = 0;
+  for (c = 0; c < 65536; c++) {
+    conn = conns[c];
+    if (!conn) {
+      continue;
+    }
+    pthread_join(conn->thread, NULL);
+    if (conn->sd >= 0) {
+      close(conn->sd);
+    }
+    memcpy(&latency[done], conn->latency, conn->done * sizeof(uint32_t));
+    done += conn->done;
+    errors += conn->errors;
+    excMismatch += conn->excMismatch;
+    dataMismatch += conn->dataMismatch;
+  }
+  elapsed = timeNs() - startTime;
+
+  printf("%zu requests on %d connections in %.3f s (%.0f requests/s)\n", total, connCount,
+    elapsed / 1e9, total / (elapsed / 1e9));
+  printf("%zu failed, %zu exception mismatches, %zu data mismatches\n\n", errors, excMismatch, dataMismatch);
+  printf("%-20s %10s %10s %10s %10s\n", "", "avg/us", "p50/us", "p99/us", "max/us");
+  printLatency("replay round trip", latency, done);
+  printLatency("captured service", captured, total);
+
+  ret = (errors == 0 && excMismatch == 0) ? 0 : 2;
+  free(latency);
+
+  // connections are released on exit
+fail2:
+  free(recs);
+  free(captured);
+fail1:
+  free((void *) data);
+fail0:
+  return ret;
+}
+
@@ -0,0 +1,359 @@
+#include "rtapi.h"
+#include "rtapi_app.h"
+#include "hal.h"
+
+#include "mbslave_rtxfmt.h"
+
+// Realtime companion of mbslave. It exports the pins of all slaves with a
+// realtime node and owns them from then on. The update function applies the
+// writes queued by mbslave and publishes the pin values to the input image,
+// so mbslave never touches HAL memory from its client threads. FIFO strobes
+// are sampled here too, so edges shorter than the poll period of mbslave
+// still latch their value.
+
+MODULE_AUTHOR("Sascha Ittner <sascha.ittner@modusoft.de>");
+MODULE_DESCRIPTION("Realtime pin access for the LinuxCNC modbus slave");
+MODULE_LICENSE("GPL");
+
+static int keys[LCMBS_RTX_SLAVES_MAX] = { LCMBS_RTX_KEY_DEFAULT };
+RTAPI_MP_ARRAY_INT(keys, LCMBS_RTX_SLAVES_MAX, "realtime keys of the mbslave slaves");
+static int max_writes = 256;
+RTAPI_MP_INT(max_writes, "queued writes applied per slave and period");
+
+typedef struct {
+  union {
+    hal_bit_t *b;
+    hal_u32_t *u;
+    hal_s32_t *s;
+    hal_float_t *f;
+  } ptr;
+  hal_type_t type;
+  hal_pin_dir_t dir;
+} LCMBS_RT_PIN_T;
+
+typedef struct {
+  LCMBS_RTX_EVENT_T *ring;
+  rtapi_u32 strobe;
+  rtapi_u32 value;
+  hal_bit_t last;
+} LCMBS_RT_EVENT_T;
+
+typedef struct {
+  int ctrlId;
+  int dataId;
+  int attached;
+  LCMBS_RTX_CTRL_T *ctrl;
+  LCMBS_RTX_VAL_T *image;
+  LCMBS_RTX_WRITE_T *queue;
+  rtapi_u32 pinCount;
+  rtapi_u32 queueMask;
+  LCMBS_RT_PIN_T *pins;
+  rtapi_u32 eventCount;
+  LCMBS_RT_EVENT_T *events;
+} LCMBS_RT_SLAVE_T;
+
+static const char *compName = "mbslave_rt";
+
+static int compId;
+static int slaveCount;
+static LCMBS_RT_SLAVE_T slaves[LCMBS_RTX_SLAVES_MAX];
+
+static void update(void *arg, long period);
+
+static int attachSlave(LCMBS_RT_SLAVE_T *slave, int key) {
+  LCMBS_RTX_CTRL_T *ctrl;
+  LCMBS_RTX_PIN_T *table;
+  LCMBS_RTX_EVENT_T *rings;
+  char *data;
+  char name[LCMBS_RTX_NAME_LEN];
+  rtapi_u32 i;
+  int j;
+
+  // map control segment
+  slave->ctrlId = rtapi_shmem_new(key, compId, sizeof(LCMBS_RTX_CTRL_T));
+  if (slave->ctrlId < 0 || rtapi_shmem_getptr(slave->ctrlId, (void **) &slave->ctrl) < 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: unable to map control segment %08x\n", compName, key);
+    return -1;
+  }
+  ctrl = slave->ctrl;
+
+  // mbslave has to publish its pin table first
+  if (ctrl->magic != LCMBS_RTX_MAGIC || ctrl->version != LCMBS_RTX_VERSION || !__atomic_load_n(&ctrl->ready, __ATOMIC_ACQUIRE)) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: no pin table under key %08x, start mbslave first\n", compName, key);
+    return -1;
+  }
+  if (ctrl->attached) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: key %08x already attached\n", compName, key);
+    return -1;
+  }
+  if (ctrl->queueSize == 0 || (ctrl->queueSize & (ctrl->queueSize - 1)) != 0 || ctrl->size != lcmbsRtxDataSize(ctrl->pinCount, ctrl->queueSize, ctrl->eventCount)) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: invalid control segment %08x\n", compName, key);
+    return -1;
+  }
+  slave->pinCount = ctrl->pinCount;
+  slave->queueMask = ctrl->queueSize - 1;
+  slave->eventCount = ctrl->eventCount;
+
+  // map data segment
+  slave->dataId = rtapi_shmem_new(key + 1, compId, ctrl->size);
+  if (slave->dataId < 0 || rtapi_shmem_getptr(slave->dataId, (void **) &data) < 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: unable to map data segment %08x\n", compName, key + 1);
+    return -1;
+  }
+  table = (LCMBS_RTX_PIN_T *) data;
+  slave->image = (LCMBS_RTX_VAL_T *) (data + lcmbsRtxImageOffset(slave->pinCount));
+  slave->queue = (LCMBS_RTX_WRITE_T *) (data + lcmbsRtxQueueOffset(slave->pinCount));
+  rings = (LCMBS_RTX_EVENT_T *) (data + lcmbsRtxEventOffset(slave->pinCount, ctrl->queueSize));
+
+  if (slave->pinCount == 0) {
+    return 0;
+  }
+
+  // pin pointers must live in hal memory
+  slave->pins = hal_malloc(slave->pinCount * sizeof(LCMBS_RT_PIN_T));
+  if (slave->pins == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: hal_malloc failed\n", compName);
+    return -1;
+  }
+
+  // types are copied once, the table is not trusted later on
+  for (i = 0; i < slave->pinCount; i++) {
+    LCMBS_RT_PIN_T *pin = &slave->pins[i];
+    for (j = 0; j < LCMBS_RTX_NAME_LEN - 1 && table[i].name[j] != 0; j++) {
+      name[j] = table[i].name[j];
+    }
+    name[j] = 0;
+
+    pin->type = table[i].type;
+    pin->dir = table[i].dir;
+    if (pin->type != HAL_BIT && pin->type != HAL_U32 && pin->type != HAL_S32 && pin->type != HAL_FLOAT) {
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: invalid type of pin %s\n", compName, name);
+      return -1;
+    }
+    if (pin->dir != HAL_IN && pin->dir != HAL_OUT && pin->dir != HAL_IO) {
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: invalid direction of pin %s\n", compName, name);
+      return -1;
+    }
+
+    if (hal_pin_new(name, pin->type, pin->dir, (void **) &pin->ptr.b, compId) < 0) {
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: unable to export pin %s\n", compName, name);
+      return -1;
+    }
+  }
+
+  if (slave->eventCount == 0) {
+    return 0;
+  }
+
+  slave->events = hal_malloc(slave->eventCount * sizeof(LCMBS_RT_EVENT_T));
+  if (slave->events == NULL) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: hal_malloc failed\n", compName);
+    return -1;
+  }
+
+  // indexes are copied once as well, update() relies on them
+  for (i = 0; i < slave->eventCount; i++) {
+    LCMBS_RT_EVENT_T *event = &slave->events[i];
+    event->ring = &rings[i];
+    event->strobe = rings[i].strobe;
+    event->value = rings[i].value;
+    if (event->strobe >= slave->pinCount || event->value >= slave->pinCount ||
+      slave->pins[event->strobe].type != HAL_BIT || slave->pins[event->strobe].dir == HAL_OUT ||
+      (slave->pins[event->value].type != HAL_U32 && slave->pins[event->value].type != HAL_S32)) {
+      rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: invalid event ring %u of key %08x\n", compName, (unsigned) i, key);
+      return -1;
+    }
+
+    // a strobe that is already high when loaded is no edge
+    event->last = 1;
+  }
+
+  return 0;
+}
+
+static void detachSlaves(void) {
+  int i;
+
+  for (i = 0; i < slaveCount; i++) {
+    LCMBS_RT_SLAVE_T *slave = &slaves[i];
+    if (slave->attached) {
+      __atomic_store_n(&slave->ctrl->attached, 0, __ATOMIC_RELEASE);
+    }
+    if (slave->dataId >= 0) {
+      rtapi_shmem_delete(slave->dataId, compId);
+    }
+    if (slave->ctrlId >= 0) {
+      rtapi_shmem_delete(slave->ctrlId, compId);
+    }
+  }
+}
+
+int rtapi_app_main(void) {
+  int i;
+
+  if (max_writes < 1) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: max_writes must be at least 1\n", compName);
+    goto fail0;
+  }
+
+  compId = hal_init(compName);
+  if (compId < 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: hal_init failed\n", compName);
+    goto fail0;
+  }
+
+  // attach all configured slaves
+  for (i = 0; i < LCMBS_RTX_SLAVES_MAX && keys[i] != 0; i++) {
+    LCMBS_RT_SLAVE_T *slave = &slaves[slaveCount++];
+    slave->ctrlId = -1;
+    slave->dataId = -1;
+    if (attachSlave(slave, keys[i])) {
+      goto fail1;
+    }
+  }
+
+  if (hal_export_funct("mbslave-rt.update", update, NULL, 1, 0, compId) < 0) {
+    rtapi_print_msg(RTAPI_MSG_ERR, "%s: ERROR: unable to export update function\n", compName);
+    goto fail1;
+  }
+
+  // mbslave queues writes from now on
+  for (i = 0; i < slaveCount; i++) {
+    __atomic_store_n(&slaves[i].ctrl->attached, 1, __ATOMIC_RELEASE);
+    slaves[i].attached = 1;
+  }
+
+  hal_ready(compId);
+  return 0;
+
+fail1:
+  detachSlaves();
+  hal_exit(compId);
+fail0:
+  return -1;
+}
+
+void rtapi_app_exit(void) {
+  detachSlaves();
+  hal_exit(compId);
+}
+
+static void applyWrites(LCMBS_RT_SLAVE_T *slave) {
+  LCMBS_RTX_CTRL_T *ctrl = slave->ctrl;
+  rtapi_u64 tail = ctrl->tail;
+  rtapi_u64 head = __atomic_load_n(&ctrl->head, __ATOMIC_ACQUIRE);
+
+  // bound the work per period, the rest is applied in the next ones
+  if (head - tail > (rtapi_u64) max_writes) {
+    head = tail + max_writes;
+  }
+
+  for (; tail != head; tail++) {
+    LCMBS_RTX_WRITE_T *entry = &slave->queue[tail & slave->queueMask];
+    LCMBS_RT_PIN_T *pin;
+    if (entry->index >= slave->pinCount) {
+      continue;
+    }
+    pin = &slave->pins[entry->index];
+    switch (pin->type) {
+      case HAL_BIT:
+        *pin->ptr.b = entry->val.b;
+        break;
+      case HAL_U32:
+        *pin->ptr.u = entry->val.u;
+        break;
+      case HAL_S32:
+        *pin->ptr.s = entry->val.s;
+        break;
+      case HAL_FLOAT:
+        *pin->ptr.f = entry->val.f;
+        break;
+      default:
+        break;
+    }
+  }
+
+  // hand the slots back to mbslave
+  __atomic_store_n(&ctrl->tail, tail, __ATOMIC_RELEASE);
+}
+
+static void publishImage(LCMBS_RT_SLAVE_T *slave) {
+  LCMBS_RTX_CTRL_T *ctrl = slave->ctrl;
+  rtapi_u32 seq = ctrl->seq;
+  rtapi_u32 i;
+
+  // enter write side of seqlock
+  __atomic_store_n(&ctrl->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  // outputs are kept up to date by mbslave itself
+  for (i = 0; i < slave->pinCount; i++) {
+    LCMBS_RT_PIN_T *pin = &slave->pins[i];
+    LCMBS_RTX_VAL_T *val = &slave->image[i];
+    if (pin->dir == HAL_OUT) {
+      continue;
+    }
+    switch (pin->type) {
+      case HAL_BIT:
+        val->b = *pin->ptr.b;
+        break;
+      case HAL_U32:
+        val->u = *pin->ptr.u;
+        break;
+      case HAL_S32:
+        val->s = *pin->ptr.s;
+        break;
+      case HAL_FLOAT:
+        val->f = *pin->ptr.f;
+        break;
+      default:
+        break;
+    }
+  }
+
+  // the cycle registers tell how fresh this image is
+  __atomic_store_n(&ctrl->periods, ctrl->periods + 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&ctrl->timestamp, (rtapi_u64) rtapi_get_time(), __ATOMIC_RELAXED);
+  __atomic_store_n(&ctrl->applied, ctrl->tail, __ATOMIC_RELAXED);
+
+  // leave write side of seqlock
+  __atomic_store_n(&ctrl->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static void captureEvents(LCMBS_RT_SLAVE_T *slave) {
+  rtapi_u32 i;
+
+  for (i = 0; i < slave->eventCount; i++) {
+    LCMBS_RT_EVENT_T *event = &slave->events[i];
+    LCMBS_RTX_EVENT_T *ring = event->ring;
+    hal_bit_t strobe = *slave->pins[event->strobe].ptr.b;
+    rtapi_u64 head;
+
+    if (!strobe || event->last) {
+      event->last = strobe;
+      continue;
+    }
+    event->last = strobe;
+
+    // latch the value of the rising edge
+    head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LCMBS_RTX_EVENT_SLOTS) {
+      __atomic_fetch_add(&ring->lost, 1, __ATOMIC_RELAXED);
+      continue;
+    }
+    ring->vals[head & (LCMBS_RTX_EVENT_SLOTS - 1)].u = *slave->pins[event->value].ptr.u;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+  }
+}
+
+static void update(void *arg, long period) {
+  int i;
+
+  // writes first, so the image of this period already shows them
+  for (i = 0; i < slaveCount; i++) {
+    applyWrites(&slaves[i]);
+    captureEvents(&slaves[i]);
+    publishImage(&slaves[i]);
+  }
+}
+
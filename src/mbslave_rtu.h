@@ -0,0 +1,13 @@
+#ifndef _LCMBS_RTU_H
+#define _LCMBS_RTU_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LCMBS_RTU_FRAME_MAX 256
+
+uint16_t lcmbsRtuCrc16(const uint8_t *data, size_t len);
+int lcmbsRtuRequestLen(const uint8_t *data, size_t count);
+
+#endif
+
@@ -0,0 +1,438 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mbslave_rtx.h"
+
+// writers give up on a full queue after 100ms, the
+// realtime function is not running then
+#define WAIT_US    100
+#define WAIT_COUNT 1000
+
+int lcmbsRtxActive;
+
+static LCMBS_RTX_T *exchanges[LCMBS_RTX_SLAVES_MAX];
+static int exchangeCount;
+
+static void *attachSegment(int *id, int key, int compId, unsigned long size) {
+  void *ptr;
+
+  *id = rtapi_shmem_new(key, compId, size);
+  if (*id < 0) {
+    return NULL;
+  }
+  if (rtapi_shmem_getptr(*id, &ptr) < 0) {
+    rtapi_shmem_delete(*id, compId);
+    *id = -1;
+    return NULL;
+  }
+
+  return ptr;
+}
+
+LCMBS_RTX_T *lcmbsRtxCreate(int compId, const char *name, LCMBS_CONF_RTX_T *conf, uint32_t pinCount, uint32_t eventCount) {
+  LCMBS_RTX_T *rtx;
+  LCMBS_RTX_CTRL_T *ctrl;
+  unsigned long size = lcmbsRtxDataSize(pinCount, conf->queueSize, eventCount);
+  pthread_rwlockattr_t attr;
+  uint8_t *data;
+  uint32_t i;
+
+  if (exchangeCount >= LCMBS_RTX_SLAVES_MAX) {
+    fprintf(stderr, "%s: ERROR: Too many realtime slaves\n", compName);
+    goto fail0;
+  }
+
+  // alloc memory
+  rtx = calloc(1, sizeof(LCMBS_RTX_T));
+  if (!rtx) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for realtime slave %s\n", compName, name);
+    goto fail0;
+  }
+  strcpy(rtx->name, name);
+  rtx->pinCount = pinCount;
+  rtx->queueSize = conf->queueSize;
+  rtx->eventCount = eventCount;
+  rtx->ctrlId = -1;
+  rtx->dataId = -1;
+
+  rtx->pins = calloc(pinCount + 1, sizeof(LCMBS_RTX_PIN_T));
+  rtx->slots = calloc(pinCount + 1, sizeof(void *));
+  rtx->shadow = calloc(pinCount + 1, sizeof(LCMBS_RTX_VAL_T));
+  rtx->written = calloc(pinCount + 1, sizeof(LCMBS_RTX_VAL_T));
+  rtx->pending = calloc(pinCount + 1, sizeof(uint64_t));
+  rtx->eventPins = calloc(eventCount + 1, sizeof(LCMBS_RTX_EVENT_PINS_T));
+  if (!rtx->pins || !rtx->slots || !rtx->shadow || !rtx->written || !rtx->pending || !rtx->eventPins) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for realtime slave %s\n", compName, name);
+    goto fail1;
+  }
+
+  // map control segment
+  ctrl = attachSegment(&rtx->ctrlId, conf->key, compId, sizeof(LCMBS_RTX_CTRL_T));
+  if (!ctrl) {
+    fprintf(stderr, "%s: ERROR: Unable to create realtime control segment %08x\n", compName, conf->key);
+    goto fail1;
+  }
+  rtx->ctrl = ctrl;
+
+  // a loaded module keeps its pins, a restarted mbslave
+  // has to come up with the same pin table
+  if (ctrl->magic == LCMBS_RTX_MAGIC && __atomic_load_n(&ctrl->attached, __ATOMIC_ACQUIRE)) {
+    if (ctrl->version != LCMBS_RTX_VERSION || ctrl->size != size || ctrl->pinCount != pinCount || ctrl->queueSize != rtx->queueSize || ctrl->eventCount != eventCount) {
+      fprintf(stderr, "%s: ERROR: mbslave_rt holds a different pin table for slave %s, reload it.\n", compName, name);
+      goto fail2;
+    }
+    rtx->reused = 1;
+  } else {
+    memset(ctrl, 0, sizeof(LCMBS_RTX_CTRL_T));
+    ctrl->magic = LCMBS_RTX_MAGIC;
+    ctrl->version = LCMBS_RTX_VERSION;
+    ctrl->size = size;
+    ctrl->pinCount = pinCount;
+    ctrl->queueSize = rtx->queueSize;
+    ctrl->eventCount = eventCount;
+  }
+
+  // map data segment
+  data = attachSegment(&rtx->dataId, conf->key + 1, compId, size);
+  if (!data) {
+    fprintf(stderr, "%s: ERROR: Unable to create realtime data segment %08x\n", compName, conf->key + 1);
+    goto fail2;
+  }
+  if (!rtx->reused) {
+    memset(data, 0, size);
+  }
+  rtx->table = (LCMBS_RTX_PIN_T *) data;
+  rtx->image = (LCMBS_RTX_VAL_T *) (data + lcmbsRtxImageOffset(pinCount));
+  rtx->queue = (LCMBS_RTX_WRITE_T *) (data + lcmbsRtxQueueOffset(pinCount));
+  rtx->events = (LCMBS_RTX_EVENT_T *) (data + lcmbsRtxEventOffset(pinCount, rtx->queueSize));
+
+  // pin slots point to the private copy for good
+  for (i = 0; i < pinCount; i++) {
+    rtx->slots[i] = &rtx->shadow[i];
+  }
+
+  // a steady stream of requests must not hold off refreshes
+  pthread_rwlockattr_init(&attr);
+  pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+  pthread_rwlock_init(&rtx->shadowLock, &attr);
+  pthread_rwlockattr_destroy(&attr);
+  pthread_mutex_init(&rtx->writeLock, NULL);
+  exchanges[exchangeCount++] = rtx;
+  lcmbsRtxActive = 1;
+
+  return rtx;
+
+fail2:
+  rtapi_shmem_delete(rtx->ctrlId, compId);
+fail1:
+  free(rtx->eventPins);
+  free(rtx->pending);
+  free(rtx->written);
+  free(rtx->shadow);
+  free(rtx->slots);
+  free(rtx->pins);
+  free(rtx);
+fail0:
+  return NULL;
+}
+
+void **lcmbsRtxAddPin(LCMBS_RTX_T *rtx, const char *name, hal_type_t type, hal_pin_dir_t dir) {
+  LCMBS_RTX_PIN_T *pin;
+
+  if (rtx->used >= rtx->pinCount) {
+    return NULL;
+  }
+
+  pin = &rtx->pins[rtx->used];
+  strncpy(pin->name, name, LCMBS_RTX_NAME_LEN - 1);
+  pin->type = type;
+  pin->dir = dir;
+
+  return &rtx->slots[rtx->used++];
+}
+
+int lcmbsRtxFindEvent(LCMBS_RTX_T *rtx, void **strobe, void **value) {
+  uint32_t i;
+
+  for (i = 0; i < rtx->eventsUsed; i++) {
+    if (rtx->slots + rtx->eventPins[i].strobe == strobe && rtx->slots + rtx->eventPins[i].value == value) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+int lcmbsRtxAddEvent(LCMBS_RTX_T *rtx, void **strobe, void **value) {
+  LCMBS_RTX_EVENT_PINS_T *event;
+  int idx;
+
+  // reloads register the unchanged queues again
+  idx = lcmbsRtxFindEvent(rtx, strobe, value);
+  if (idx >= 0) {
+    return idx;
+  }
+
+  // mbslave_rt reads the event table only when attaching
+  if (rtx->eventsUsed >= rtx->eventCount || __atomic_load_n(&rtx->ctrl->ready, __ATOMIC_ACQUIRE)) {
+    fprintf(stderr, "%s: ERROR: Fifo queues of realtime slave %s changed, restart required.\n", compName, rtx->name);
+    return -1;
+  }
+
+  event = &rtx->eventPins[rtx->eventsUsed];
+  event->strobe = strobe - rtx->slots;
+  event->value = value - rtx->slots;
+
+  return rtx->eventsUsed++;
+}
+
+int lcmbsRtxPublish(LCMBS_RTX_T *rtx) {
+  LCMBS_RTX_CTRL_T *ctrl = rtx->ctrl;
+  size_t len = rtx->pinCount * sizeof(LCMBS_RTX_PIN_T);
+  uint32_t i;
+
+  if (rtx->used != rtx->pinCount || rtx->eventsUsed != rtx->eventCount) {
+    fprintf(stderr, "%s: ERROR: Pin count of realtime slave %s mismatch\n", compName, rtx->name);
+    return -1;
+  }
+
+  if (rtx->reused) {
+    if (len > 0 && memcmp(rtx->table, rtx->pins, len) != 0) {
+      fprintf(stderr, "%s: ERROR: mbslave_rt holds a different pin table for slave %s, reload it.\n", compName, rtx->name);
+      return -1;
+    }
+    for (i = 0; i < rtx->eventCount; i++) {
+      if (rtx->events[i].strobe != rtx->eventPins[i].strobe || rtx->events[i].value != rtx->eventPins[i].value) {
+        fprintf(stderr, "%s: ERROR: mbslave_rt holds different fifo queues for slave %s, reload it.\n", compName, rtx->name);
+        return -1;
+      }
+    }
+    return 0;
+  }
+
+  // the table stays as it is once published
+  if (__atomic_load_n(&ctrl->ready, __ATOMIC_ACQUIRE)) {
+    return 0;
+  }
+
+  // mbslave_rt may attach from now on
+  if (len > 0) {
+    memcpy(rtx->table, rtx->pins, len);
+  }
+  for (i = 0; i < rtx->eventCount; i++) {
+    rtx->events[i].strobe = rtx->eventPins[i].strobe;
+    rtx->events[i].value = rtx->eventPins[i].value;
+  }
+  __atomic_store_n(&ctrl->ready, 1, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+void lcmbsRtxFree(LCMBS_RTX_T *rtx, int compId) {
+  int i;
+
+  // no writer is left at this point
+  for (i = 0; i < exchangeCount; i++) {
+    if (exchanges[i] == rtx) {
+      exchanges[i] = exchanges[--exchangeCount];
+      break;
+    }
+  }
+  lcmbsRtxActive = exchangeCount > 0;
+
+  // a stale table must not be picked up by a later module load,
+  // an attached module keeps the segments alive
+  if (!__atomic_load_n(&rtx->ctrl->attached, __ATOMIC_ACQUIRE)) {
+    __atomic_store_n(&rtx->ctrl->ready, 0, __ATOMIC_RELEASE);
+  }
+
+  rtapi_shmem_delete(rtx->dataId, compId);
+  rtapi_shmem_delete(rtx->ctrlId, compId);
+  pthread_mutex_destroy(&rtx->writeLock);
+  pthread_rwlock_destroy(&rtx->shadowLock);
+  free(rtx->eventPins);
+  free(rtx->pending);
+  free(rtx->written);
+  free(rtx->shadow);
+  free(rtx->slots);
+  free(rtx->pins);
+  free(rtx);
+}
+
+static void putValue(volatile LCMBS_RTX_VAL_T *dst, hal_type_t type, LCMBS_RTX_VAL_T *val) {
+  switch (type) {
+    case HAL_BIT:
+      dst->b = val->b;
+      break;
+    case HAL_S32:
+      dst->s = val->s;
+      break;
+    case HAL_FLOAT:
+      dst->f = val->f;
+      break;
+    default:
+      dst->u = val->u;
+  }
+}
+
+static void refreshShadow(LCMBS_RTX_T *rtx) {
+  LCMBS_RTX_CTRL_T *ctrl = rtx->ctrl;
+  uint64_t applied;
+  uint32_t s1, s2, i;
+
+  // copy image and its period under the seqlock
+  while (1) {
+    s1 = __atomic_load_n(&ctrl->seq, __ATOMIC_ACQUIRE);
+    if (s1 & 1) {
+      continue;
+    }
+    memcpy(rtx->shadow, (const void *) rtx->image, rtx->pinCount * sizeof(LCMBS_RTX_VAL_T));
+    rtx->cycle = __atomic_load_n(&ctrl->periods, __ATOMIC_RELAXED);
+    rtx->timestamp = __atomic_load_n(&ctrl->timestamp, __ATOMIC_RELAXED);
+    applied = __atomic_load_n(&ctrl->applied, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    s2 = __atomic_load_n(&ctrl->seq, __ATOMIC_RELAXED);
+    if (s1 == s2) {
+      break;
+    }
+  }
+
+  // queued writes the image does not show yet keep their value
+  pthread_mutex_lock(&rtx->writeLock);
+  for (i = 0; i < rtx->pinCount; i++) {
+    if (rtx->pending[i] == 0) {
+      continue;
+    }
+    if (rtx->pending[i] <= applied) {
+      rtx->pending[i] = 0;
+      continue;
+    }
+    putValue(&rtx->shadow[i], rtx->pins[i].type, &rtx->written[i]);
+  }
+  pthread_mutex_unlock(&rtx->writeLock);
+
+  rtx->shadowSeq = s1;
+  rtx->shadowValid = 1;
+}
+
+void lcmbsRtxBegin(LCMBS_RTX_T *rtx) {
+  if (rtx == NULL) {
+    return;
+  }
+
+  pthread_rwlock_rdlock(&rtx->shadowLock);
+  if (rtx->shadowValid && rtx->shadowSeq == __atomic_load_n(&rtx->ctrl->seq, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  pthread_rwlock_unlock(&rtx->shadowLock);
+
+  // the first caller after a new period refreshes the copy
+  pthread_rwlock_wrlock(&rtx->shadowLock);
+  if (!rtx->shadowValid || rtx->shadowSeq != __atomic_load_n(&rtx->ctrl->seq, __ATOMIC_ACQUIRE)) {
+    refreshShadow(rtx);
+  }
+  pthread_rwlock_unlock(&rtx->shadowLock);
+
+  pthread_rwlock_rdlock(&rtx->shadowLock);
+}
+
+void lcmbsRtxEnd(LCMBS_RTX_T *rtx) {
+  if (rtx != NULL) {
+    pthread_rwlock_unlock(&rtx->shadowLock);
+  }
+}
+
+void lcmbsRtxGetCycle(LCMBS_RTX_T *rtx, uint64_t *cycle, uint64_t *timestamp) {
+  if (rtx == NULL) {
+    *cycle = 0;
+    *timestamp = 0;
+    return;
+  }
+
+  // period of the copy the current request reads
+  *cycle = rtx->cycle;
+  *timestamp = rtx->timestamp;
+}
+
+int lcmbsRtxPopEvent(LCMBS_RTX_T *rtx, int event, LCMBS_RTX_VAL_T *val) {
+  LCMBS_RTX_EVENT_T *ring = &rtx->events[event];
+  uint64_t tail = ring->tail;
+
+  // the fifo sampler is the only consumer
+  if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+    return 0;
+  }
+  *val = ring->vals[tail & (LCMBS_RTX_EVENT_SLOTS - 1)];
+  __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+  return 1;
+}
+
+uint32_t lcmbsRtxEventLost(LCMBS_RTX_T *rtx, int event) {
+  return __atomic_load_n(&rtx->events[event].lost, __ATOMIC_RELAXED);
+}
+
+static void queueWrite(LCMBS_RTX_T *rtx, uint32_t idx, hal_type_t type, LCMBS_RTX_VAL_T *val) {
+  LCMBS_RTX_CTRL_T *ctrl = rtx->ctrl;
+  LCMBS_RTX_WRITE_T *entry;
+  uint64_t head;
+  int wait;
+
+  // the realtime function frees slots every period; wait for one without
+  // holding the lock, so a full queue doesn't block the other writers
+  for (wait = 0; ; wait++) {
+    pthread_mutex_lock(&rtx->writeLock);
+    head = ctrl->head;
+    if (head - __atomic_load_n(&ctrl->tail, __ATOMIC_ACQUIRE) < rtx->queueSize) {
+      break;
+    }
+    pthread_mutex_unlock(&rtx->writeLock);
+
+    if (wait >= WAIT_COUNT) {
+      __atomic_add_fetch(&ctrl->overruns, 1, __ATOMIC_RELAXED);
+      if (!__atomic_exchange_n(&rtx->warned, 1, __ATOMIC_RELAXED)) {
+        fprintf(stderr, "%s: WARNING: realtime write queue of slave %s full, is mbslave_rt running?\n", compName, rtx->name);
+      }
+      return;
+    }
+    usleep(WAIT_US);
+  }
+
+  entry = &rtx->queue[head & (rtx->queueSize - 1)];
+  entry->index = idx;
+  putValue(&entry->val, type, val);
+
+  // reads see the value at once, refreshes keep it
+  // until the image shows this queue entry
+  putValue(&rtx->written[idx], type, val);
+  putValue(&rtx->shadow[idx], type, val);
+  rtx->pending[idx] = head + 1;
+
+  // outputs have no other writer
+  if (rtx->pins[idx].dir == HAL_OUT) {
+    putValue(&rtx->image[idx], type, val);
+  }
+
+  __atomic_store_n(&ctrl->head, head + 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&rtx->writeLock);
+}
+
+void lcmbsRtxWrite(volatile void *pin, hal_type_t type, LCMBS_RTX_VAL_T *val) {
+  volatile LCMBS_RTX_VAL_T *cell = pin;
+  int i;
+
+  for (i = 0; i < exchangeCount; i++) {
+    LCMBS_RTX_T *rtx = exchanges[i];
+    if (cell >= rtx->shadow && cell < rtx->shadow + rtx->pinCount) {
+      queueWrite(rtx, cell - rtx->shadow, type, val);
+      return;
+    }
+  }
+
+  // pin of a slave without realtime node
+  putValue(cell, type, val);
+}
+
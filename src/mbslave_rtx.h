@@ -0,0 +1,124 @@
+#ifndef _LCMBS_RTX_H
+#define _LCMBS_RTX_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "mbslave_util.h"
+#include "mbslave_conf.h"
+#include "mbslave_rtxfmt.h"
+
+// Userspace side of the mbslave_rt exchange. Pins of a realtime slave are
+// slots pointing into a private copy of the input image. Every request and
+// sampler pass runs between lcmbsRtxBegin() and lcmbsRtxEnd(), which take
+// a new copy under the seqlock once the realtime function published one.
+// The copy does not change in between, so multi register reads and the
+// cycle registers always show a single period.
+//
+// Writes have to go through the lcmbsPinSet helpers, which queue them for
+// the realtime function and update the copy right away. Until a published
+// image reflects a write, refreshed copies keep the written value. Output
+// pins are only written by mbslave, their image entries are updated right
+// away and skipped by the realtime copy.
+//
+// FIFO strobes are registered as events before the table is published. The
+// realtime function latches the value on each rising strobe edge, the FIFO
+// sampler pops them with lcmbsRtxPopEvent().
+
+typedef struct {
+  uint32_t strobe;
+  uint32_t value;
+} LCMBS_RTX_EVENT_PINS_T;
+
+typedef struct LCMBS_RTX {
+  char name[HAL_NAME_LEN];
+  int ctrlId;
+  int dataId;
+  LCMBS_RTX_CTRL_T *ctrl;
+  LCMBS_RTX_PIN_T *table;
+  LCMBS_RTX_VAL_T *image;
+  LCMBS_RTX_WRITE_T *queue;
+  LCMBS_RTX_EVENT_T *events;
+  LCMBS_RTX_PIN_T *pins;
+  LCMBS_RTX_EVENT_PINS_T *eventPins;
+  void **slots;
+  LCMBS_RTX_VAL_T *shadow;
+  LCMBS_RTX_VAL_T *written;
+  uint64_t *pending;
+  uint32_t shadowSeq;
+  int shadowValid;
+  uint64_t cycle;
+  uint64_t timestamp;
+  pthread_rwlock_t shadowLock;
+  uint32_t pinCount;
+  uint32_t used;
+  uint32_t queueSize;
+  uint32_t eventCount;
+  uint32_t eventsUsed;
+  int reused;
+  int warned;
+  pthread_mutex_t writeLock;
+} LCMBS_RTX_T;
+
+extern int lcmbsRtxActive;
+
+LCMBS_RTX_T *lcmbsRtxCreate(int compId, const char *name, LCMBS_CONF_RTX_T *conf, uint32_t pinCount, uint32_t eventCount);
+void **lcmbsRtxAddPin(LCMBS_RTX_T *rtx, const char *name, hal_type_t type, hal_pin_dir_t dir);
+int lcmbsRtxAddEvent(LCMBS_RTX_T *rtx, void **strobe, void **value);
+int lcmbsRtxFindEvent(LCMBS_RTX_T *rtx, void **strobe, void **value);
+int lcmbsRtxPopEvent(LCMBS_RTX_T *rtx, int event, LCMBS_RTX_VAL_T *val);
+uint32_t lcmbsRtxEventLost(LCMBS_RTX_T *rtx, int event);
+int lcmbsRtxPublish(LCMBS_RTX_T *rtx);
+void lcmbsRtxFree(LCMBS_RTX_T *rtx, int compId);
+void lcmbsRtxBegin(LCMBS_RTX_T *rtx);
+void lcmbsRtxEnd(LCMBS_RTX_T *rtx);
+void lcmbsRtxGetCycle(LCMBS_RTX_T *rtx, uint64_t *cycle, uint64_t *timestamp);
+
+void lcmbsRtxWrite(volatile void *pin, hal_type_t type, LCMBS_RTX_VAL_T *val);
+
+static inline void lcmbsPinSetBit(hal_bit_t **pin, int val) {
+  LCMBS_RTX_VAL_T v;
+
+  if (!lcmbsRtxActive) {
+    **pin = val;
+    return;
+  }
+  v.b = val;
+  lcmbsRtxWrite(*pin, HAL_BIT, &v);
+}
+
+static inline void lcmbsPinSetU32(hal_u32_t **pin, uint32_t val) {
+  LCMBS_RTX_VAL_T v;
+
+  if (!lcmbsRtxActive) {
+    **pin = val;
+    return;
+  }
+  v.u = val;
+  lcmbsRtxWrite(*pin, HAL_U32, &v);
+}
+
+static inline void lcmbsPinSetS32(hal_s32_t **pin, int32_t val) {
+  LCMBS_RTX_VAL_T v;
+
+  if (!lcmbsRtxActive) {
+    **pin = val;
+    return;
+  }
+  v.s = val;
+  lcmbsRtxWrite(*pin, HAL_S32, &v);
+}
+
+static inline void lcmbsPinSetFloat(hal_float_t **pin, double val) {
+  LCMBS_RTX_VAL_T v;
+
+  if (!lcmbsRtxActive) {
+    **pin = val;
+    return;
+  }
+  v.f = val;
+  lcmbsRtxWrite(*pin, HAL_FLOAT, &v);
+}
+
+#endif
+
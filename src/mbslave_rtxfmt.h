@@ -0,0 +1,109 @@
+#ifndef _LCMBS_RTXFMT_H
+#define _LCMBS_RTXFMT_H
+
+#include "rtapi.h"
+#include "hal.h"
+
+// Layout of the exchange between mbslave and the mbslave_rt realtime module
+//
+// A slave with a realtime node exports no HAL pins itself. It creates two
+// RTAPI shared memory segments instead: the control segment under the
+// configured key and the data segment under key + 1. The control segment
+// gives the data segment size, so the module can attach it when loaded.
+//
+// The data segment holds the pin table, the input image, the write queue
+// and the event rings, in this order. The pin table is complete once ready is set, the
+// module exports one HAL pin per entry and sets attached. The realtime
+// function owns all pins from then on. Every period it first applies the
+// queued writes and then copies all pin values to the image, the seqlock
+// counter seq is odd while the copy is in progress. The period counter, the
+// RTAPI time of the copy and the write queue tail it reflects change under
+// the same seqlock, so mbslave can tell which queued writes a copy shows.
+//
+// The write queue is a single producer, single consumer ring. mbslave
+// serializes its writers and advances head, the module advances tail. Both
+// counters live on their own cache line, so neither side dirties the line
+// the other one writes.
+//
+// Event rings capture FIFO queue values in the realtime thread. Each ring
+// names a strobe bit pin and a value pin. On every rising edge of the strobe
+// the module stores the value and advances head, mbslave drains the ring and
+// advances tail. Edges on a full ring are counted in lost.
+
+#define LCMBS_RTX_MAGIC   0x4d425458
+#define LCMBS_RTX_VERSION 4
+
+#define LCMBS_RTX_KEY_DEFAULT 0x4d425200
+#define LCMBS_RTX_SLAVES_MAX  8
+#define LCMBS_RTX_NAME_LEN    (HAL_NAME_LEN + 1)
+#define LCMBS_RTX_CACHE_LINE  64
+#define LCMBS_RTX_EVENT_SLOTS 64
+
+typedef union {
+  hal_bit_t b;
+  hal_u32_t u;
+  hal_s32_t s;
+  hal_float_t f;
+} LCMBS_RTX_VAL_T;
+
+typedef struct {
+  char name[LCMBS_RTX_NAME_LEN];
+  rtapi_s32 type;
+  rtapi_s32 dir;
+} LCMBS_RTX_PIN_T;
+
+typedef struct {
+  rtapi_u32 index;
+  rtapi_u32 reserved;
+  LCMBS_RTX_VAL_T val;
+} LCMBS_RTX_WRITE_T;
+
+typedef struct {
+  rtapi_u32 strobe;
+  rtapi_u32 value;
+  rtapi_u32 lost;
+  rtapi_u32 reserved;
+  rtapi_u64 head __attribute__((aligned(LCMBS_RTX_CACHE_LINE)));
+  rtapi_u64 tail __attribute__((aligned(LCMBS_RTX_CACHE_LINE)));
+  LCMBS_RTX_VAL_T vals[LCMBS_RTX_EVENT_SLOTS];
+} LCMBS_RTX_EVENT_T;
+
+typedef struct {
+  rtapi_u32 magic;
+  rtapi_u32 version;
+  rtapi_u32 size;
+  rtapi_u32 pinCount;
+  rtapi_u32 queueSize;
+  rtapi_u32 ready;
+  rtapi_u32 attached;
+  rtapi_u32 overruns;
+  rtapi_u32 seq;
+  rtapi_u32 eventCount;
+  rtapi_u64 periods;
+  rtapi_u64 timestamp;
+  rtapi_u64 applied;
+  rtapi_u64 head __attribute__((aligned(LCMBS_RTX_CACHE_LINE)));
+  rtapi_u64 tail __attribute__((aligned(LCMBS_RTX_CACHE_LINE)));
+} LCMBS_RTX_CTRL_T;
+
+static inline unsigned long lcmbsRtxImageOffset(rtapi_u32 pinCount) {
+  unsigned long off = pinCount * sizeof(LCMBS_RTX_PIN_T);
+  return (off + LCMBS_RTX_CACHE_LINE - 1) & ~(unsigned long) (LCMBS_RTX_CACHE_LINE - 1);
+}
+
+static inline unsigned long lcmbsRtxQueueOffset(rtapi_u32 pinCount) {
+  unsigned long off = lcmbsRtxImageOffset(pinCount) + pinCount * sizeof(LCMBS_RTX_VAL_T);
+  return (off + LCMBS_RTX_CACHE_LINE - 1) & ~(unsigned long) (LCMBS_RTX_CACHE_LINE - 1);
+}
+
+static inline unsigned long lcmbsRtxEventOffset(rtapi_u32 pinCount, rtapi_u32 queueSize) {
+  unsigned long off = lcmbsRtxQueueOffset(pinCount) + queueSize * sizeof(LCMBS_RTX_WRITE_T);
+  return (off + LCMBS_RTX_CACHE_LINE - 1) & ~(unsigned long) (LCMBS_RTX_CACHE_LINE - 1);
+}
+
+static inline unsigned long lcmbsRtxDataSize(rtapi_u32 pinCount, rtapi_u32 queueSize, rtapi_u32 eventCount) {
+  return lcmbsRtxEventOffset(pinCount, queueSize) + eventCount * sizeof(LCMBS_RTX_EVENT_T);
+}
+
+#endif
+
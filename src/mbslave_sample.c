@@ -0,0 +1,255 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+
+#include "mbslave_sample.h"
+#include "mbslave_rtx.h"
+
+static void *lcmbsSampleThread(void *arg);
+
+LCMBS_SAMPLE_DATA_T *lcmbsSampleStart(LCMBS_CONF_SAMPLE_T *conf, LCMBS_RCU_T *slave) {
+  LCMBS_SAMPLE_DATA_T *sample;
+  LCMBS_SAMPLE_RING_T *ring;
+
+  // alloc memory
+  sample = calloc(1, sizeof(LCMBS_SAMPLE_DATA_T));
+  if (!sample) {
+    goto fail0;
+  }
+
+  // the ring is allocated once, a reload can't resize it
+  ring = calloc(1, sizeof(LCMBS_SAMPLE_RING_T) + (size_t) conf->slots * conf->frameRegs * sizeof(uint16_t));
+  if (!ring) {
+    goto fail1;
+  }
+  ring->slots = conf->slots;
+  ring->frameRegs = conf->frameRegs;
+  ring->mode = conf->mode;
+  ring->state = (conf->mode == LCMBS_SAMPLE_TRIGGERED) ? LCMBS_SAMPLE_STATE_ARMED : LCMBS_SAMPLE_STATE_RUNNING;
+
+  // pins already set at start are no edge
+  ring->lastTrigger = 1;
+  ring->lastArm = 1;
+
+  // the capture is looked up by name on every
+  // period, a config reload may replace it
+  strcpy(sample->name, conf->name);
+  sample->slave = slave;
+  sample->ring = ring;
+
+  // start sampler thread
+  if (pthread_create(&sample->thread, 0, lcmbsSampleThread, sample)) {
+    goto fail2;
+  }
+
+  return sample;
+
+fail2:
+  free(ring);
+fail1:
+  free(sample);
+fail0:
+  return NULL;
+}
+
+void lcmbsSampleStop(LCMBS_SAMPLE_DATA_T *sample) {
+  // set exit flag, the thread sees it within a period
+  __atomic_store_n(&sample->exit_flag, 1, __ATOMIC_RELEASE);
+  pthread_join(sample->thread, NULL);
+
+  free(sample->ring);
+  free(sample);
+}
+
+int lcmbsSampleMatches(LCMBS_SAMPLE_DATA_T *sample, LCMBS_CONF_SAMPLE_T *conf) {
+  LCMBS_SAMPLE_RING_T *ring = sample->ring;
+  return ring->slots == conf->slots && ring->frameRegs == conf->frameRegs && ring->mode == conf->mode;
+}
+
+static void putLong(uint16_t *regs, uint32_t val) {
+  regs[0] = val >> 16;
+  regs[1] = val & 0xffff;
+}
+
+static void writeFrame(LCMBS_CONF_SAMPLE_T *sample, uint16_t *regs) {
+  union {
+    float f;
+    uint32_t u;
+  } fval;
+  uint32_t u;
+  int32_t s;
+  size_t i;
+
+  for (i = 0; i < sample->pins.count; i++) {
+    LCMBS_CONF_SAMPLE_PIN_T *pin = lcmbsVectGet(&sample->pins, i);
+    switch (pin->type) {
+      case LCMBS_PINTYPE_BIT:
+        *(regs++) = **pin->pin.b ? 1 : 0;
+        break;
+      case LCMBS_PINTYPE_U16:
+        u = **pin->pin.u;
+        *(regs++) = (u > USHRT_MAX) ? USHRT_MAX : u;
+        break;
+      case LCMBS_PINTYPE_S16:
+        s = **pin->pin.s;
+        if (s < SHRT_MIN) s = SHRT_MIN;
+        if (s > SHRT_MAX) s = SHRT_MAX;
+        *(regs++) = (uint16_t) s;
+        break;
+      case LCMBS_PINTYPE_U32:
+        putLong(regs, **pin->pin.u);
+        regs += 2;
+        break;
+      case LCMBS_PINTYPE_S32:
+        putLong(regs, (uint32_t) **pin->pin.s);
+        regs += 2;
+        break;
+      case LCMBS_PINTYPE_FLOAT:
+        fval.f = **pin->pin.f;
+        putLong(regs, fval.u);
+        regs += 2;
+        break;
+    }
+  }
+}
+
+static void takeSample(LCMBS_CONF_SAMPLE_T *sample, LCMBS_SAMPLE_RING_T *ring) {
+  uint64_t head = ring->head;
+  int trigger, arm;
+
+  // triggered captures stop once the post trigger part is
+  // full and wait for the arm pin before starting over
+  if (ring->mode == LCMBS_SAMPLE_TRIGGERED) {
+    trigger = **sample->trigger ? 1 : 0;
+    arm = **sample->arm ? 1 : 0;
+    if (arm && !ring->lastArm && ring->state == LCMBS_SAMPLE_STATE_COMPLETE) {
+      __atomic_store_n(&ring->state, LCMBS_SAMPLE_STATE_ARMED, __ATOMIC_RELEASE);
+    }
+    if (trigger && !ring->lastTrigger && ring->state == LCMBS_SAMPLE_STATE_ARMED) {
+      __atomic_store_n(&ring->triggerSeq, (uint32_t) head, __ATOMIC_RELAXED);
+      __atomic_store_n(&ring->state, LCMBS_SAMPLE_STATE_TRIGGERED, __ATOMIC_RELEASE);
+    }
+    ring->lastTrigger = trigger;
+    ring->lastArm = arm;
+    if (ring->state == LCMBS_SAMPLE_STATE_COMPLETE) {
+      return;
+    }
+  }
+
+  // frames below head are complete
+  writeFrame(sample, &ring->data[(head % ring->slots) * ring->frameRegs]);
+  __atomic_store_n(&ring->head, ++head, __ATOMIC_RELEASE);
+
+  if (ring->state == LCMBS_SAMPLE_STATE_TRIGGERED && (uint32_t) head - ring->triggerSeq >= ring->slots - sample->pretrigger) {
+    __atomic_store_n(&ring->state, LCMBS_SAMPLE_STATE_COMPLETE, __ATOMIC_RELEASE);
+  }
+}
+
+static LCMBS_CONF_SAMPLE_T *findSample(LCMBS_CONF_SLAVE_T *slave, const char *name) {
+  size_t i;
+
+  for (i = 0; i < slave->samples.count; i++) {
+    LCMBS_CONF_SAMPLE_T *sample = lcmbsVectGet(&slave->samples, i);
+    if (strcmp(sample->name, name) == 0) {
+      return sample;
+    }
+  }
+
+  return NULL;
+}
+
+static void *lcmbsSampleThread(void *arg) {
+  LCMBS_SAMPLE_DATA_T *data = (LCMBS_SAMPLE_DATA_T *) arg;
+  LCMBS_SAMPLE_RING_T *ring = data->ring;
+  LCMBS_CONF_SLAVE_T *slave, *last = NULL;
+  LCMBS_CONF_SAMPLE_T *sample = NULL;
+  uint64_t period = 1000000, next, now, missed;
+  struct timespec ts;
+  int idx;
+
+  next = lcmbsTimeNs();
+  while (!__atomic_load_n(&data->exit_flag, __ATOMIC_ACQUIRE)) {
+    idx = lcmbsRcuReadLock(data->slave);
+    slave = lcmbsRcuDeref(data->slave);
+
+    // captures removed by a reload pause until they come back
+    if (slave != last) {
+      sample = findSample(slave, data->name);
+      last = slave;
+    }
+    if (sample != NULL) {
+      period = (uint64_t) sample->period * 1000;
+      lcmbsRtxBegin(slave->exchange);
+      takeSample(sample, ring);
+      lcmbsRtxEnd(slave->exchange);
+    }
+
+    lcmbsRcuReadUnlock(data->slave, idx);
+
+    // sample on an absolute schedule, missed periods
+    // are skipped and counted instead of caught up
+    next += period;
+    now = lcmbsTimeNs();
+    if (now >= next + period) {
+      missed = (now - next) / period;
+      __atomic_add_fetch(&ring->late, (uint32_t) missed, __ATOMIC_RELAXED);
+      next += missed * period;
+    }
+    ts.tv_sec = next / 1000000000ULL;
+    ts.tv_nsec = next % 1000000000ULL;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+  }
+
+  return NULL;
+}
+
+static void readHeader(LCMBS_CONF_SAMPLE_T *sample, uint16_t *hdr) {
+  LCMBS_SAMPLE_RING_T *ring = sample->ring;
+  int state = __atomic_load_n(&ring->state, __ATOMIC_ACQUIRE);
+
+  memset(hdr, 0, LCMBS_SAMPLE_HDR_REGS * sizeof(uint16_t));
+  hdr[0] = state;
+  hdr[1] = sample->frameRegs;
+  putLong(&hdr[2], sample->slots);
+  putLong(&hdr[4], sample->period);
+  putLong(&hdr[6], (uint32_t) __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE));
+  putLong(&hdr[8], __atomic_load_n(&ring->triggerSeq, __ATOMIC_RELAXED));
+  putLong(&hdr[10], __atomic_load_n(&ring->late, __ATOMIC_RELAXED));
+  hdr[12] = sample->pretrigger;
+  hdr[13] = sample->pins.count;
+}
+
+int lcmbsSampleRead(LCMBS_CONF_SAMPLE_T *sample, int file, int record, int count, uint16_t *regs) {
+  LCMBS_SAMPLE_RING_T *ring = sample->ring;
+  uint16_t hdr[LCMBS_SAMPLE_HDR_REGS];
+  size_t pos;
+
+  // header file
+  if (file == sample->file) {
+    if (record + count > LCMBS_SAMPLE_HDR_REGS) {
+      return -1;
+    }
+    readHeader(sample, hdr);
+    memcpy(regs, &hdr[record], count * sizeof(uint16_t));
+    return 0;
+  }
+
+  // data files hold the ring in slot order, a
+  // request never spans two of them
+  if (record + count > LCMBS_SAMPLE_FILE_RECORDS) {
+    return -1;
+  }
+  pos = (size_t) (file - sample->file - 1) * LCMBS_SAMPLE_FILE_RECORDS + record;
+  if (pos + count > (size_t) ring->slots * ring->frameRegs) {
+    return -1;
+  }
+
+  // slots may be overwritten meanwhile, masters
+  // falling behind by a full ring see it in head
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  memcpy(regs, &ring->data[pos], count * sizeof(uint16_t));
+  return 0;
+}
+
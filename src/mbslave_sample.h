@@ -0,0 +1,48 @@
+#ifndef _LCMBS_SAMPLE_H
+#define _LCMBS_SAMPLE_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "mbslave_util.h"
+#include "mbslave_conf.h"
+
+// Sample capture of HAL pins, read as Modbus file records. Every capture
+// has its own sampler thread writing one frame of registers per period
+// into a preallocated ring. Requests read the ring without locks, the
+// header tells masters which samples are valid.
+
+#define LCMBS_SAMPLE_STATE_RUNNING   0
+#define LCMBS_SAMPLE_STATE_ARMED     1
+#define LCMBS_SAMPLE_STATE_TRIGGERED 2
+#define LCMBS_SAMPLE_STATE_COMPLETE  3
+
+typedef struct LCMBS_SAMPLE_RING {
+  int slots;
+  int frameRegs;
+  int mode;
+  int state;
+  int lastTrigger;
+  int lastArm;
+  uint32_t triggerSeq;
+  uint32_t late;
+  uint64_t head;
+  uint16_t data[];
+} LCMBS_SAMPLE_RING_T;
+
+typedef struct {
+  char name[HAL_NAME_LEN];
+  LCMBS_RCU_T *slave;
+  LCMBS_SAMPLE_RING_T *ring;
+  pthread_t thread;
+  int exit_flag;
+} LCMBS_SAMPLE_DATA_T;
+
+LCMBS_SAMPLE_DATA_T *lcmbsSampleStart(LCMBS_CONF_SAMPLE_T *conf, LCMBS_RCU_T *slave);
+void lcmbsSampleStop(LCMBS_SAMPLE_DATA_T *sample);
+int lcmbsSampleMatches(LCMBS_SAMPLE_DATA_T *sample, LCMBS_CONF_SAMPLE_T *conf);
+
+int lcmbsSampleRead(LCMBS_CONF_SAMPLE_T *sample, int file, int record, int count, uint16_t *regs);
+
+#endif
+
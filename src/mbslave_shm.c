@@ -0,0 +1,305 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/eventfd.h>
+
+#include "mbslave_shm.h"
+#include "mbslave_prot.h"
+#include "mbslave_rtx.h"
+
+#define SET_TIMEVAL_MS(tv, val) { tv.tv_sec = val / 1000; tv.tv_usec = (val % 1000) * 1000; }
+
+static void *lcmbsShmThread(void *arg);
+
+static int isImageReg(LCMBS_CONF_REG_T *reg) {
+  // change sequence registers would need a diff per read
+  return reg->pin != NULL || reg->bitpins != NULL;
+}
+
+static uint32_t fillTable(LCMBS_PTAB_T *map, int regs, LCMBS_SHMFMT_ENTRY_T *entries, void **refs) {
+  uint32_t count = 0;
+  int i, j;
+
+  // walk page table to get entries sorted by address
+  for (i = 0; i < LCMBS_PTAB_PAGE_COUNT; i++) {
+    void **page = map->pages[i];
+    if (page == NULL) {
+      continue;
+    }
+    for (j = 0; j < LCMBS_PTAB_PAGE_SIZE; j++) {
+      if (page[j] == NULL || (regs && !isImageReg(page[j]))) {
+        continue;
+      }
+      if (entries != NULL) {
+        entries[count].addr = (i << LCMBS_PTAB_PAGE_BITS) | j;
+        entries[count].val = 0;
+        refs[count] = page[j];
+      }
+      count++;
+    }
+  }
+
+  return count;
+}
+
+static LCMBS_PTAB_T *getTableMap(LCMBS_CONF_SLAVE_T *slave, int table) {
+  switch (table) {
+    case LCMBS_SHMFMT_HOLDING_REGS:
+      return &slave->holdingRegs.map;
+    case LCMBS_SHMFMT_INPUT_REGS:
+      return &slave->inputRegs.map;
+    case LCMBS_SHMFMT_INPUTS:
+      return &slave->inputs.map;
+    default:
+      return &slave->coils.map;
+  }
+}
+
+static void updateSegment(LCMBS_SHM_DATA_T *shm) {
+  LCMBS_SHMFMT_HDR_T *hdr = shm->hdr;
+  void **refs = shm->refs;
+  uint32_t seq, i, enc = 0;
+  int t;
+
+  // enter write side of seqlock
+  seq = hdr->seq;
+  __atomic_store_n(&hdr->seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  for (t = 0; t < LCMBS_SHMFMT_TABLES; t++) {
+    LCMBS_SHMFMT_ENTRY_T *entries = (LCMBS_SHMFMT_ENTRY_T *) ((uint8_t *) hdr + hdr->tables[t].offset);
+    uint32_t count = hdr->tables[t].count;
+
+    // bit tables
+    if (t >= LCMBS_SHMFMT_INPUTS) {
+      for (i = 0; i < count; i++) {
+        LCMBS_CONF_BIT_PIN_T *pin = *(refs++);
+        entries[i].val = **pin->pin ? 1 : 0;
+      }
+      continue;
+    }
+
+    // register tables, multi word pins are read at their first register
+    for (i = 0; i < count; i++) {
+      LCMBS_CONF_REG_T *reg = *(refs++);
+      if (reg->pin != NULL) {
+        if (reg->index == 0) {
+          enc = lcmbsProtEncodePin(reg->pin, lcmbsProtReadPin(reg->pin));
+        }
+        entries[i].val = ntohs(lcmbsProtPinWord(reg->pin, enc, reg->index));
+      } else {
+        entries[i].val = lcmbsProtReadBitpins(reg->bitpins);
+      }
+    }
+  }
+
+  hdr->timestamp = lcmbsTimeNs();
+  __atomic_store_n(&hdr->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static void releaseSegment(LCMBS_SHMFMT_HDR_T *hdr, size_t size) {
+  // tell readers to map the segment again
+  __atomic_store_n(&hdr->stale, 1, __ATOMIC_RELEASE);
+  munmap(hdr, size);
+}
+
+static int createSegment(LCMBS_SHM_DATA_T *shm, LCMBS_CONF_SLAVE_T *slave) {
+  LCMBS_SHMFMT_TABLE_T tables[LCMBS_SHMFMT_TABLES];
+  LCMBS_SHMFMT_HDR_T *hdr, *oldHdr;
+  void **refs, **r;
+  size_t size, oldSize, total = 0;
+  int fd, t;
+
+  // calculate layout
+  size = sizeof(LCMBS_SHMFMT_HDR_T);
+  for (t = 0; t < LCMBS_SHMFMT_TABLES; t++) {
+    tables[t].offset = size;
+    tables[t].count = fillTable(getTableMap(slave, t), t < LCMBS_SHMFMT_INPUTS, NULL, NULL);
+    size += tables[t].count * sizeof(LCMBS_SHMFMT_ENTRY_T);
+    total += tables[t].count;
+  }
+
+  refs = malloc((total + 1) * sizeof(void *));
+  if (!refs) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for shared memory image\n", compName);
+    goto fail0;
+  }
+
+  // replace an existing segment of the same name, readers
+  // still mapping it are notified by its stale flag
+  shm_unlink(shm->conf.name);
+  fd = shm_open(shm->conf.name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "%s: ERROR: unable to create shared memory %s (%s)\n", compName, shm->conf.name, strerror(errno));
+    goto fail1;
+  }
+
+  if (ftruncate(fd, size)) {
+    fprintf(stderr, "%s: ERROR: unable to size shared memory %s (%s)\n", compName, shm->conf.name, strerror(errno));
+    goto fail2;
+  }
+
+  hdr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (hdr == MAP_FAILED) {
+    fprintf(stderr, "%s: ERROR: unable to map shared memory %s (%s)\n", compName, shm->conf.name, strerror(errno));
+    goto fail2;
+  }
+  close(fd);
+
+  // fill header and addresses
+  hdr->version = LCMBS_SHMFMT_VERSION;
+  hdr->size = size;
+  hdr->period = shm->conf.period;
+  memcpy(hdr->tables, tables, sizeof(tables));
+  r = refs;
+  for (t = 0; t < LCMBS_SHMFMT_TABLES; t++) {
+    r += fillTable(getTableMap(slave, t), t < LCMBS_SHMFMT_INPUTS, (LCMBS_SHMFMT_ENTRY_T *) ((uint8_t *) hdr + tables[t].offset), r);
+  }
+
+  // publish initial values, readers check the magic last
+  oldHdr = shm->hdr;
+  oldSize = shm->size;
+  free(shm->refs);
+  shm->hdr = hdr;
+  shm->size = size;
+  shm->refs = refs;
+  lcmbsRtxBegin(slave->exchange);
+  updateSegment(shm);
+  lcmbsRtxEnd(slave->exchange);
+  __atomic_store_n(&hdr->magic, LCMBS_SHMFMT_MAGIC, __ATOMIC_RELEASE);
+
+  // readers of the old segment find the new one ready
+  if (oldHdr != NULL) {
+    releaseSegment(oldHdr, oldSize);
+  }
+
+  return 0;
+
+fail2:
+  close(fd);
+  shm_unlink(shm->conf.name);
+fail1:
+  free(refs);
+fail0:
+  return -1;
+}
+
+LCMBS_SHM_DATA_T *lcmbsShmStart(LCMBS_CONF_SHM_T *conf, LCMBS_RCU_T *slave) {
+  LCMBS_SHM_DATA_T *shm;
+
+  // alloc memory
+  shm = calloc(1, sizeof(LCMBS_SHM_DATA_T));
+  if (!shm) {
+    goto fail0;
+  }
+
+  // initialize fields, the config is copied as
+  // the slave tables may be replaced by a config reload
+  shm->conf = *conf;
+  shm->slave = slave;
+
+  // create exit flag event
+  if ((shm->exit_flag = eventfd(0, 0)) < 0) {
+    goto fail1;
+  }
+
+  // create initial segment
+  shm->layout = lcmbsRcuDeref(slave);
+  shm->layoutEpoch = __atomic_load_n(&slave->epoch, __ATOMIC_SEQ_CST);
+  if (createSegment(shm, shm->layout)) {
+    goto fail2;
+  }
+
+  // start update thread
+  if (pthread_create(&shm->thread, 0, lcmbsShmThread, shm)) {
+    goto fail3;
+  }
+
+  return shm;
+
+fail3:
+  releaseSegment(shm->hdr, shm->size);
+  shm_unlink(shm->conf.name);
+  free(shm->refs);
+fail2:
+  close(shm->exit_flag);
+fail1:
+  free(shm);
+fail0:
+  return NULL;
+}
+
+void lcmbsShmStop(LCMBS_SHM_DATA_T *shm) {
+  // set exit flag
+  uint64_t u = 1;
+  write(shm->exit_flag, &u, sizeof(uint64_t));
+
+  // wait for update thread
+  pthread_join(shm->thread, NULL);
+
+  // remove segment
+  if (shm->hdr != NULL) {
+    releaseSegment(shm->hdr, shm->size);
+    shm_unlink(shm->conf.name);
+  }
+
+  free(shm->refs);
+  close(shm->exit_flag);
+  free(shm);
+}
+
+static void *lcmbsShmThread(void *arg) {
+  LCMBS_SHM_DATA_T *shm = (LCMBS_SHM_DATA_T *) arg;
+  LCMBS_CONF_SLAVE_T *slave;
+  struct timeval timeout;
+  unsigned int epoch;
+  fd_set rfds;
+  int ret, idx;
+
+  while (1) {
+    // wait for exit or next period
+    FD_ZERO(&rfds);
+    FD_SET(shm->exit_flag, &rfds);
+    SET_TIMEVAL_MS(timeout, shm->conf.period);
+    ret = select(shm->exit_flag + 1, &rfds, NULL, NULL, &timeout);
+    if (ret < 0 && errno != EINTR) {
+      fprintf(stderr, "%s: ERROR: select failed on shared memory %s\n", compName, shm->conf.name);
+      break;
+    }
+    if (ret > 0) {
+      break;
+    }
+
+    idx = lcmbsRcuReadLock(shm->slave);
+    slave = lcmbsRcuDeref(shm->slave);
+
+    // rebuild layout after config reload
+    epoch = __atomic_load_n(&shm->slave->epoch, __ATOMIC_SEQ_CST);
+    if (slave != shm->layout || epoch != shm->layoutEpoch) {
+      shm->layout = slave;
+      shm->layoutEpoch = epoch;
+      if (createSegment(shm, slave)) {
+        // keep old segment stale, values are no longer updated
+        if (shm->hdr != NULL) {
+          releaseSegment(shm->hdr, shm->size);
+          shm->hdr = NULL;
+        }
+      }
+    } else if (shm->hdr != NULL) {
+      lcmbsRtxBegin(slave->exchange);
+      updateSegment(shm);
+      lcmbsRtxEnd(slave->exchange);
+    }
+
+    lcmbsRcuReadUnlock(shm->slave, idx);
+  }
+
+  return NULL;
+}
+
@@ -0,0 +1,25 @@
+#ifndef _LCMBS_SHM_H
+#define _LCMBS_SHM_H
+
+#include <pthread.h>
+
+#include "mbslave_conf.h"
+#include "mbslave_shmfmt.h"
+
+typedef struct {
+  LCMBS_CONF_SHM_T conf;
+  LCMBS_RCU_T *slave;
+  pthread_t thread;
+  int exit_flag;
+  LCMBS_CONF_SLAVE_T *layout;
+  unsigned int layoutEpoch;
+  LCMBS_SHMFMT_HDR_T *hdr;
+  size_t size;
+  void **refs;
+} LCMBS_SHM_DATA_T;
+
+LCMBS_SHM_DATA_T *lcmbsShmStart(LCMBS_CONF_SHM_T *conf, LCMBS_RCU_T *slave);
+void lcmbsShmStop(LCMBS_SHM_DATA_T *shm);
+
+#endif
+
@@ -0,0 +1,54 @@
+#ifndef _LCMBS_SHMFMT_H
+#define _LCMBS_SHMFMT_H
+
+#include <stdint.h>
+
+// Layout of the shared memory register image of a slave
+//
+// The segment starts with LCMBS_SHMFMT_HDR_T, followed by one entry array
+// per table. Each table descriptor gives the byte offset of its array from
+// the start of the segment and the number of entries. Entries are sorted by
+// address. Register values are the 16 bit words a Modbus read would return
+// (byte and word swapping applied), stored in host byte order. Bits are
+// stored as 0 or 1. Change sequence registers are not part of the image.
+//
+// All values and the timestamp are protected by the seqlock counter seq,
+// which is odd while an update is in progress. A reader copies the data it
+// needs and retries if seq was odd or changed meanwhile.
+//
+// When the layout changes on a config reload, a new segment is created
+// under the same name and stale is set in the old one. Readers then have
+// to map the segment again. stale is also set when mbslave terminates.
+
+#define LCMBS_SHMFMT_MAGIC   0x4d53424d
+#define LCMBS_SHMFMT_VERSION 1
+
+#define LCMBS_SHMFMT_HOLDING_REGS 0
+#define LCMBS_SHMFMT_INPUT_REGS   1
+#define LCMBS_SHMFMT_INPUTS       2
+#define LCMBS_SHMFMT_COILS        3
+#define LCMBS_SHMFMT_TABLES       4
+
+typedef struct {
+  uint32_t offset;
+  uint32_t count;
+} LCMBS_SHMFMT_TABLE_T;
+
+typedef struct {
+  uint16_t addr;
+  uint16_t val;
+} LCMBS_SHMFMT_ENTRY_T;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  uint32_t stale;
+  uint32_t seq;
+  uint32_t period;
+  uint64_t timestamp;
+  LCMBS_SHMFMT_TABLE_T tables[LCMBS_SHMFMT_TABLES];
+} LCMBS_SHMFMT_HDR_T;
+
+#endif
+
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mbslave_shmrd.h"
+
+static int mapSegment(LCMBS_SHMRD_T *rd) {
+  const LCMBS_SHMFMT_HDR_T *hdr;
+  struct stat st;
+  int fd, t, err;
+
+  fd = shm_open(rd->name, O_RDONLY, 0);
+  if (fd < 0) {
+    err = (errno == ENOENT) ? EAGAIN : errno;
+    goto fail0;
+  }
+
+  if (fstat(fd, &st)) {
+    err = errno;
+    goto fail1;
+  }
+  if (st.st_size < sizeof(LCMBS_SHMFMT_HDR_T)) {
+    err = EAGAIN;
+    goto fail1;
+  }
+
+  hdr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (hdr == MAP_FAILED) {
+    err = errno;
+    goto fail1;
+  }
+  close(fd);
+
+  // magic is written last by mbslave
+  if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != LCMBS_SHMFMT_MAGIC) {
+    err = EAGAIN;
+    goto fail2;
+  }
+  if (hdr->version != LCMBS_SHMFMT_VERSION || hdr->size != st.st_size) {
+    err = EPROTO;
+    goto fail2;
+  }
+  for (t = 0; t < LCMBS_SHMFMT_TABLES; t++) {
+    if (hdr->tables[t].offset > hdr->size || hdr->tables[t].count > (hdr->size - hdr->tables[t].offset) / sizeof(LCMBS_SHMFMT_ENTRY_T)) {
+      err = EPROTO;
+      goto fail2;
+    }
+  }
+
+  rd->hdr = hdr;
+  rd->size = st.st_size;
+  return 0;
+
+fail2:
+  munmap((void *) hdr, st.st_size);
+  goto fail0;
+fail1:
+  close(fd);
+fail0:
+  errno = err;
+  return -1;
+}
+
+static void unmapSegment(LCMBS_SHMRD_T *rd) {
+  if (rd->hdr != NULL) {
+    munmap((void *) rd->hdr, rd->size);
+    rd->hdr = NULL;
+  }
+}
+
+int lcmbsShmrdOpen(LCMBS_SHMRD_T *rd, const char *name) {
+  memset(rd, 0, sizeof(LCMBS_SHMRD_T));
+
+  if (strlen(name) >= sizeof(rd->name)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  strcpy(rd->name, name);
+
+  return mapSegment(rd);
+}
+
+void lcmbsShmrdClose(LCMBS_SHMRD_T *rd) {
+  unmapSegment(rd);
+}
+
+static int findEntry(const LCMBS_SHMFMT_ENTRY_T *entries, uint32_t count, uint16_t addr) {
+  uint32_t lo = 0, hi = count;
+
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) >> 1;
+    if (entries[mid].addr < addr) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return (lo < count && entries[lo].addr == addr) ? (int) lo : -1;
+}
+
+int lcmbsShmrdRead(LCMBS_SHMRD_T *rd, int table, uint16_t start, uint16_t count, uint16_t *vals, uint64_t *timestamp) {
+  const LCMBS_SHMFMT_HDR_T *hdr;
+  const LCMBS_SHMFMT_ENTRY_T *entries;
+  uint32_t s1, s2, n;
+  int i, pos;
+
+  if (table < 0 || table >= LCMBS_SHMFMT_TABLES || count == 0 || (start + count) > 65536) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  while (1) {
+    // map again if mbslave replaced the segment
+    hdr = rd->hdr;
+    if (hdr == NULL || __atomic_load_n(&hdr->stale, __ATOMIC_ACQUIRE)) {
+      unmapSegment(rd);
+      if (mapSegment(rd)) {
+        return -1;
+      }
+      continue;
+    }
+
+    // the layout of a segment never changes, entries are sorted
+    // by address and a contiguous range has contiguous entries
+    entries = (const LCMBS_SHMFMT_ENTRY_T *) ((const uint8_t *) hdr + hdr->tables[table].offset);
+    n = hdr->tables[table].count;
+    pos = findEntry(entries, n, start);
+    if (pos < 0 || pos + count > n || entries[pos + count - 1].addr != start + count - 1) {
+      errno = ENXIO;
+      return -1;
+    }
+
+    // copy values inside seqlock read section
+    s1 = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+    if (s1 & 1) {
+      continue;
+    }
+    for (i = 0; i < count; i++) {
+      vals[i] = entries[pos + i].val;
+    }
+    if (timestamp != NULL) {
+      *timestamp = hdr->timestamp;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    s2 = __atomic_load_n(&hdr->seq, __ATOMIC_RELAXED);
+    if (s1 == s2) {
+      return 0;
+    }
+  }
+}
+
@@ -0,0 +1,24 @@
+#ifndef _LCMBS_SHMRD_H
+#define _LCMBS_SHMRD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mbslave_shmfmt.h"
+
+// Reader for the shared memory register image of mbslave.
+// Reads take no locks and do no syscalls unless the segment
+// was replaced and has to be mapped again.
+
+typedef struct {
+  char name[256];
+  const LCMBS_SHMFMT_HDR_T *hdr;
+  size_t size;
+} LCMBS_SHMRD_T;
+
+int lcmbsShmrdOpen(LCMBS_SHMRD_T *rd, const char *name);
+void lcmbsShmrdClose(LCMBS_SHMRD_T *rd);
+int lcmbsShmrdRead(LCMBS_SHMRD_T *rd, int table, uint16_t start, uint16_t count, uint16_t *vals, uint64_t *timestamp);
+
+#endif
+
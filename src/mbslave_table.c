@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+#include "mbslave_table.h"
+#include "mbslave_rtx.h"
+
+typedef union {
+  uint32_t u;
+  int32_t s;
+  float f;
+} TABLE_VAL_T;
+
+static void readEntry(LCMBS_CONF_TABLE_T *table, int idx, uint16_t *regs) {
+  LCMBS_CONF_TABLE_PIN_T *pin = &table->pins[idx];
+  TABLE_VAL_T val;
+
+  // limit range like single register pins
+  switch (table->type) {
+    case LCMBS_PINTYPE_U16:
+      val.u = **pin->u;
+      regs[0] = (val.u > USHRT_MAX) ? USHRT_MAX : val.u;
+      return;
+    case LCMBS_PINTYPE_S16:
+      val.s = **pin->s;
+      if (val.s < SHRT_MIN) val.s = SHRT_MIN;
+      if (val.s > SHRT_MAX) val.s = SHRT_MAX;
+      regs[0] = (uint16_t) val.s;
+      return;
+    case LCMBS_PINTYPE_FLOAT:
+      val.f = **pin->f;
+      break;
+    default:
+      val.u = **pin->u;
+  }
+
+  // long values high word first
+  regs[0] = val.u >> 16;
+  regs[1] = val.u & 0xffff;
+}
+
+static void writeEntry(LCMBS_CONF_TABLE_T *table, int idx, const uint16_t *regs) {
+  LCMBS_CONF_TABLE_PIN_T *pin = &table->pins[idx];
+  TABLE_VAL_T val;
+
+  switch (table->type) {
+    case LCMBS_PINTYPE_U16:
+      lcmbsPinSetU32(pin->u, regs[0]);
+      return;
+    case LCMBS_PINTYPE_S16:
+      lcmbsPinSetS32(pin->s, (int16_t) regs[0]);
+      return;
+  }
+
+  val.u = ((uint32_t) regs[0] << 16) | regs[1];
+  switch (table->type) {
+    case LCMBS_PINTYPE_S32:
+      lcmbsPinSetS32(pin->s, val.s);
+      break;
+    case LCMBS_PINTYPE_FLOAT:
+      lcmbsPinSetFloat(pin->f, val.f);
+      break;
+    default:
+      lcmbsPinSetU32(pin->u, val.u);
+  }
+}
+
+int lcmbsTableRead(LCMBS_CONF_TABLE_T *table, int file, int record, int count, uint16_t *regs) {
+  uint16_t ctrl[LCMBS_TABLE_CTRL_REGS];
+  uint16_t entry[2];
+  int i, idx, off;
+
+  // control file of explicit commits
+  if (file != table->file) {
+    if (record + count > LCMBS_TABLE_CTRL_REGS) {
+      return -1;
+    }
+    ctrl[0] = __atomic_load_n(&table->staged, __ATOMIC_RELAXED);
+    ctrl[1] = **table->commits >> 16;
+    ctrl[2] = **table->commits & 0xffff;
+    memcpy(regs, &ctrl[record], count * sizeof(uint16_t));
+    return 0;
+  }
+
+  if (record + count > table->records) {
+    return -1;
+  }
+
+  // entries may be read partially
+  for (i = 0; i < count; i++) {
+    idx = (record + i) / table->regCount;
+    off = (record + i) % table->regCount;
+    if (i == 0 || off == 0) {
+      readEntry(table, idx, entry);
+    }
+    regs[i] = entry[off];
+  }
+
+  return 0;
+}
+
+void lcmbsTableStage(LCMBS_CONF_TABLE_T *table, int record, int count, const uint16_t *regs) {
+  int i;
+
+  // start from the committed values, so uploads
+  // may cover only a part of the table
+  if (!table->staged) {
+    for (i = 0; i < table->size; i++) {
+      readEntry(table, i, &table->staging[i * table->regCount]);
+    }
+    __atomic_store_n(&table->staged, 1, __ATOMIC_RELAXED);
+  }
+
+  memcpy(&table->staging[record], regs, count * sizeof(uint16_t));
+}
+
+void lcmbsTableCommit(LCMBS_CONF_TABLE_T *table) {
+  uint32_t seq;
+  int i;
+
+  if (!table->staged) {
+    return;
+  }
+
+  // the counter is odd while the pins are written, HAL components
+  // take the table only if it is even and unchanged after reading
+  seq = **table->commits | 1;
+  lcmbsPinSetU32(table->commits, seq);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  for (i = 0; i < table->size; i++) {
+    writeEntry(table, i, &table->staging[i * table->regCount]);
+  }
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  lcmbsPinSetU32(table->commits, seq + 1);
+
+  __atomic_store_n(&table->staged, 0, __ATOMIC_RELAXED);
+}
+
+void lcmbsTableDiscard(LCMBS_CONF_TABLE_T *table) {
+  __atomic_store_n(&table->staged, 0, __ATOMIC_RELAXED);
+}
+
@@ -0,0 +1,22 @@
+#ifndef _LCMBS_TABLE_H
+#define _LCMBS_TABLE_H
+
+#include <stdint.h>
+
+#include "mbslave_util.h"
+#include "mbslave_conf.h"
+
+// File tables behind FC21 writes. Writes land in a staging copy of the
+// table and reach the HAL pins only on commit, all entries at once and
+// then the commit counter. Staging and commit run under the tables lock
+// of the slave, reads return the committed values without locking.
+
+#define LCMBS_TABLE_CTRL_REGS 3
+
+int lcmbsTableRead(LCMBS_CONF_TABLE_T *table, int file, int record, int count, uint16_t *regs);
+void lcmbsTableStage(LCMBS_CONF_TABLE_T *table, int record, int count, const uint16_t *regs);
+void lcmbsTableCommit(LCMBS_CONF_TABLE_T *table);
+void lcmbsTableDiscard(LCMBS_CONF_TABLE_T *table);
+
+#endif
+
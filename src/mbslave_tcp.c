@@ -5,34 +5,57 @@
 #include <unistd.h>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
 #include <time.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/time.h>
 #include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
 
 #include "mbslave_tcp.h"
 #include "mbslave_util.h"
 #include "mbslave_prot.h"
+#include "mbslave_diag.h"
+#include "mbslave_rtu.h"
+#include "mbslave_trace.h"
+#include "mbslave_capture.h"
 
 #define LISTEN_MAXPENDING 10
 #define SELECT_TIMEOUT    500
 #define HEADER_LEN        6
 #define BLOCK_SIZE        4096
+#define PACKET_MAX        512
+#define RATE_DELAY_MAX    (SELECT_TIMEOUT * 1000000ULL)
+#define PRIO_WAIT_MAX     5
+#define PRIO_LOW_BURST    4
+#define PRIO_LOW_NICE     10
+#define PRIO_HIGH_NICE    -5
 
 #define SET_TIMEVAL_MS(tv, val) { tv.tv_sec = val / 1000; tv.tv_usec = (val % 1000) * 1000; }
 
 
 typedef struct {
   LCMBS_TCP_SERVER_DATA_T *server;
+  uint16_t id;
   int sd;
   char addr[INET_ADDRSTRLEN];
   int port;
-
+  SSL *ssl;
+  int flags;
+  LCMBS_RATE_T rate;
+  int priority;
+  int burst;
+  LCMBS_TRACE_RING_T *trace;
 } LCMBS_TCP_CLIENT_DATA_T;
 
 
@@ -40,31 +63,74 @@ void *lcmbsTcpServerThread(void *arg);
 int lcmbsTcpNewConnection(LCMBS_TCP_SERVER_DATA_T *server);
 void *lcmbsTcpClientThread(void *arg);
 
+// connection ids shown in traces and captures
+static uint16_t nextClientId;
+
 
-LCMBS_TCP_SERVER_DATA_T *lcmbsTcpStart(LCMBS_CONF_TCP_LSNR_T *listener) {
+void lcmbsTcpPrioInit(LCMBS_TCP_PRIO_T *prio) {
+  memset(prio, 0, sizeof(LCMBS_TCP_PRIO_T));
+  pthread_mutex_init(&prio->lock, NULL);
+  pthread_cond_init(&prio->idle, NULL);
+}
+
+void lcmbsTcpPrioFree(LCMBS_TCP_PRIO_T *prio) {
+  pthread_cond_destroy(&prio->idle);
+  pthread_mutex_destroy(&prio->lock);
+}
+
+static LCMBS_TCP_SERVER_DATA_T *lcmbsTcpAllocServer(LCMBS_RCU_T *slave, LCMBS_TCP_PRIO_T *prio) {
   LCMBS_TCP_SERVER_DATA_T *server;
-  int optval;
-  struct sockaddr_in addr;
 
   // alloc memory
   server = calloc(1, sizeof(LCMBS_TCP_SERVER_DATA_T));
   if (!server) {
-    goto fail0;
+    return NULL;
   }
 
   // initialize fields
-  server->listener = listener;
+  server->slave = slave;
+  server->prio = prio;
   server->client_count_lock = (pthread_mutex_t) PTHREAD_MUTEX_INITIALIZER;
   server->client_count_zero = (pthread_cond_t) PTHREAD_COND_INITIALIZER; 
 
   // create exit flag event
   if ((server->exit_flag = eventfd(0, 0)) < 0) {
-    goto fail1;
+    free(server);
+    return NULL;
   }
 
+  return server;
+}
+
+static void lcmbsTcpFreeServer(LCMBS_TCP_SERVER_DATA_T *server) {
+  if (server->sslCtx != NULL) {
+    SSL_CTX_free(server->sslCtx);
+  }
+  close(server->exit_flag);
+  free(server);
+}
+
+static int lcmbsTcpRunServer(LCMBS_TCP_SERVER_DATA_T *server) {
+  // listen on socket
+  if (listen(server->sd, LISTEN_MAXPENDING)) {
+    return -1;
+  }
+
+  // start server thread
+  if (pthread_create(&server->thread, 0, lcmbsTcpServerThread, server)) {
+    return -1;
+  }
+
+  return 0;
+}
+
+static int lcmbsTcpBindInet(LCMBS_TCP_SERVER_DATA_T *server, int port) {
+  int optval;
+  struct sockaddr_in addr;
+
   // create socket
   if((server->sd = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP)) < 0) {
-    goto fail2;
+    return -1;
   }
 
   // set option SO_REUSEADDR to avoid "wait for FIN" hangs on restart
@@ -74,30 +140,133 @@ LCMBS_TCP_SERVER_DATA_T *lcmbsTcpStart(LCMBS_CONF_TCP_LSNR_T *listener) {
   // bind to tcp port
   memset(&addr, 0, sizeof(addr));
   addr.sin_family = AF_INET;
-  addr.sin_port = htons(listener->port);
+  addr.sin_port = htons(port);
   addr.sin_addr.s_addr = htonl(INADDR_ANY);
   if (bind(server->sd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
-    goto fail3;
+    close(server->sd);
+    return -1;
   }
 
-  // listen on port
-  if (listen(server->sd, LISTEN_MAXPENDING)) {
+  return 0;
+}
+
+LCMBS_TCP_SERVER_DATA_T *lcmbsTcpStart(LCMBS_CONF_TCP_LSNR_T *listener, LCMBS_RCU_T *slave, LCMBS_TCP_PRIO_T *prio) {
+  LCMBS_TCP_SERVER_DATA_T *server;
+
+  // alloc memory
+  server = lcmbsTcpAllocServer(slave, prio);
+  if (!server) {
+    goto fail0;
+  }
+
+  // the listener config is copied as the slave
+  // tables may be replaced by a config reload
+  server->listener = *listener;
+  server->family = AF_INET;
+  lcmbsRateInit(&server->rate, listener->listenerRate, listener->listenerBurst);
+
+  // create socket and bind to tcp port
+  if (lcmbsTcpBindInet(server, listener->port)) {
+    goto fail1;
+  }
+
+  // listen and start server thread
+  if (lcmbsTcpRunServer(server)) {
+    goto fail2;
+  }
+
+  return server;
+
+fail2:
+  close(server->sd);
+fail1:
+  lcmbsTcpFreeServer(server);
+fail0:
+  return NULL;
+}
+
+LCMBS_TCP_SERVER_DATA_T *lcmbsTlsStart(LCMBS_CONF_TLS_LSNR_T *listener, LCMBS_RCU_T *slave, LCMBS_TCP_PRIO_T *prio) {
+  LCMBS_TCP_SERVER_DATA_T *server;
+
+  // alloc memory
+  server = lcmbsTcpAllocServer(slave, prio);
+  if (!server) {
+    goto fail0;
+  }
+  server->tlsListener = *listener;
+  server->family = AF_INET;
+
+  // load certificates, the context is shared by all
+  // connections to keep the session cache
+  server->sslCtx = lcmbsTlsCreateCtx(listener);
+  if (!server->sslCtx) {
+    goto fail1;
+  }
+
+  // create socket and bind to tcp port
+  if (lcmbsTcpBindInet(server, listener->port)) {
+    goto fail1;
+  }
+
+  // listen and start server thread
+  if (lcmbsTcpRunServer(server)) {
+    goto fail2;
+  }
+
+  return server;
+
+fail2:
+  close(server->sd);
+fail1:
+  lcmbsTcpFreeServer(server);
+fail0:
+  return NULL;
+}
+
+LCMBS_TCP_SERVER_DATA_T *lcmbsUnixStart(LCMBS_CONF_UNIX_LSNR_T *listener, LCMBS_RCU_T *slave, LCMBS_TCP_PRIO_T *prio) {
+  LCMBS_TCP_SERVER_DATA_T *server;
+  struct sockaddr_un addr;
+
+  // alloc memory
+  server = lcmbsTcpAllocServer(slave, prio);
+  if (!server) {
+    goto fail0;
+  }
+  server->unixListener = *listener;
+  server->family = AF_UNIX;
+
+  // create socket, packet sockets keep ADU boundaries
+  if((server->sd = socket(AF_UNIX, listener->seqpacket ? SOCK_SEQPACKET : SOCK_STREAM, 0)) < 0) {
+    goto fail1;
+  }
+
+  // remove stale socket file and bind
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, listener->path);
+  unlink(listener->path);
+  if (bind(server->sd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+    goto fail2;
+  }
+
+  // set access rights
+  if (listener->mode >= 0 && chmod(listener->path, listener->mode) < 0) {
     goto fail3;
   }
 
-  // start server thread
-  if (pthread_create(&server->thread, 0, lcmbsTcpServerThread, server)) {
+  // listen and start server thread
+  if (lcmbsTcpRunServer(server)) {
     goto fail3;
   }
 
   return server;
 
 fail3:
-  close(server->sd);
+  unlink(listener->path);
 fail2:
-  close(server->exit_flag);
+  close(server->sd);
 fail1:
-  free(server);
+  lcmbsTcpFreeServer(server);
 fail0:
   return NULL;
 }
@@ -119,6 +288,11 @@ void lcmbsTcpStop(LCMBS_TCP_SERVER_DATA_T *server) {
 
   // close server socket
   close(server->sd);
+  if (server->family == AF_UNIX) {
+    unlink(server->unixListener.path);
+  }
+
+  lcmbsTcpFreeServer(server);
 }
 
 void *lcmbsTcpServerThread(void *arg) {
@@ -157,7 +331,7 @@ void *lcmbsTcpServerThread(void *arg) {
 }
 
 int lcmbsTcpNewConnection(LCMBS_TCP_SERVER_DATA_T *server) {
-  struct sockaddr_in client_addr;
+  struct sockaddr_storage client_addr;
   socklen_t client_addr_len;
   int client_sd;
   pthread_t client_thread;
@@ -175,9 +349,20 @@ int lcmbsTcpNewConnection(LCMBS_TCP_SERVER_DATA_T *server) {
     goto fail1;
   }
   client->server = server;
+  client->id = __atomic_fetch_add(&nextClientId, 1, __ATOMIC_RELAXED);
   client->sd = client_sd;
-  strncpy(client->addr, inet_ntoa(client_addr.sin_addr), INET_ADDRSTRLEN);
-  client->port = client_addr.sin_port;
+  lcmbsRateInit(&client->rate, server->listener.clientRate, server->listener.clientBurst);
+  if (client_addr.ss_family == AF_INET) {
+    struct sockaddr_in *in = (struct sockaddr_in *) &client_addr;
+    strncpy(client->addr, inet_ntoa(in->sin_addr), INET_ADDRSTRLEN);
+    client->port = in->sin_port;
+    client->priority = server->listener.priority;
+    if (lcmbsStrListed(server->listener.highPriorityClients, client->addr)) {
+      client->priority = LCMBS_PRIO_HIGH;
+    }
+  } else {
+    strcpy(client->addr, "local");
+  }
 
   // start client thread
   if (pthread_create(&client_thread, 0, lcmbsTcpClientThread, client)) {
@@ -201,25 +386,440 @@ fail0:
   return -1;
 }
 
+static int lcmbsTcpAdmit(LCMBS_TCP_CLIENT_DATA_T *client) {
+  LCMBS_TCP_SERVER_DATA_T *server = client->server;
+  uint64_t now, wait, deadline;
+  struct timespec ts;
+
+  now = lcmbsTimeNs();
+  deadline = now + RATE_DELAY_MAX;
+  while (1) {
+    // a request needs a token from the connection and the listener
+    // bucket, the connection token is returned if the listener is full
+    wait = lcmbsRateTake(&client->rate, now);
+    if (wait == 0) {
+      wait = lcmbsRateTake(&server->rate, now);
+      if (wait == 0) {
+        return 1;
+      }
+      lcmbsRateGiveBack(&client->rate);
+    }
+
+    // shed load unless the request may be delayed until the next token
+    if (!server->listener.overloadDelay || now + wait > deadline) {
+      return 0;
+    }
+    ts.tv_sec = wait / 1000000000ULL;
+    ts.tv_nsec = wait % 1000000000ULL;
+    nanosleep(&ts, NULL);
+    now = lcmbsTimeNs();
+  }
+}
+
+static void lcmbsTcpPrioEnter(LCMBS_TCP_PRIO_T *prio) {
+  __atomic_add_fetch(&prio->active, 1, __ATOMIC_SEQ_CST);
+}
+
+static void lcmbsTcpPrioLeave(LCMBS_TCP_PRIO_T *prio) {
+  // wake up lower classes when the last high priority request is done
+  if (__atomic_sub_fetch(&prio->active, 1, __ATOMIC_SEQ_CST) == 0 && __atomic_load_n(&prio->waiters, __ATOMIC_SEQ_CST) > 0) {
+    pthread_mutex_lock(&prio->lock);
+    pthread_cond_broadcast(&prio->idle);
+    pthread_mutex_unlock(&prio->lock);
+  }
+}
+
+static void lcmbsTcpPrioWait(LCMBS_TCP_CLIENT_DATA_T *client) {
+  LCMBS_TCP_PRIO_T *prio = client->server->prio;
+  struct timespec deadline;
+
+  // low priority clients give up the cpu after a few pipelined requests
+  if (client->priority == LCMBS_PRIO_LOW && ++client->burst >= PRIO_LOW_BURST) {
+    client->burst = 0;
+    sched_yield();
+  }
+
+  // hold back while high priority requests are processed, the
+  // wait is bounded so lower classes can not starve completely
+  if (__atomic_load_n(&prio->active, __ATOMIC_SEQ_CST) == 0) {
+    return;
+  }
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_nsec += PRIO_WAIT_MAX * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+  pthread_mutex_lock(&prio->lock);
+  __atomic_add_fetch(&prio->waiters, 1, __ATOMIC_SEQ_CST);
+  while (__atomic_load_n(&prio->active, __ATOMIC_SEQ_CST) > 0) {
+    if (pthread_cond_timedwait(&prio->idle, &prio->lock, &deadline)) {
+      break;
+    }
+  }
+  __atomic_sub_fetch(&prio->waiters, 1, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&prio->lock);
+}
+
+static void lcmbsTcpDiag(LCMBS_TCP_SERVER_DATA_T *server, void (*count)(LCMBS_DIAG_T *diag)) {
+  LCMBS_CONF_SLAVE_T *slave;
+  int rcuIdx;
+
+  // counters of the runtime slave, any published config points to them
+  rcuIdx = lcmbsRcuReadLock(server->slave);
+  slave = lcmbsRcuDeref(server->slave);
+  count(slave->diag);
+  lcmbsRcuReadUnlock(server->slave, rcuIdx);
+}
+
+static uint16_t lcmbsTcpExec(LCMBS_TCP_CLIENT_DATA_T *client, LCMBS_VECT_T *rcvbuf, LCMBS_VECT_T *sndbuf) {
+  LCMBS_TCP_SERVER_DATA_T *server = client->server;
+  LCMBS_CONF_SLAVE_T *slave;
+  int rcuIdx;
+  uint16_t len;
+
+  // answer with slave device busy when over the rate limits
+  if (!lcmbsTcpAdmit(client)) {
+    lcmbsTcpDiag(server, lcmbsDiagBusy);
+    return lcmbsProtException(rcvbuf, sndbuf, MB_ERR_SLAVE_DEVICE_BUSY);
+  }
+
+  // high priority requests preempt the other classes
+  if (client->priority == LCMBS_PRIO_HIGH) {
+    lcmbsTcpPrioEnter(server->prio);
+  } else {
+    lcmbsTcpPrioWait(client);
+  }
+
+  // process data on the currently published slave tables
+  rcuIdx = lcmbsRcuReadLock(server->slave);
+  slave = lcmbsRcuDeref(server->slave);
+  len = lcmbsProtProc(slave, rcvbuf, sndbuf, client->flags);
+  lcmbsRcuReadUnlock(server->slave, rcuIdx);
+
+  if (client->priority == LCMBS_PRIO_HIGH) {
+    lcmbsTcpPrioLeave(server->prio);
+  }
+
+  return len;
+}
+
+static void lcmbsTcpTrace(LCMBS_TCP_CLIENT_DATA_T *client, const uint8_t *req, size_t reqLen, LCMBS_VECT_T *sndbuf, uint16_t len, uint64_t start) {
+  const uint8_t *rsp = sndbuf->data;
+  LCMBS_TRACEFMT_EVENT_T ev;
+  uint64_t service = lcmbsTimeNs() - start;
+
+  // saturate, a wrapped service time would hide the slowest requests
+  memset(&ev, 0, sizeof(ev));
+  ev.ts = start;
+  ev.service = (service > UINT32_MAX) ? UINT32_MAX : service;
+  ev.client = client->id;
+  if (reqLen >= 2) {
+    ev.unit = req[0];
+    ev.fnk = req[1];
+  }
+  if (reqLen >= 6) {
+    ev.start = (req[2] << 8) | req[3];
+    ev.count = (req[4] << 8) | req[5];
+  }
+  if (len >= 3 && (rsp[1] & 0x80)) {
+    ev.exception = rsp[2];
+  }
+
+  lcmbsTraceRecord(client->trace, &ev);
+  lcmbsTraceCheck(ev.service);
+}
+
+static uint16_t lcmbsTcpProc(LCMBS_TCP_CLIENT_DATA_T *client, LCMBS_VECT_T *rcvbuf, LCMBS_VECT_T *sndbuf) {
+  const uint8_t *req = (const uint8_t *) rcvbuf->data + rcvbuf->pos;
+  size_t reqLen = rcvbuf->count - rcvbuf->pos;
+  uint64_t start;
+  uint16_t len;
+
+  start = lcmbsTimeNs();
+  len = lcmbsTcpExec(client, rcvbuf, sndbuf);
+  if (client->trace != NULL) {
+    lcmbsTcpTrace(client, req, reqLen, sndbuf, len, start);
+  }
+  lcmbsCaptureWrite(client->id, start, req, reqLen, sndbuf->data, len);
+
+  return len;
+}
+
+static int lcmbsTcpProcRequest(LCMBS_TCP_CLIENT_DATA_T *client, uint16_t tid, LCMBS_VECT_T *rcvbuf, LCMBS_VECT_T *sndbuf) {
+  uint8_t header[HEADER_LEN];
+  struct iovec iov[2];
+  struct msghdr msg;
+  uint16_t len;
+
+  len = lcmbsTcpProc(client, rcvbuf, sndbuf);
+  if (len == 0) {
+    return 0;
+  }
+
+  // send header and payload with a single call,
+  // on packet sockets this is one ADU per packet
+  *((uint16_t *) &header[0]) = htons(tid);
+  *((uint16_t *) &header[2]) = 0;
+  *((uint16_t *) &header[4]) = htons(len);
+  iov[0].iov_base = header;
+  iov[0].iov_len = HEADER_LEN;
+  iov[1].iov_base = sndbuf->data;
+  iov[1].iov_len = sndbuf->count;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+  if (sendmsg(client->sd, &msg, MSG_NOSIGNAL) != HEADER_LEN + len) {
+    return -1;
+  }
+
+  return 0;
+}
+
+static int lcmbsTcpRecvPacket(LCMBS_TCP_CLIENT_DATA_T *client, LCMBS_VECT_T *rcvbuf, LCMBS_VECT_T *sndbuf) {
+  uint8_t packet[PACKET_MAX];
+  uint16_t tid, prot, len;
+  ssize_t rcvd;
+
+  // receive one ADU, oversized packets are dropped
+  if ((rcvd = recv(client->sd, packet, PACKET_MAX, MSG_TRUNC)) <= 0) {
+    return -1;
+  }
+  if (rcvd > PACKET_MAX) {
+    lcmbsTcpDiag(client->server, lcmbsDiagOverrun);
+    return 0;
+  }
+  if (rcvd < HEADER_LEN) {
+    lcmbsTcpDiag(client->server, lcmbsDiagCommError);
+    return 0;
+  }
+
+  // read header data
+  tid = ntohs(*((uint16_t *) &packet[0]));
+  prot = ntohs(*((uint16_t *) &packet[2]));
+  len = ntohs(*((uint16_t *) &packet[4]));
+
+  // check protocol number and length
+  if (prot != 0 || len != rcvd - HEADER_LEN) {
+    lcmbsTcpDiag(client->server, lcmbsDiagCommError);
+    return 0;
+  }
+
+  lcmbsVectClear(rcvbuf);
+  if (!lcmbsVectPutData(rcvbuf, &packet[HEADER_LEN], len)) {
+    return -1;
+  }
+
+  return lcmbsTcpProcRequest(client, tid, rcvbuf, sndbuf);
+}
+
+static int lcmbsTcpRecvRtu(LCMBS_TCP_CLIENT_DATA_T *client, LCMBS_VECT_T *stream, LCMBS_VECT_T *rcvbuf, LCMBS_VECT_T *sndbuf, LCMBS_VECT_T *txbuf) {
+  uint8_t *data;
+  size_t pos;
+  ssize_t rcvd;
+  uint16_t crc, len;
+  int flen;
+
+  // append received data to stream buffer
+  if (!lcmbsVectEnsureSize(stream, stream->count + BLOCK_SIZE)) {
+    return -1;
+  }
+  if ((rcvd = read(client->sd, stream->data + stream->count, BLOCK_SIZE)) <= 0) {
+    return -1;
+  }
+  stream->count += rcvd;
+
+  // process all complete frames, pipelined
+  // responses are collected for a single send
+  data = stream->data;
+  lcmbsVectClear(txbuf);
+  for (pos = 0; pos < stream->count; pos += flen) {
+    flen = lcmbsRtuRequestLen(data + pos, stream->count - pos);
+    if (flen == 0) {
+      break;
+    }
+
+    // unknown function or CRC error, the frame boundary is
+    // lost so drop everything received so far, the next
+    // read is taken as the start of a new frame
+    if (flen < 0 || lcmbsRtuCrc16(data + pos, flen) != 0) {
+      lcmbsTcpDiag(client->server, lcmbsDiagCommError);
+      pos = stream->count;
+      break;
+    }
+
+    // address and PDU match the unit id and PDU of MBAP
+    lcmbsVectClear(rcvbuf);
+    if (!lcmbsVectPutData(rcvbuf, data + pos, flen - 2)) {
+      return -1;
+    }
+    len = lcmbsTcpProc(client, rcvbuf, sndbuf);
+
+    // broadcast requests are executed without response
+    if (data[pos] == 0) {
+      lcmbsTcpDiag(client->server, lcmbsDiagNoResponse);
+      continue;
+    }
+    if (len == 0) {
+      continue;
+    }
+
+    // append response with CRC, low byte first
+    crc = lcmbsRtuCrc16(sndbuf->data, len);
+    if (!lcmbsVectPutData(txbuf, sndbuf->data, len) || !lcmbsVectPutByte(txbuf, crc & 0xff) || !lcmbsVectPutByte(txbuf, crc >> 8)) {
+      return -1;
+    }
+  }
+
+  // keep incomplete frame
+  memmove(data, data + pos, stream->count - pos);
+  stream->count -= pos;
+
+  if (txbuf->count > 0 && send(client->sd, txbuf->data, txbuf->count, MSG_NOSIGNAL) != txbuf->count) {
+    return -1;
+  }
+
+  return 0;
+}
+
+static int lcmbsTcpTlsWrite(LCMBS_TCP_CLIENT_DATA_T *client, LCMBS_VECT_T *txbuf) {
+  LCMBS_TCP_SERVER_DATA_T *server = client->server;
+  fd_set rset, wset;
+  int max_fd;
+  struct timeval timeout;
+  int ret;
+
+  while ((ret = SSL_write(client->ssl, txbuf->data, txbuf->count)) <= 0) {
+    // socket buffer full, retry the same write when it drained
+    if (SSL_get_error(client->ssl, ret) != SSL_ERROR_WANT_WRITE) {
+      return -1;
+    }
+
+    // drop a client that does not read its responses
+    // and don't hold up shutdown while waiting for it
+    FD_ZERO(&rset);
+    FD_ZERO(&wset);
+    max_fd = -1;
+    FD_SET(server->exit_flag, &rset);
+    if (max_fd < server->exit_flag) max_fd = server->exit_flag;
+    FD_SET(client->sd, &wset);
+    if (max_fd < client->sd) max_fd = client->sd;
+    SET_TIMEVAL_MS(timeout, SELECT_TIMEOUT);
+    if (select(max_fd + 1, &rset, &wset, 0, &timeout) <= 0 || FD_ISSET(server->exit_flag, &rset)) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+static int lcmbsTcpRecvTls(LCMBS_TCP_CLIENT_DATA_T *client, LCMBS_VECT_T *stream, LCMBS_VECT_T *rcvbuf, LCMBS_VECT_T *sndbuf, LCMBS_VECT_T *txbuf) {
+  uint8_t *data;
+  size_t pos;
+  uint16_t prot, len, rlen;
+  int ret;
+
+  // read everything decrypted so far, an incomplete
+  // record is finished on the next readable event
+  do {
+    if (!lcmbsVectEnsureSize(stream, stream->count + BLOCK_SIZE)) {
+      return -1;
+    }
+    ret = SSL_read(client->ssl, stream->data + stream->count, BLOCK_SIZE);
+    if (ret <= 0) {
+      if (SSL_get_error(client->ssl, ret) == SSL_ERROR_WANT_READ) {
+        break;
+      }
+      return -1;
+    }
+    stream->count += ret;
+  } while (SSL_pending(client->ssl) > 0);
+
+  // process all complete ADUs, responses are
+  // collected to be encrypted as a single record
+  data = stream->data;
+  lcmbsVectClear(txbuf);
+  for (pos = 0; stream->count - pos >= HEADER_LEN; pos += HEADER_LEN + len) {
+    prot = ntohs(*((uint16_t *) &data[pos + 2]));
+    len = ntohs(*((uint16_t *) &data[pos + 4]));
+    if (stream->count - pos < HEADER_LEN + len) {
+      break;
+    }
+    if (prot != 0) {
+      continue;
+    }
+
+    lcmbsVectClear(rcvbuf);
+    if (!lcmbsVectPutData(rcvbuf, &data[pos + HEADER_LEN], len)) {
+      return -1;
+    }
+    rlen = lcmbsTcpProc(client, rcvbuf, sndbuf);
+    if (rlen == 0) {
+      continue;
+    }
+
+    // response header echoes the transaction id
+    if (!lcmbsVectPutData(txbuf, &data[pos], 2) || !lcmbsVectPutWord(txbuf, 0) ||
+      !lcmbsVectPutWord(txbuf, htons(rlen)) || !lcmbsVectPutData(txbuf, sndbuf->data, rlen)) {
+      return -1;
+    }
+  }
+
+  // keep incomplete ADU
+  memmove(data, data + pos, stream->count - pos);
+  stream->count -= pos;
+
+  if (txbuf->count > 0 && lcmbsTcpTlsWrite(client, txbuf)) {
+    return -1;
+  }
+
+  return 0;
+}
+
 void *lcmbsTcpClientThread(void *arg) {
   LCMBS_TCP_CLIENT_DATA_T *client = (LCMBS_TCP_CLIENT_DATA_T *) arg;
   LCMBS_TCP_SERVER_DATA_T *server = client->server;
-  LCMBS_CONF_TCP_LSNR_T *listener = server->listener;
-  LCMBS_CONF_SLAVE_T *slave = listener->slave;
+  int seqpacket = server->family == AF_UNIX && server->unixListener.seqpacket;
+  int rtu = server->family == AF_INET && server->listener.rtu;
+  int tls = server->sslCtx != NULL;
 
   fd_set set;
   int max_fd, count;
   struct timeval timeout;
   uint8_t header[HEADER_LEN];
   ssize_t header_pos;
-  uint16_t tid, prot, len;
-  LCMBS_VECT_T rcvbuf, sndbuf;
+  uint16_t tid = 0, prot, len = 0;
+  LCMBS_VECT_T rcvbuf, sndbuf, stream, txbuf;
   ssize_t rcvd;
 
   // loop to receive data
   header_pos = 0;
   lcmbsVectInit(&rcvbuf, 1);
   lcmbsVectInit(&sndbuf, 1);
+  lcmbsVectInit(&stream, 1);
+  lcmbsVectInit(&txbuf, 1);
+
+  // request trace of this connection, runs untraced if out of memory
+  client->trace = lcmbsTraceAcquire(client->id, client->addr, ntohs(client->port));
+
+  // map priority class to the thread's nice value, raising
+  // it needs CAP_SYS_NICE, so warn once per listener
+  if (client->priority != LCMBS_PRIO_NORMAL) {
+    int nice = (client->priority == LCMBS_PRIO_LOW) ? PRIO_LOW_NICE : PRIO_HIGH_NICE;
+    if (setpriority(PRIO_PROCESS, syscall(SYS_gettid), nice) < 0 && !__atomic_exchange_n(&server->prioWarned, 1, __ATOMIC_RELAXED)) {
+      fprintf(stderr, "%s: WARNING: Unable to set nice value %d for client %s (%s).\n", compName, nice, client->addr, strerror(errno));
+    }
+  }
+
+  // TLS handshake and role mapping, the connection is
+  // non blocking afterwards to read whole records only
+  if (tls) {
+    client->ssl = lcmbsTlsAccept(server->sslCtx, &server->tlsListener, client->sd, client->addr, &client->flags);
+    if (!client->ssl || fcntl(client->sd, F_SETFL, O_NONBLOCK) < 0) {
+      goto close;
+    }
+  }
+
   while (1) {
     // check for new data
     FD_ZERO(&set);
@@ -237,6 +837,7 @@ void *lcmbsTcpClientThread(void *arg) {
     if (count == 0) {
       header_pos = 0;
       lcmbsVectClear(&rcvbuf);
+      lcmbsVectClear(&stream);
       continue;
     }
 
@@ -250,6 +851,30 @@ void *lcmbsTcpClientThread(void *arg) {
       continue;
     }
 
+    // packet sockets need no reassembly
+    if (seqpacket) {
+      if (lcmbsTcpRecvPacket(client, &rcvbuf, &sndbuf)) {
+        break;
+      }
+      continue;
+    }
+
+    // decrypt and process
+    if (tls) {
+      if (lcmbsTcpRecvTls(client, &stream, &rcvbuf, &sndbuf, &txbuf)) {
+        break;
+      }
+      continue;
+    }
+
+    // RTU frames are delimited by function code and CRC
+    if (rtu) {
+      if (lcmbsTcpRecvRtu(client, &stream, &rcvbuf, &sndbuf, &txbuf)) {
+        break;
+      }
+      continue;
+    }
+
     // receive header
     if (header_pos < HEADER_LEN) {
       if ((rcvd = read(client->sd, &header[header_pos], HEADER_LEN - header_pos)) <= 0) {
@@ -269,6 +894,7 @@ void *lcmbsTcpClientThread(void *arg) {
 
       // check protocol number
       if (prot != 0) {
+        lcmbsTcpDiag(server, lcmbsDiagCommError);
         header_pos = 0;
         continue;
       }
@@ -294,23 +920,9 @@ void *lcmbsTcpClientThread(void *arg) {
       continue;
     }
 
-    // process data
-    len = lcmbsProtProc(slave, &rcvbuf, &sndbuf);
-
-    // send response
-    if (len > 0) {
-      // send header
-      *((uint16_t *) &header[0]) = htons(tid);
-      *((uint16_t *) &header[2]) = 0;
-      *((uint16_t *) &header[4]) = htons(len);
-      if (send(client->sd, header, HEADER_LEN, MSG_MORE) != HEADER_LEN) {
-        break;
-      }
-
-      // send payload
-      if (send(client->sd, sndbuf.data, sndbuf.count, 0) != len) {
-        break;
-      }
+    // process request and send response
+    if (lcmbsTcpProcRequest(client, tid, &rcvbuf, &sndbuf)) {
+      break;
     }
 
     // reset receive buffers
@@ -318,12 +930,24 @@ void *lcmbsTcpClientThread(void *arg) {
     lcmbsVectClear(&rcvbuf);
   }
 
+close:
   // close client socket
+  if (client->ssl != NULL) {
+    SSL_shutdown(client->ssl);
+    SSL_free(client->ssl);
+  }
   close(client->sd);
 
+  // keep trace for later dumps
+  if (client->trace != NULL) {
+    lcmbsTraceRelease(client->trace);
+  }
+
   // free thread data
   lcmbsVectFree(&rcvbuf);
   lcmbsVectFree(&sndbuf);
+  lcmbsVectFree(&stream);
+  lcmbsVectFree(&txbuf);
   free(client);
 
   // decrement clinet count 
@@ -336,5 +960,3 @@ void *lcmbsTcpClientThread(void *arg) {
 
   return NULL;
 }
-
-
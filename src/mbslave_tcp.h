@@ -4,9 +4,27 @@
 #include <pthread.h>
 
 #include "mbslave_conf.h"
+#include "mbslave_tls.h"
 
+// High priority requests in progress on the listeners of a slave.
+// Owned by the runtime slave, so all its listeners share one gate.
 typedef struct {
-  LCMBS_CONF_TCP_LSNR_T *listener;
+  pthread_mutex_t lock;
+  pthread_cond_t idle;
+  int active;
+  int waiters;
+} LCMBS_TCP_PRIO_T;
+
+typedef struct {
+  LCMBS_CONF_TCP_LSNR_T listener;
+  LCMBS_CONF_UNIX_LSNR_T unixListener;
+  LCMBS_CONF_TLS_LSNR_T tlsListener;
+  SSL_CTX *sslCtx;
+  LCMBS_RATE_T rate;
+  int family;
+  LCMBS_RCU_T *slave;
+  LCMBS_TCP_PRIO_T *prio;
+  int prioWarned;
   int sd;
   int client_count;
   pthread_t thread;
@@ -15,7 +33,12 @@ typedef struct {
   int exit_flag;
 } LCMBS_TCP_SERVER_DATA_T;
 
-LCMBS_TCP_SERVER_DATA_T *lcmbsTcpStart(LCMBS_CONF_TCP_LSNR_T *listener);
+void lcmbsTcpPrioInit(LCMBS_TCP_PRIO_T *prio);
+void lcmbsTcpPrioFree(LCMBS_TCP_PRIO_T *prio);
+
+LCMBS_TCP_SERVER_DATA_T *lcmbsTcpStart(LCMBS_CONF_TCP_LSNR_T *listener, LCMBS_RCU_T *slave, LCMBS_TCP_PRIO_T *prio);
+LCMBS_TCP_SERVER_DATA_T *lcmbsUnixStart(LCMBS_CONF_UNIX_LSNR_T *listener, LCMBS_RCU_T *slave, LCMBS_TCP_PRIO_T *prio);
+LCMBS_TCP_SERVER_DATA_T *lcmbsTlsStart(LCMBS_CONF_TLS_LSNR_T *listener, LCMBS_RCU_T *slave, LCMBS_TCP_PRIO_T *prio);
 void lcmbsTcpStop(LCMBS_TCP_SERVER_DATA_T *server);
 
 #endif
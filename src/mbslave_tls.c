@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+
+#include "mbslave_tls.h"
+#include "mbslave_prot.h"
+
+// X.509v3 extension carrying the client role (Modbus/TCP Security)
+#define ROLE_OID          "1.3.6.1.4.1.50316.802.1"
+#define ROLE_LEN          64
+#define HANDSHAKE_TIMEOUT 5
+
+static const unsigned char sessionIdContext[] = "mbslave";
+
+static void printSslError(const char *msg, const char *arg) {
+  char buf[256];
+
+  ERR_error_string_n(ERR_get_error(), buf, sizeof(buf));
+  fprintf(stderr, "%s: ERROR: %s%s (%s)\n", compName, msg, arg, buf);
+  ERR_clear_error();
+}
+
+SSL_CTX *lcmbsTlsCreateCtx(LCMBS_CONF_TLS_LSNR_T *listener) {
+  SSL_CTX *ctx;
+
+  ctx = SSL_CTX_new(TLS_server_method());
+  if (!ctx) {
+    printSslError("Unable to create TLS context", "");
+    goto fail0;
+  }
+
+  // Modbus/TCP Security requires TLS 1.2 or later
+  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+
+  // load server identity
+  if (SSL_CTX_use_certificate_chain_file(ctx, listener->cert) != 1) {
+    printSslError("Unable to load certificate ", listener->cert);
+    goto fail1;
+  }
+  if (SSL_CTX_use_PrivateKey_file(ctx, listener->key, SSL_FILETYPE_PEM) != 1 || SSL_CTX_check_private_key(ctx) != 1) {
+    printSslError("Unable to load private key ", listener->key);
+    goto fail1;
+  }
+
+  // clients have to present a certificate signed by the CA
+  if (SSL_CTX_load_verify_locations(ctx, listener->ca, NULL) != 1) {
+    printSslError("Unable to load CA ", listener->ca);
+    goto fail1;
+  }
+  SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+
+  // session resumption skips certificate exchange and verification on
+  // reconnects, via session ids (TLS 1.2) or tickets (TLS 1.3)
+  SSL_CTX_set_session_id_context(ctx, sessionIdContext, sizeof(sessionIdContext) - 1);
+  if (listener->sessionCache > 0) {
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+    SSL_CTX_sess_set_cache_size(ctx, listener->sessionCache);
+    SSL_CTX_set_timeout(ctx, listener->sessionTimeout);
+  } else {
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    SSL_CTX_set_num_tickets(ctx, 0);
+  }
+
+  // let the kernel handle the record layer if OpenSSL
+  // and the kernel support it for the negotiated cipher
+#ifdef SSL_OP_ENABLE_KTLS
+  if (listener->ktls) {
+    SSL_CTX_set_options(ctx, SSL_OP_ENABLE_KTLS);
+  }
+#endif
+
+  return ctx;
+
+fail1:
+  SSL_CTX_free(ctx);
+fail0:
+  return NULL;
+}
+
+static int getRole(X509 *cert, char *role, size_t size) {
+  ASN1_OBJECT *obj;
+  ASN1_UTF8STRING *str;
+  ASN1_OCTET_STRING *data;
+  const unsigned char *p;
+  int idx, len;
+
+  // prefer the Modbus role extension
+  obj = OBJ_txt2obj(ROLE_OID, 1);
+  if (!obj) {
+    return -1;
+  }
+  idx = X509_get_ext_by_OBJ(cert, obj, -1);
+  ASN1_OBJECT_free(obj);
+
+  if (idx >= 0) {
+    data = X509_EXTENSION_get_data(X509_get_ext(cert, idx));
+    p = ASN1_STRING_get0_data(data);
+    str = d2i_ASN1_UTF8STRING(NULL, &p, ASN1_STRING_length(data));
+    if (!str) {
+      return -1;
+    }
+    len = ASN1_STRING_length(str);
+    if (len >= size) {
+      len = size - 1;
+    }
+    memcpy(role, ASN1_STRING_get0_data(str), len);
+    role[len] = 0;
+    ASN1_UTF8STRING_free(str);
+    return 0;
+  }
+
+  // fall back to the subject common name
+  if (X509_NAME_get_text_by_NID(X509_get_subject_name(cert), NID_commonName, role, size) < 0) {
+    return -1;
+  }
+
+  return 0;
+}
+
+static int roleFlags(LCMBS_CONF_TLS_LSNR_T *listener, const char *role) {
+  // without role lists every authenticated client may write
+  if (listener->readRoles[0] == 0 && listener->writeRoles[0] == 0) {
+    return 0;
+  }
+
+  if (lcmbsStrListed(listener->writeRoles, role)) {
+    return 0;
+  }
+  if (lcmbsStrListed(listener->readRoles, role)) {
+    return LCMBS_PROT_READONLY;
+  }
+
+  return -1;
+}
+
+static void setTimeout(int sd, int sec) {
+  struct timeval tv;
+
+  tv.tv_sec = sec;
+  tv.tv_usec = 0;
+  setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(sd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+SSL *lcmbsTlsAccept(SSL_CTX *ctx, LCMBS_CONF_TLS_LSNR_T *listener, int sd, const char *addr, int *flags) {
+  char role[ROLE_LEN];
+  X509 *cert;
+  SSL *ssl;
+  int optval;
+
+  ssl = SSL_new(ctx);
+  if (!ssl) {
+    goto fail0;
+  }
+  if (SSL_set_fd(ssl, sd) != 1) {
+    goto fail1;
+  }
+
+  // handshake flights and pipelined responses are
+  // written as separate records, don't delay them
+  optval = 1;
+  setsockopt(sd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+
+  // the handshake is blocking, so bound the time a
+  // client thread can't react on the exit flag
+  setTimeout(sd, HANDSHAKE_TIMEOUT);
+  if (SSL_accept(ssl) != 1) {
+    goto fail1;
+  }
+  setTimeout(sd, 0);
+
+  // map client certificate to access rights, resumed
+  // sessions keep the certificate of the full handshake
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  cert = SSL_get1_peer_certificate(ssl);
+#else
+  cert = SSL_get_peer_certificate(ssl);
+#endif
+  if (!cert) {
+    goto fail1;
+  }
+  if (getRole(cert, role, sizeof(role))) {
+    fprintf(stderr, "%s: WARNING: TLS client %s has no role\n", compName, addr);
+    goto fail2;
+  }
+  if ((*flags = roleFlags(listener, role)) < 0) {
+    fprintf(stderr, "%s: WARNING: TLS client %s role %s not authorized\n", compName, addr, role);
+    goto fail2;
+  }
+  X509_free(cert);
+
+  return ssl;
+
+fail2:
+  X509_free(cert);
+fail1:
+  SSL_free(ssl);
+fail0:
+  ERR_clear_error();
+  return NULL;
+}
+
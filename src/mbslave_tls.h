@@ -0,0 +1,12 @@
+#ifndef _LCMBS_TLS_H
+#define _LCMBS_TLS_H
+
+#include <openssl/ssl.h>
+
+#include "mbslave_conf.h"
+
+SSL_CTX *lcmbsTlsCreateCtx(LCMBS_CONF_TLS_LSNR_T *listener);
+SSL *lcmbsTlsAccept(SSL_CTX *ctx, LCMBS_CONF_TLS_LSNR_T *listener, int sd, const char *addr, int *flags);
+
+#endif
+
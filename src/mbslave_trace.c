@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "mbslave_trace.h"
+#include "mbslave_util.h"
+
+// minimum distance between dumps triggered by slow requests
+#define TRIGGER_INTERVAL 5000000000ULL
+
+static char traceFile[PATH_MAX];
+static uint32_t thresholdNs;
+static uint64_t lastTrigger;
+static int dumpEvent = -1;
+
+static pthread_mutex_t ringsLock = PTHREAD_MUTEX_INITIALIZER;
+static LCMBS_TRACE_RING_T *rings;
+static LCMBS_TRACE_RING_T *freeHead;
+static LCMBS_TRACE_RING_T *freeTail;
+static int ringCount;
+
+static LCMBS_TRACEFMT_EVENT_T dumpBuf[LCMBS_TRACE_RING_SIZE];
+
+
+int lcmbsTraceInit(const char *file, int threshold) {
+  if (strlen(file) >= PATH_MAX) {
+    fprintf(stderr, "%s: ERROR: trace file name %s too long\n", compName, file);
+    return -1;
+  }
+  strcpy(traceFile, file);
+  // service times saturate at UINT32_MAX, so does the threshold
+  thresholdNs = ((uint64_t) threshold * 1000000 > UINT32_MAX) ? UINT32_MAX : (uint32_t) threshold * 1000000;
+
+  // dumps are written by the main loop, never by client threads
+  dumpEvent = eventfd(0, 0);
+  if (dumpEvent < 0) {
+    fprintf(stderr, "%s: ERROR: unable to create trace dump event\n", compName);
+    return -1;
+  }
+
+  return 0;
+}
+
+void lcmbsTraceFree(void) {
+  LCMBS_TRACE_RING_T *ring, *next;
+
+  for (ring = rings; ring != NULL; ring = next) {
+    next = ring->next;
+    free(ring);
+  }
+  rings = NULL;
+  freeHead = NULL;
+  freeTail = NULL;
+  ringCount = 0;
+
+  if (dumpEvent >= 0) {
+    close(dumpEvent);
+    dumpEvent = -1;
+  }
+}
+
+int lcmbsTraceEventFd(void) {
+  return dumpEvent;
+}
+
+LCMBS_TRACE_RING_T *lcmbsTraceAcquire(uint16_t client, const char *addr, int port) {
+  LCMBS_TRACE_RING_T *ring;
+
+  pthread_mutex_lock(&ringsLock);
+
+  // keep the history of recently closed connections by reusing
+  // the ring released first only once the minimum pool exists
+  ring = (ringCount >= LCMBS_TRACE_RINGS_KEEP) ? freeHead : NULL;
+  if (ring != NULL) {
+    freeHead = ring->nextFree;
+    if (freeHead == NULL) {
+      freeTail = NULL;
+    }
+  } else {
+    ring = calloc(1, sizeof(LCMBS_TRACE_RING_T));
+    if (ring == NULL) {
+      goto out;
+    }
+    ring->next = rings;
+    rings = ring;
+    ringCount++;
+  }
+
+  ring->nextFree = NULL;
+  strncpy(ring->info.addr, addr, LCMBS_TRACEFMT_ADDR_LEN - 1);
+  ring->info.addr[LCMBS_TRACEFMT_ADDR_LEN - 1] = 0;
+  ring->info.client = client;
+  ring->info.port = port;
+  ring->info.opened = lcmbsTimeNs();
+  ring->info.closed = 0;
+  __atomic_store_n(&ring->head, 0, __ATOMIC_RELEASE);
+
+out:
+  pthread_mutex_unlock(&ringsLock);
+  return ring;
+}
+
+void lcmbsTraceRelease(LCMBS_TRACE_RING_T *ring) {
+  pthread_mutex_lock(&ringsLock);
+
+  ring->info.closed = lcmbsTimeNs();
+  if (freeTail != NULL) {
+    freeTail->nextFree = ring;
+  } else {
+    freeHead = ring;
+  }
+  freeTail = ring;
+
+  pthread_mutex_unlock(&ringsLock);
+}
+
+void lcmbsTraceTrigger(void) {
+  // async signal safe
+  uint64_t u = 1;
+  if (dumpEvent >= 0 && write(dumpEvent, &u, sizeof(uint64_t)) < 0) {
+    return;
+  }
+}
+
+void lcmbsTraceCheck(uint32_t service) {
+  uint64_t now, last;
+
+  if (thresholdNs == 0 || service < thresholdNs) {
+    return;
+  }
+
+  // one dump per incident, later slow requests are in the next one
+  now = lcmbsTimeNs();
+  last = __atomic_load_n(&lastTrigger, __ATOMIC_RELAXED);
+  if (last != 0 && now - last < TRIGGER_INTERVAL) {
+    return;
+  }
+  if (__atomic_compare_exchange_n(&lastTrigger, &last, now, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    lcmbsTraceTrigger();
+  }
+}
+
+static int lcmbsTraceDumpRing(FILE *file, LCMBS_TRACE_RING_T *ring) {
+  LCMBS_TRACEFMT_RING_T info;
+  uint64_t head, first, seq;
+  uint32_t n;
+
+  // copy events, then drop the ones the owner may have
+  // overwritten meanwhile. The slot of the oldest event is the
+  // one the owner writes next, so it is never trusted.
+  head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  first = (head >= LCMBS_TRACE_RING_SIZE) ? head - LCMBS_TRACE_RING_SIZE + 1 : 0;
+  for (seq = first; seq < head; seq++) {
+    dumpBuf[seq - first] = ring->events[seq & LCMBS_TRACE_RING_MASK];
+  }
+  seq = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+  seq = (seq >= LCMBS_TRACE_RING_SIZE) ? seq - LCMBS_TRACE_RING_SIZE + 1 : 0;
+  if (seq > head) {
+    seq = head;
+  }
+  if (seq < first) {
+    seq = first;
+  }
+  n = head - seq;
+
+  info = ring->info;
+  info.count = n;
+  if (fwrite(&info, sizeof(info), 1, file) != 1) {
+    return -1;
+  }
+  if (n > 0 && fwrite(&dumpBuf[seq - first], sizeof(LCMBS_TRACEFMT_EVENT_T), n, file) != n) {
+    return -1;
+  }
+
+  return 0;
+}
+
+int lcmbsTraceDump(void) {
+  char tmpFile[PATH_MAX + 8];
+  LCMBS_TRACEFMT_HDR_T hdr;
+  LCMBS_TRACE_RING_T *ring;
+  struct timespec ts;
+  FILE *file;
+  uint64_t u;
+  int fd;
+
+  // reset dump event
+  if (read(dumpEvent, &u, sizeof(uint64_t)) < 0) {
+    return -1;
+  }
+
+  // write to a temporary file, readers never see a partial dump.
+  // mkstemp() never opens an existing file or follows a symlink
+  // planted in a shared directory like /tmp.
+  snprintf(tmpFile, sizeof(tmpFile), "%s.XXXXXX", traceFile);
+  fd = mkstemp(tmpFile);
+  if (fd < 0) {
+    fprintf(stderr, "%s: ERROR: unable to create trace file %s\n", compName, tmpFile);
+    goto fail0;
+  }
+  file = fdopen(fd, "w");
+  if (!file) {
+    fprintf(stderr, "%s: ERROR: unable to create trace file %s\n", compName, tmpFile);
+    close(fd);
+    unlink(tmpFile);
+    goto fail0;
+  }
+
+  pthread_mutex_lock(&ringsLock);
+
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = LCMBS_TRACEFMT_MAGIC;
+  hdr.version = LCMBS_TRACEFMT_VERSION;
+  hdr.rings = ringCount;
+  hdr.eventSize = sizeof(LCMBS_TRACEFMT_EVENT_T);
+  hdr.monotonic = lcmbsTimeNs();
+  clock_gettime(CLOCK_REALTIME, &ts);
+  hdr.realtime = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  if (fwrite(&hdr, sizeof(hdr), 1, file) != 1) {
+    goto fail1;
+  }
+
+  for (ring = rings; ring != NULL; ring = ring->next) {
+    if (lcmbsTraceDumpRing(file, ring)) {
+      goto fail1;
+    }
+  }
+
+  pthread_mutex_unlock(&ringsLock);
+
+  if (fclose(file)) {
+    goto fail2;
+  }
+  if (rename(tmpFile, traceFile)) {
+    goto fail2;
+  }
+
+  fprintf(stdout, "%s: Trace written to %s\n", compName, traceFile);
+  fflush(stdout);
+  return 0;
+
+fail1:
+  pthread_mutex_unlock(&ringsLock);
+  fclose(file);
+fail2:
+  fprintf(stderr, "%s: ERROR: unable to write trace file %s\n", compName, tmpFile);
+  unlink(tmpFile);
+fail0:
+  return -1;
+}
+
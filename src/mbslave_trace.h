@@ -0,0 +1,45 @@
+#ifndef _LCMBS_TRACE_H
+#define _LCMBS_TRACE_H
+
+#include <stdint.h>
+
+#include "mbslave_tracefmt.h"
+
+// Always-on request trace. Every client thread records into its own ring,
+// so recording takes no locks. Once LCMBS_TRACE_RINGS_KEEP rings exist,
+// rings of closed connections are reused oldest first.
+
+#define LCMBS_TRACE_RING_SIZE 2048
+#define LCMBS_TRACE_RING_MASK (LCMBS_TRACE_RING_SIZE - 1)
+#define LCMBS_TRACE_RINGS_KEEP 16
+
+#define LCMBS_TRACE_FILE_DEFAULT "/tmp/mbslave.trace"
+
+typedef struct LCMBS_TRACE_RING {
+  struct LCMBS_TRACE_RING *next;
+  struct LCMBS_TRACE_RING *nextFree;
+  LCMBS_TRACEFMT_RING_T info;
+  uint64_t head;
+  LCMBS_TRACEFMT_EVENT_T events[LCMBS_TRACE_RING_SIZE];
+} LCMBS_TRACE_RING_T;
+
+int lcmbsTraceInit(const char *file, int threshold);
+void lcmbsTraceFree(void);
+int lcmbsTraceEventFd(void);
+
+LCMBS_TRACE_RING_T *lcmbsTraceAcquire(uint16_t client, const char *addr, int port);
+void lcmbsTraceRelease(LCMBS_TRACE_RING_T *ring);
+
+void lcmbsTraceTrigger(void);
+void lcmbsTraceCheck(uint32_t service);
+int lcmbsTraceDump(void);
+
+static inline void lcmbsTraceRecord(LCMBS_TRACE_RING_T *ring, const LCMBS_TRACEFMT_EVENT_T *ev) {
+  // single writer, the dump only trusts events below head
+  uint64_t head = ring->head;
+  ring->events[head & LCMBS_TRACE_RING_MASK] = *ev;
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+#endif
+
@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "mbslave_tracefmt.h"
+
+// Decoder for mbslave request trace dumps
+
+typedef struct {
+  const LCMBS_TRACEFMT_RING_T *ring;
+  const LCMBS_TRACEFMT_EVENT_T *ev;
+} TRACE_ENTRY_T;
+
+typedef struct {
+  uint64_t count;
+  uint64_t exceptions;
+  uint64_t total;
+  uint32_t max;
+  uint32_t *times;
+} TRACE_STATS_T;
+
+static const char *progName = "mbslave-trace";
+
+static const struct option longOptions[] = {
+  { "summary", no_argument, NULL, 's' },
+  { "min-service", required_argument, NULL, 'm' },
+  { NULL, 0, NULL, 0 }
+};
+
+static int64_t clockOffset;
+
+
+static void usage(void) {
+  fprintf(stderr, "usage: %s [--summary] [--min-service=US] tracefile\n", progName);
+}
+
+static void *readFile(const char *filename, size_t *size) {
+  FILE *file;
+  void *data;
+  long len;
+
+  file = fopen(filename, "rb");
+  if (!file) {
+    goto fail0;
+  }
+  if (fseek(file, 0, SEEK_END) || (len = ftell(file)) < 0 || fseek(file, 0, SEEK_SET)) {
+    goto fail1;
+  }
+  data = malloc(len > 0 ? len : 1);
+  if (!data) {
+    goto fail1;
+  }
+  if (fread(data, 1, len, file) != len) {
+    goto fail2;
+  }
+
+  fclose(file);
+  *size = len;
+  return data;
+
+fail2:
+  free(data);
+fail1:
+  fclose(file);
+fail0:
+  return NULL;
+}
+
+static void formatTime(uint64_t mono, char *buf, size_t size) {
+  uint64_t real = mono + clockOffset;
+  time_t sec = real / 1000000000ULL;
+  struct tm tm;
+  size_t len;
+
+  localtime_r(&sec, &tm);
+  len = strftime(buf, size, "%Y-%m-%d %H:%M:%S", &tm);
+  snprintf(buf + len, size - len, ".%06u", (unsigned) ((real % 1000000000ULL) / 1000));
+}
+
+static int compareEntries(const void *a, const void *b) {
+  const TRACE_ENTRY_T *ea = a;
+  const TRACE_ENTRY_T *eb = b;
+
+  if (ea->ev->ts != eb->ev->ts) {
+    return (ea->ev->ts < eb->ev->ts) ? -1 : 1;
+  }
+  return 0;
+}
+
+static int compareTimes(const void *a, const void *b) {
+  uint32_t ta = *(const uint32_t *) a;
+  uint32_t tb = *(const uint32_t *) b;
+
+  return (ta > tb) - (ta < tb);
+}
+
+static void printEvents(TRACE_ENTRY_T *entries, size_t count, uint32_t minService) {
+  char ts[64];
+  size_t i;
+
+  printf("%-26s %5s %-15s %5s %4s %3s %5s %5s %3s %10s\n",
+    "time", "conn", "client", "port", "unit", "fc", "start", "count", "exc", "service/us");
+
+  for (i = 0; i < count; i++) {
+    const LCMBS_TRACEFMT_EVENT_T *ev = entries[i].ev;
+    const LCMBS_TRACEFMT_RING_T *ring = entries[i].ring;
+    if (ev->service < minService) {
+      continue;
+    }
+    formatTime(ev->ts, ts, sizeof(ts));
+    printf("%-26s %5u %-15s %5u %4u %3u %5u %5u %3u %10.1f\n",
+      ts, ev->client, ring->addr, ring->port, ev->unit, ev->fnk,
+      ev->start, ev->count, ev->exception, ev->service / 1000.0);
+  }
+}
+
+static void printStats(const char *label, TRACE_STATS_T *stats) {
+  uint32_t p99;
+
+  if (stats->count == 0) {
+    return;
+  }
+
+  qsort(stats->times, stats->count, sizeof(uint32_t), compareTimes);
+  p99 = stats->times[(stats->count * 99) / 100];
+  printf("%-24s %8llu %6llu %10.1f %10.1f %10.1f %10.1f\n", label,
+    (unsigned long long) stats->count, (unsigned long long) stats->exceptions,
+    stats->total / 1000.0 / stats->count, stats->times[stats->count / 2] / 1000.0,
+    p99 / 1000.0, stats->max / 1000.0);
+}
+
+static void addStats(TRACE_STATS_T *stats, const LCMBS_TRACEFMT_EVENT_T *ev) {
+  stats->times[stats->count++] = ev->service;
+  stats->total += ev->service;
+  if (ev->service > stats->max) {
+    stats->max = ev->service;
+  }
+  if (ev->exception != 0) {
+    stats->exceptions++;
+  }
+}
+
+static int printSummary(TRACE_ENTRY_T *entries, size_t count, const LCMBS_TRACEFMT_RING_T **rings, uint32_t ringCount) {
+  TRACE_STATS_T fnkStats[256];
+  TRACE_STATS_T connStats;
+  char label[64], first[64], last[64];
+  uint32_t r;
+  size_t i;
+  int f, ret = -1;
+
+  memset(fnkStats, 0, sizeof(fnkStats));
+  memset(&connStats, 0, sizeof(connStats));
+  connStats.times = malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+  if (!connStats.times) {
+    goto out;
+  }
+
+  if (count > 0) {
+    formatTime(entries[0].ev->ts, first, sizeof(first));
+    formatTime(entries[count - 1].ev->ts, last, sizeof(last));
+    printf("%zu requests from %s to %s\n\n", count, first, last);
+  }
+
+  // per function code
+  printf("%-24s %8s %6s %10s %10s %10s %10s\n", "function", "requests", "exc", "avg/us", "p50/us", "p99/us", "max/us");
+  for (i = 0; i < count; i++) {
+    TRACE_STATS_T *stats = &fnkStats[entries[i].ev->fnk];
+    if (!stats->times) {
+      stats->times = malloc(count * sizeof(uint32_t));
+      if (!stats->times) {
+        goto out;
+      }
+    }
+    addStats(stats, entries[i].ev);
+  }
+  for (f = 0; f < 256; f++) {
+    snprintf(label, sizeof(label), "fc %d", f);
+    printStats(label, &fnkStats[f]);
+  }
+
+  // per connection
+  printf("\n%-24s %8s %6s %10s %10s %10s %10s\n", "connection", "requests", "exc", "avg/us", "p50/us", "p99/us", "max/us");
+  for (r = 0; r < ringCount; r++) {
+    const LCMBS_TRACEFMT_RING_T *ring = rings[r];
+    const LCMBS_TRACEFMT_EVENT_T *ev = (const LCMBS_TRACEFMT_EVENT_T *) (ring + 1);
+    connStats.count = 0;
+    connStats.exceptions = 0;
+    connStats.total = 0;
+    connStats.max = 0;
+    for (i = 0; i < ring->count; i++) {
+      addStats(&connStats, &ev[i]);
+    }
+    snprintf(label, sizeof(label), "%u %s:%u%s", ring->client, ring->addr, ring->port, ring->closed ? "" : "*");
+    printStats(label, &connStats);
+  }
+  printf("(* connection open at dump time)\n");
+
+  ret = 0;
+
+out:
+  for (f = 0; f < 256; f++) {
+    free(fnkStats[f].times);
+  }
+  free(connStats.times);
+  return ret;
+}
+
+int main(int argc, char **argv) {
+  int ret = 1;
+  int summary = 0;
+  int opt;
+  uint32_t minService = 0;
+  const LCMBS_TRACEFMT_HDR_T *hdr;
+  const LCMBS_TRACEFMT_RING_T **rings;
+  TRACE_ENTRY_T *entries;
+  const uint8_t *data, *pos, *end;
+  size_t size, count, i;
+  uint32_t r;
+
+  // parse options
+  while ((opt = getopt_long(argc, argv, "sm:", longOptions, NULL)) != -1) {
+    switch (opt) {
+      case 's':
+        summary = 1;
+        break;
+      case 'm':
+        minService = atoi(optarg) * 1000;
+        break;
+      default:
+        usage();
+        goto fail0;
+    }
+  }
+  if (optind != argc - 1) {
+    usage();
+    goto fail0;
+  }
+
+  // load and check dump
+  data = readFile(argv[optind], &size);
+  if (!data) {
+    fprintf(stderr, "%s: ERROR: unable to read %s\n", progName, argv[optind]);
+    goto fail0;
+  }
+  hdr = (const LCMBS_TRACEFMT_HDR_T *) data;
+  if (size < sizeof(LCMBS_TRACEFMT_HDR_T) || hdr->magic != LCMBS_TRACEFMT_MAGIC ||
+      hdr->version != LCMBS_TRACEFMT_VERSION || hdr->eventSize != sizeof(LCMBS_TRACEFMT_EVENT_T)) {
+    fprintf(stderr, "%s: ERROR: %s is not a trace dump of this version\n", progName, argv[optind]);
+    goto fail1;
+  }
+  clockOffset = (int64_t) (hdr->realtime - hdr->monotonic);
+
+  // index rings
+  rings = calloc(hdr->rings > 0 ? hdr->rings : 1, sizeof(LCMBS_TRACEFMT_RING_T *));
+  if (!rings) {
+    goto fail1;
+  }
+  pos = data + sizeof(LCMBS_TRACEFMT_HDR_T);
+  end = data + size;
+  count = 0;
+  for (r = 0; r < hdr->rings; r++) {
+    const LCMBS_TRACEFMT_RING_T *ring = (const LCMBS_TRACEFMT_RING_T *) pos;
+    if (end - pos < sizeof(LCMBS_TRACEFMT_RING_T) ||
+        (end - pos - sizeof(LCMBS_TRACEFMT_RING_T)) / sizeof(LCMBS_TRACEFMT_EVENT_T) < ring->count) {
+      fprintf(stderr, "%s: ERROR: %s is truncated\n", progName, argv[optind]);
+      goto fail2;
+    }
+    rings[r] = ring;
+    count += ring->count;
+    pos += sizeof(LCMBS_TRACEFMT_RING_T) + ring->count * sizeof(LCMBS_TRACEFMT_EVENT_T);
+  }
+
+  // merge all rings in time order
+  entries = malloc((count > 0 ? count : 1) * sizeof(TRACE_ENTRY_T));
+  if (!entries) {
+    goto fail2;
+  }
+  count = 0;
+  for (r = 0; r < hdr->rings; r++) {
+    const LCMBS_TRACEFMT_EVENT_T *ev = (const LCMBS_TRACEFMT_EVENT_T *) (rings[r] + 1);
+    for (i = 0; i < rings[r]->count; i++) {
+      entries[count].ring = rings[r];
+      entries[count].ev = &ev[i];
+      count++;
+    }
+  }
+  qsort(entries, count, sizeof(TRACE_ENTRY_T), compareEntries);
+
+  if (summary) {
+    if (printSummary(entries, count, rings, hdr->rings)) {
+      fprintf(stderr, "%s: ERROR: out of memory\n", progName);
+      goto fail3;
+    }
+  } else {
+    printEvents(entries, count, minService);
+  }
+
+  ret = 0;
+
+fail3:
+  free(entries);
+fail2:
+  free(rings);
+fail1:
+  free((void *) data);
+fail0:
+  return ret;
+}
+
@@ -0,0 +1,55 @@
+#ifndef _LCMBS_TRACEFMT_H
+#define _LCMBS_TRACEFMT_H
+
+#include <stdint.h>
+
+// Layout of a request trace dump
+//
+// The file starts with LCMBS_TRACEFMT_HDR_T, followed by one record per
+// trace ring. Each ring holds the requests of one connection: a ring
+// descriptor LCMBS_TRACEFMT_RING_T, followed by count events, oldest first.
+//
+// Event and ring timestamps are CLOCK_MONOTONIC nanoseconds. The header
+// gives both clocks at dump time, so readers can convert them to wall
+// clock time. start and count are the first two words of the request PDU,
+// exception is 0 for regular responses. service is the time from complete
+// request to response, including rate limit and priority waits. It
+// saturates at UINT32_MAX, i.e. 4.29 s or more.
+
+#define LCMBS_TRACEFMT_MAGIC   0x5442534d
+#define LCMBS_TRACEFMT_VERSION 1
+
+#define LCMBS_TRACEFMT_ADDR_LEN 16
+
+typedef struct {
+  uint64_t ts;
+  uint32_t service;
+  uint16_t client;
+  uint16_t start;
+  uint16_t count;
+  uint8_t unit;
+  uint8_t fnk;
+  uint8_t exception;
+  uint8_t pad[3];
+} LCMBS_TRACEFMT_EVENT_T;
+
+typedef struct {
+  char addr[LCMBS_TRACEFMT_ADDR_LEN];
+  uint16_t client;
+  uint16_t port;
+  uint32_t count;
+  uint64_t opened;
+  uint64_t closed;
+} LCMBS_TRACEFMT_RING_T;
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t rings;
+  uint32_t eventSize;
+  uint64_t monotonic;
+  uint64_t realtime;
+} LCMBS_TRACEFMT_HDR_T;
+
+#endif
+
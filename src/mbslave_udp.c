@@ -0,0 +1,287 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/eventfd.h>
+
+#include "mbslave_udp.h"
+#include "mbslave_util.h"
+#include "mbslave_prot.h"
+#include "mbslave_diag.h"
+
+#define HEADER_LEN 6
+#define PACKET_MAX 512
+
+typedef struct {
+  uint8_t rx[PACKET_MAX];
+  uint8_t tx[PACKET_MAX];
+  struct sockaddr_storage addr;
+  struct iovec rxIov;
+  struct iovec txIov;
+} LCMBS_UDP_SLOT_T;
+
+typedef struct {
+  int size;
+  LCMBS_UDP_SLOT_T *slots;
+  struct mmsghdr *rxMsgs;
+  struct mmsghdr *txMsgs;
+  LCMBS_VECT_T rcvbuf;
+  LCMBS_VECT_T sndbuf;
+} LCMBS_UDP_BATCH_T;
+
+
+static void *lcmbsUdpServerThread(void *arg);
+
+
+LCMBS_UDP_SERVER_DATA_T *lcmbsUdpStart(LCMBS_CONF_UDP_LSNR_T *listener, LCMBS_RCU_T *slave) {
+  LCMBS_UDP_SERVER_DATA_T *server;
+  int optval;
+  struct sockaddr_in addr;
+
+  // alloc memory
+  server = calloc(1, sizeof(LCMBS_UDP_SERVER_DATA_T));
+  if (!server) {
+    goto fail0;
+  }
+
+  // the listener config is copied as the slave
+  // tables may be replaced by a config reload
+  server->listener = *listener;
+  server->slave = slave;
+
+  // create exit flag event
+  if ((server->exit_flag = eventfd(0, 0)) < 0) {
+    goto fail1;
+  }
+
+  // create socket
+  if ((server->sd = socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
+    goto fail2;
+  }
+
+  // allow a quick restart next to a still closing instance
+  optval = 1;
+  setsockopt(server->sd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+
+  // bind to udp port
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(listener->port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(server->sd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+    goto fail3;
+  }
+
+  // start server thread
+  if (pthread_create(&server->thread, 0, lcmbsUdpServerThread, server)) {
+    goto fail3;
+  }
+
+  return server;
+
+fail3:
+  close(server->sd);
+fail2:
+  close(server->exit_flag);
+fail1:
+  free(server);
+fail0:
+  return NULL;
+}
+
+void lcmbsUdpStop(LCMBS_UDP_SERVER_DATA_T *server) {
+  // set exit flag
+  uint64_t u = 1;
+  write(server->exit_flag, &u, sizeof(uint64_t));
+
+  // wait for server thread
+  pthread_join(server->thread, NULL);
+
+  close(server->sd);
+  close(server->exit_flag);
+  free(server);
+}
+
+static int lcmbsUdpInitBatch(LCMBS_UDP_BATCH_T *batch, int size) {
+  int i;
+
+  memset(batch, 0, sizeof(LCMBS_UDP_BATCH_T));
+  lcmbsVectInit(&batch->rcvbuf, 1);
+  lcmbsVectInit(&batch->sndbuf, 1);
+
+  batch->slots = calloc(size, sizeof(LCMBS_UDP_SLOT_T));
+  batch->rxMsgs = calloc(size, sizeof(struct mmsghdr));
+  batch->txMsgs = calloc(size, sizeof(struct mmsghdr));
+  if (!batch->slots || !batch->rxMsgs || !batch->txMsgs) {
+    return -1;
+  }
+  batch->size = size;
+
+  // receive headers point to fixed slots, so
+  // they only need to be prepared once
+  for (i = 0; i < size; i++) {
+    LCMBS_UDP_SLOT_T *slot = &batch->slots[i];
+    slot->rxIov.iov_base = slot->rx;
+    slot->rxIov.iov_len = PACKET_MAX;
+    batch->rxMsgs[i].msg_hdr.msg_iov = &slot->rxIov;
+    batch->rxMsgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  return 0;
+}
+
+static void lcmbsUdpFreeBatch(LCMBS_UDP_BATCH_T *batch) {
+  free(batch->slots);
+  free(batch->rxMsgs);
+  free(batch->txMsgs);
+  lcmbsVectFree(&batch->rcvbuf);
+  lcmbsVectFree(&batch->sndbuf);
+}
+
+static int lcmbsUdpProcDatagram(LCMBS_CONF_SLAVE_T *slave, LCMBS_UDP_BATCH_T *batch, int idx, struct mmsghdr *txMsg) {
+  LCMBS_UDP_SLOT_T *slot = &batch->slots[idx];
+  struct msghdr *rxHdr = &batch->rxMsgs[idx].msg_hdr;
+  unsigned int rcvd = batch->rxMsgs[idx].msg_len;
+  uint16_t prot, len;
+
+  // drop truncated, short and malformed datagrams
+  if (rxHdr->msg_flags & MSG_TRUNC) {
+    lcmbsDiagOverrun(slave->diag);
+    return 0;
+  }
+  if (rcvd < HEADER_LEN) {
+    lcmbsDiagCommError(slave->diag);
+    return 0;
+  }
+  prot = ntohs(*((uint16_t *) &slot->rx[2]));
+  len = ntohs(*((uint16_t *) &slot->rx[4]));
+  if (prot != 0 || len != rcvd - HEADER_LEN) {
+    lcmbsDiagCommError(slave->diag);
+    return 0;
+  }
+
+  lcmbsVectClear(&batch->rcvbuf);
+  if (!lcmbsVectPutData(&batch->rcvbuf, &slot->rx[HEADER_LEN], len)) {
+    return 0;
+  }
+
+  // process request, no response is sent on broadcast ids
+  len = lcmbsProtProc(slave, &batch->rcvbuf, &batch->sndbuf, 0);
+  if (len == 0 || len > PACKET_MAX - HEADER_LEN) {
+    return 0;
+  }
+
+  // response echoes the transaction id
+  memcpy(slot->tx, slot->rx, 2);
+  *((uint16_t *) &slot->tx[2]) = 0;
+  *((uint16_t *) &slot->tx[4]) = htons(len);
+  memcpy(&slot->tx[HEADER_LEN], batch->sndbuf.data, len);
+
+  slot->txIov.iov_base = slot->tx;
+  slot->txIov.iov_len = HEADER_LEN + len;
+  memset(txMsg, 0, sizeof(struct mmsghdr));
+  txMsg->msg_hdr.msg_name = &slot->addr;
+  txMsg->msg_hdr.msg_namelen = rxHdr->msg_namelen;
+  txMsg->msg_hdr.msg_iov = &slot->txIov;
+  txMsg->msg_hdr.msg_iovlen = 1;
+
+  return 1;
+}
+
+static int lcmbsUdpProcBatch(LCMBS_UDP_SERVER_DATA_T *server, LCMBS_UDP_BATCH_T *batch) {
+  LCMBS_CONF_SLAVE_T *slave;
+  int i, count, replies, sent, rcuIdx;
+
+  // reset address lengths clobbered by the previous call
+  for (i = 0; i < batch->size; i++) {
+    batch->rxMsgs[i].msg_hdr.msg_name = &batch->slots[i].addr;
+    batch->rxMsgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+  }
+
+  // fetch all pending datagrams up to the batch size
+  count = recvmmsg(server->sd, batch->rxMsgs, batch->size, MSG_DONTWAIT, NULL);
+  if (count < 0) {
+    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+  }
+
+  // process the whole batch on one snapshot of the slave tables
+  replies = 0;
+  rcuIdx = lcmbsRcuReadLock(server->slave);
+  slave = lcmbsRcuDeref(server->slave);
+  for (i = 0; i < count; i++) {
+    replies += lcmbsUdpProcDatagram(slave, batch, i, &batch->txMsgs[replies]);
+  }
+  lcmbsRcuReadUnlock(server->slave, rcuIdx);
+
+  // send responses, a failed datagram is skipped as
+  // the client will repeat its request anyway
+  i = 0;
+  while (i < replies) {
+    sent = sendmmsg(server->sd, &batch->txMsgs[i], replies - i, 0);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    i += (sent > 0) ? sent : 1;
+  }
+
+  return count;
+}
+
+static void *lcmbsUdpServerThread(void *arg) {
+  LCMBS_UDP_SERVER_DATA_T *server = (LCMBS_UDP_SERVER_DATA_T *) arg;
+  LCMBS_UDP_BATCH_T batch;
+  fd_set set;
+  int max_fd, count;
+
+  if (lcmbsUdpInitBatch(&batch, server->listener.batch)) {
+    fprintf(stderr, "%s: ERROR: Couldn't allocate memory for udp listener on port %d\n", compName, server->listener.port);
+    goto out;
+  }
+
+  while (1) {
+    // wait for data or exit
+    FD_ZERO(&set);
+    max_fd = -1;
+    FD_SET(server->exit_flag, &set);
+    if (max_fd < server->exit_flag) max_fd = server->exit_flag;
+    FD_SET(server->sd, &set);
+    if (max_fd < server->sd) max_fd = server->sd;
+    if (select(max_fd + 1, &set, 0, 0, NULL) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+
+    // check for exit event
+    if (FD_ISSET(server->exit_flag, &set)) {
+      break;
+    }
+
+    // drain socket, a full batch means more may be queued
+    if (FD_ISSET(server->sd, &set)) {
+      do {
+        count = lcmbsUdpProcBatch(server, &batch);
+      } while (count == batch.size);
+      if (count < 0) {
+        fprintf(stderr, "%s: ERROR: receive failed on udp port %d (%s)\n", compName, server->listener.port, strerror(errno));
+        break;
+      }
+    }
+  }
+
+out:
+  lcmbsUdpFreeBatch(&batch);
+  return NULL;
+}
+
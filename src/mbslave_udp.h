@@ -0,0 +1,20 @@
+#ifndef _LCMBS_UDP_H
+#define _LCMBS_UDP_H
+
+#include <pthread.h>
+
+#include "mbslave_conf.h"
+
+typedef struct {
+  LCMBS_CONF_UDP_LSNR_T listener;
+  LCMBS_RCU_T *slave;
+  int sd;
+  pthread_t thread;
+  int exit_flag;
+} LCMBS_UDP_SERVER_DATA_T;
+
+LCMBS_UDP_SERVER_DATA_T *lcmbsUdpStart(LCMBS_CONF_UDP_LSNR_T *listener, LCMBS_RCU_T *slave);
+void lcmbsUdpStop(LCMBS_UDP_SERVER_DATA_T *server);
+
+#endif
+
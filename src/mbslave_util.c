@@ -1,27 +1,162 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
 
 #include "mbslave_util.h"
 
+void lcmbsArenaInit(LCMBS_ARENA_T *arena) {
+  memset(arena, 0, sizeof(LCMBS_ARENA_T));
+}
+
+void lcmbsArenaFree(LCMBS_ARENA_T *arena) {
+  LCMBS_ARENA_BLOCK_T *block, *next;
+
+  for (block = arena->blocks; block != NULL; block = next) {
+    next = block->next;
+    free(block);
+  }
+
+  lcmbsArenaInit(arena);
+}
+
+static size_t arenaHeaderSize(void) {
+  return (sizeof(LCMBS_ARENA_BLOCK_T) + LCMBS_ARENA_ALIGN - 1) & ~((size_t) LCMBS_ARENA_ALIGN - 1);
+}
+
+void *lcmbsArenaAlloc(LCMBS_ARENA_T *arena, size_t size) {
+  LCMBS_ARENA_BLOCK_T *block = arena->blocks;
+  void *p;
+
+  size = (size + LCMBS_ARENA_ALIGN - 1) & ~((size_t) LCMBS_ARENA_ALIGN - 1);
+
+  // start a new block if the current one is exhausted
+  if (block == NULL || (block->size - block->used) < size) {
+    size_t blockSize = LCMBS_ARENA_BLKSIZE;
+    if (size > blockSize) {
+      blockSize = size;
+    }
+
+    block = calloc(1, arenaHeaderSize() + blockSize);
+    if (block == NULL) {
+      return NULL;
+    }
+    block->size = blockSize;
+    arena->allocated += arenaHeaderSize() + blockSize;
+
+    // keep the block with more free space on top
+    if (arena->blocks != NULL && (arena->blocks->size - arena->blocks->used) > (blockSize - size)) {
+      block->next = arena->blocks->next;
+      arena->blocks->next = block;
+    } else {
+      block->next = arena->blocks;
+      arena->blocks = block;
+    }
+  }
+
+  p = ((void *) block) + arenaHeaderSize() + block->used;
+  block->used += size;
+  arena->used += size;
+  return p;
+}
+
+void *lcmbsArenaRealloc(LCMBS_ARENA_T *arena, void *ptr, size_t oldSize, size_t size) {
+  LCMBS_ARENA_BLOCK_T *block = arena->blocks;
+  void *p;
+
+  oldSize = (oldSize + LCMBS_ARENA_ALIGN - 1) & ~((size_t) LCMBS_ARENA_ALIGN - 1);
+
+  // grow in place if ptr is the last allocation of the top block
+  if (ptr != NULL && block != NULL && ptr + oldSize == ((void *) block) + arenaHeaderSize() + block->used) {
+    size_t grow = ((size + LCMBS_ARENA_ALIGN - 1) & ~((size_t) LCMBS_ARENA_ALIGN - 1)) - oldSize;
+    if ((block->size - block->used) >= grow) {
+      block->used += grow;
+      arena->used += grow;
+      return ptr;
+    }
+  }
+
+  // otherwise copy, the old area is released with the arena
+  p = lcmbsArenaAlloc(arena, size);
+  if (p != NULL && ptr != NULL) {
+    memcpy(p, ptr, oldSize < size ? oldSize : size);
+  }
+  return p;
+}
+
 void lcmbsVectInit(LCMBS_VECT_T *vect, size_t typeSize) {
   memset(vect, 0, sizeof(LCMBS_VECT_T));
   vect->typeSize = typeSize;
 }
 
+int lcmbsVectMoveToArena(LCMBS_VECT_T *vect, LCMBS_ARENA_T *arena) {
+  void *data = NULL;
+
+  if (vect->arena != NULL) {
+    return 0;
+  }
+
+  // copy to an exactly sized arena area
+  if (vect->count > 0) {
+    data = lcmbsArenaAlloc(arena, vect->typeSize * vect->count);
+    if (!data) {
+      return -1;
+    }
+    memcpy(data, vect->data, vect->typeSize * vect->count);
+  }
+
+  free(vect->data);
+  vect->data = data;
+  vect->size = vect->count;
+  vect->arena = arena;
+  return 0;
+}
+
+static void *vectResize(LCMBS_VECT_T *vect, size_t size) {
+  void *data;
+
+  if (vect->arena != NULL) {
+    data = lcmbsArenaRealloc(vect->arena, vect->data, vect->typeSize * vect->size, vect->typeSize * size);
+  } else {
+    data = realloc(vect->data, vect->typeSize * size);
+  }
+  if (!data) {
+    return NULL;
+  }
+
+  vect->data = data;
+  vect->size = size;
+  return data;
+}
+
 void *lcmbsVectEnsureSize(LCMBS_VECT_T *vect, size_t count) {
+  size_t size;
+
   if (vect->size >= count) {
    return vect->data;
   }
 
-  vect->size = (((count - 1) / LCMBS_VECT_BLKSIZE) + 1) * LCMBS_VECT_BLKSIZE;
-  vect->data = realloc(vect->data, vect->typeSize * vect->size);
-  return vect->data;
+  // grow geometrically to keep appends amortized O(1),
+  // starting with at least LCMBS_VECT_MINSIZE bytes
+  size = vect->size;
+  if (size == 0) {
+    size = (LCMBS_VECT_MINSIZE + vect->typeSize - 1) / vect->typeSize;
+  }
+  while (size < count) {
+    size <<= 1;
+  }
+
+  return vectResize(vect, size);
 }
 
 void lcmbsVectFree(LCMBS_VECT_T *vect) {
   lcmbsVectClear(vect);
-  free(vect->data);
+  if (vect->arena == NULL) {
+    free(vect->data);
+  }
+  vect->data = NULL;
   vect->size = 0;
 }
 
@@ -38,15 +173,15 @@ void *lcmbsVectGet(LCMBS_VECT_T *vect, size_t idx) {
 }
 
 void *lcmbsVectPut(LCMBS_VECT_T *vect) {
-  if (vect->count >= vect->size) {
-    vect->size += LCMBS_VECT_BLKSIZE;
-    vect->data = realloc(vect->data, vect->typeSize * vect->size);
-    if (!vect->data) {
-      return NULL;
-    }
+  void *p;
+
+  if (!lcmbsVectEnsureSize(vect, vect->count + 1)) {
+    return NULL;
   }
 
-  return lcmbsVectGet(vect, (vect->count++));
+  p = lcmbsVectGet(vect, (vect->count++));
+  memset(p, 0, vect->typeSize);
+  return p;
 }
 
 void *lcmbsVectPull(LCMBS_VECT_T *vect) {
@@ -90,6 +225,17 @@ void *lcmbsVectPutDByte(LCMBS_VECT_T *vect, uint32_t val) {
   return p;
 }
 
+void *lcmbsVectPutData(LCMBS_VECT_T *vect, const void *data, size_t len) {
+  if (vect->typeSize != 1 || !lcmbsVectEnsureSize(vect, vect->count + len)) {
+    return NULL;
+  }
+
+  uint8_t *p = (uint8_t *)(vect->data + vect->count);
+  memcpy(p, data, len);
+  vect->count += len;
+  return p;
+}
+
 void *lcmbsVectPullByte(LCMBS_VECT_T *vect, uint8_t *val) {
   if (vect->typeSize != 1 || (vect->count - vect->pos) < sizeof(uint8_t)) {
     return NULL;
@@ -123,3 +269,224 @@ void *lcmbsVectPullDByte(LCMBS_VECT_T *vect, uint32_t *val) {
   return p;
 }
 
+
+uint64_t lcmbsTimeNs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int lcmbsStrListed(const char *list, const char *item) {
+  size_t len = strlen(item);
+  const char *end;
+
+  // list entries are separated by commas and/or spaces
+  while (*list) {
+    while (*list == ' ' || *list == ',') {
+      list++;
+    }
+    end = list;
+    while (*end && *end != ',' && *end != ' ') {
+      end++;
+    }
+    if (end - list == len && strncmp(list, item, len) == 0) {
+      return 1;
+    }
+    list = end;
+  }
+
+  return 0;
+}
+
+uint32_t lcmbsHashStr(const char *str, uint32_t seed) {
+  // FNV-1a
+  uint32_t hash = 2166136261u ^ seed;
+  for (; *str; str++) {
+    hash ^= (uint8_t) *str;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void lcmbsSwapWords(void *dst, const void *src, size_t count) {
+  uint8_t *d = dst;
+  const uint8_t *s = src;
+  uint16_t w;
+  size_t i;
+
+  // converts between host and network order, both ways are the same
+  for (i = 0; i < count; i++) {
+    memcpy(&w, s + i * 2, sizeof(w));
+    w = htons(w);
+    memcpy(d + i * 2, &w, sizeof(w));
+  }
+}
+
+void lcmbsHsetInit(LCMBS_HSET_T *set) {
+  memset(set, 0, sizeof(LCMBS_HSET_T));
+  lcmbsArenaInit(&set->keyData);
+}
+
+void lcmbsHsetFree(LCMBS_HSET_T *set) {
+  free(set->keys);
+  free(set->vals);
+  lcmbsArenaFree(&set->keyData);
+  lcmbsHsetInit(set);
+}
+
+static size_t hsetFind(const char **keys, size_t size, const char *key) {
+  size_t idx = lcmbsHashStr(key, 0) & (size - 1);
+
+  // linear probing, the table is never more than half full
+  while (keys[idx] != NULL && strcmp(keys[idx], key) != 0) {
+    idx = (idx + 1) & (size - 1);
+  }
+  return idx;
+}
+
+int lcmbsHsetAdd(LCMBS_HSET_T *set, const char *key) {
+  return lcmbsHsetPut(set, key, NULL);
+}
+
+int lcmbsHsetPut(LCMBS_HSET_T *set, const char *key, void *val) {
+  size_t i, idx;
+  char *copy;
+
+  // grow table to keep load factor below 1/2
+  if ((set->count + 1) * 2 > set->size) {
+    size_t size = set->size ? set->size << 1 : LCMBS_HSET_MINSIZE;
+    const char **keys = calloc(size, sizeof(const char *));
+    void **vals = calloc(size, sizeof(void *));
+    if (keys == NULL || vals == NULL) {
+      free(keys);
+      free(vals);
+      return -1;
+    }
+    for (i = 0; i < set->size; i++) {
+      if (set->keys[i] != NULL) {
+        idx = hsetFind(keys, size, set->keys[i]);
+        keys[idx] = set->keys[i];
+        vals[idx] = set->vals[i];
+      }
+    }
+    free(set->keys);
+    free(set->vals);
+    set->keys = keys;
+    set->vals = vals;
+    set->size = size;
+  }
+
+  // check for existing key
+  idx = hsetFind(set->keys, set->size, key);
+  if (set->keys[idx] != NULL) {
+    return 1;
+  }
+
+  // add copy of key
+  copy = lcmbsArenaAlloc(&set->keyData, strlen(key) + 1);
+  if (copy == NULL) {
+    return -1;
+  }
+  strcpy(copy, key);
+  set->keys[idx] = copy;
+  set->vals[idx] = val;
+  set->count++;
+  return 0;
+}
+
+void *lcmbsHsetGet(LCMBS_HSET_T *set, const char *key) {
+  if (set->size == 0) {
+    return NULL;
+  }
+
+  return set->vals[hsetFind(set->keys, set->size, key)];
+}
+
+void *lcmbsRcuPublish(LCMBS_RCU_T *rcu, void *ptr) {
+  void *old = __atomic_exchange_n(&rcu->ptr, ptr, __ATOMIC_SEQ_CST);
+  int i, idx;
+
+  // flip reader epoch twice and wait for the readers of the
+  // previous one to leave, no reader can see old afterwards
+  for (i = 0; i < 2; i++) {
+    idx = __atomic_fetch_add(&rcu->epoch, 1, __ATOMIC_SEQ_CST) & 1;
+    while (__atomic_load_n(&rcu->readers[idx], __ATOMIC_SEQ_CST) > 0) {
+      usleep(1000);
+    }
+  }
+
+  return old;
+}
+
+void lcmbsPtabInit(LCMBS_PTAB_T *ptab, LCMBS_ARENA_T *arena) {
+  memset(ptab, 0, sizeof(LCMBS_PTAB_T));
+  ptab->arena = arena;
+}
+
+void lcmbsPtabFree(LCMBS_PTAB_T *ptab) {
+  int i;
+
+  for (i = 0; i < LCMBS_PTAB_PAGE_COUNT; i++) {
+    if (ptab->arena == NULL) {
+      free(ptab->pages[i]);
+    }
+    ptab->pages[i] = NULL;
+  }
+  ptab->pageCount = 0;
+}
+
+int lcmbsPtabSet(LCMBS_PTAB_T *ptab, uint16_t addr, void *val) {
+  void ***page = &ptab->pages[addr >> LCMBS_PTAB_PAGE_BITS];
+
+  // allocate pages on first use
+  if (*page == NULL) {
+    if (ptab->arena != NULL) {
+      *page = lcmbsArenaAlloc(ptab->arena, LCMBS_PTAB_PAGE_SIZE * sizeof(void *));
+    } else {
+      *page = calloc(LCMBS_PTAB_PAGE_SIZE, sizeof(void *));
+    }
+    if (*page == NULL) {
+      return -1;
+    }
+    ptab->pageCount++;
+  }
+
+  (*page)[addr & LCMBS_PTAB_PAGE_MASK] = val;
+  return 0;
+}
+
+void lcmbsRateInit(LCMBS_RATE_T *rate, int perSec, int burst) {
+  // token bucket in GCRA form: a single theoretical arrival
+  // time replaces token count and refill timestamp, so shared
+  // buckets can be updated with compare and swap
+  rate->interval = (perSec > 0) ? 1000000000ULL / perSec : 0;
+  rate->tolerance = (burst > 1) ? rate->interval * (burst - 1) : 0;
+  rate->tat = 0;
+}
+
+uint64_t lcmbsRateTake(LCMBS_RATE_T *rate, uint64_t now) {
+  uint64_t old, tat, next;
+
+  // unlimited
+  if (rate->interval == 0) {
+    return 0;
+  }
+
+  old = __atomic_load_n(&rate->tat, __ATOMIC_RELAXED);
+  do {
+    tat = (old < now) ? now : old;
+
+    // bucket empty, return time until the next token
+    if (tat - now > rate->tolerance) {
+      return tat - now - rate->tolerance;
+    }
+
+    next = tat + rate->interval;
+  } while (!__atomic_compare_exchange_n(&rate->tat, &old, next, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+  return 0;
+}
+
+void lcmbsRateGiveBack(LCMBS_RATE_T *rate) {
+  __atomic_sub_fetch(&rate->tat, rate->interval, __ATOMIC_RELAXED);
+}
@@ -6,9 +6,32 @@
 
 extern const char *compName;
 
-#define LCMBS_VECT_BLKSIZE 32
+#define LCMBS_VECT_MINSIZE 256
+
+#define LCMBS_ARENA_BLKSIZE 65536
+#define LCMBS_ARENA_ALIGN   16
+
+#define LCMBS_HSET_MINSIZE 64
+
+#define LCMBS_PTAB_PAGE_BITS  8
+#define LCMBS_PTAB_PAGE_SIZE  (1 << LCMBS_PTAB_PAGE_BITS)
+#define LCMBS_PTAB_PAGE_MASK  (LCMBS_PTAB_PAGE_SIZE - 1)
+#define LCMBS_PTAB_PAGE_COUNT (65536 >> LCMBS_PTAB_PAGE_BITS)
+
+typedef struct LCMBS_ARENA_BLOCK {
+  struct LCMBS_ARENA_BLOCK *next;
+  size_t size;
+  size_t used;
+} LCMBS_ARENA_BLOCK_T;
+
+typedef struct {
+  LCMBS_ARENA_BLOCK_T *blocks;
+  size_t allocated;
+  size_t used;
+} LCMBS_ARENA_T;
 
 typedef struct {
+  LCMBS_ARENA_T *arena;
   size_t typeSize;
   size_t size;
   size_t count;
@@ -16,7 +39,39 @@ typedef struct {
   void *data;
 } LCMBS_VECT_T;
 
+typedef struct {
+  LCMBS_ARENA_T keyData;
+  size_t size;
+  size_t count;
+  const char **keys;
+  void **vals;
+} LCMBS_HSET_T;
+
+typedef struct {
+  void *ptr;
+  unsigned int epoch;
+  int readers[2];
+} LCMBS_RCU_T;
+
+typedef struct {
+  uint64_t interval;
+  uint64_t tolerance;
+  uint64_t tat;
+} LCMBS_RATE_T;
+
+typedef struct {
+  LCMBS_ARENA_T *arena;
+  int pageCount;
+  void **pages[LCMBS_PTAB_PAGE_COUNT];
+} LCMBS_PTAB_T;
+
+void lcmbsArenaInit(LCMBS_ARENA_T *arena);
+void lcmbsArenaFree(LCMBS_ARENA_T *arena);
+void *lcmbsArenaAlloc(LCMBS_ARENA_T *arena, size_t size);
+void *lcmbsArenaRealloc(LCMBS_ARENA_T *arena, void *ptr, size_t oldSize, size_t size);
+
 void lcmbsVectInit(LCMBS_VECT_T *vect, size_t typeSize);
+int lcmbsVectMoveToArena(LCMBS_VECT_T *vect, LCMBS_ARENA_T *arena);
 
 void *lcmbsVectEnsureSize(LCMBS_VECT_T *vect, size_t count);
 
@@ -30,10 +85,53 @@ void *lcmbsVectPull(LCMBS_VECT_T *vect);
 void *lcmbsVectPutByte(LCMBS_VECT_T *vect, uint8_t val);
 void *lcmbsVectPutWord(LCMBS_VECT_T *vect, uint16_t val);
 void *lcmbsVectPutDByte(LCMBS_VECT_T *vect, uint32_t val);
+void *lcmbsVectPutData(LCMBS_VECT_T *vect, const void *data, size_t len);
 
 void *lcmbsVectPullByte(LCMBS_VECT_T *vect, uint8_t *val);
 void *lcmbsVectPullWord(LCMBS_VECT_T *vect, uint16_t *val);
 void *lcmbsVectPullDByte(LCMBS_VECT_T *vect, uint32_t *val);
 
+uint64_t lcmbsTimeNs(void);
+
+int lcmbsStrListed(const char *list, const char *item);
+uint32_t lcmbsHashStr(const char *str, uint32_t seed);
+
+void lcmbsSwapWords(void *dst, const void *src, size_t count);
+
+void lcmbsHsetInit(LCMBS_HSET_T *set);
+void lcmbsHsetFree(LCMBS_HSET_T *set);
+int lcmbsHsetAdd(LCMBS_HSET_T *set, const char *key);
+int lcmbsHsetPut(LCMBS_HSET_T *set, const char *key, void *val);
+void *lcmbsHsetGet(LCMBS_HSET_T *set, const char *key);
+
+void *lcmbsRcuPublish(LCMBS_RCU_T *rcu, void *ptr);
+
+static inline int lcmbsRcuReadLock(LCMBS_RCU_T *rcu) {
+  int idx = __atomic_load_n(&rcu->epoch, __ATOMIC_SEQ_CST) & 1;
+  __atomic_add_fetch(&rcu->readers[idx], 1, __ATOMIC_SEQ_CST);
+  return idx;
+}
+
+static inline void *lcmbsRcuDeref(LCMBS_RCU_T *rcu) {
+  return __atomic_load_n(&rcu->ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline void lcmbsRcuReadUnlock(LCMBS_RCU_T *rcu, int idx) {
+  __atomic_sub_fetch(&rcu->readers[idx], 1, __ATOMIC_SEQ_CST);
+}
+
+void lcmbsRateInit(LCMBS_RATE_T *rate, int perSec, int burst);
+uint64_t lcmbsRateTake(LCMBS_RATE_T *rate, uint64_t now);
+void lcmbsRateGiveBack(LCMBS_RATE_T *rate);
+
+void lcmbsPtabInit(LCMBS_PTAB_T *ptab, LCMBS_ARENA_T *arena);
+void lcmbsPtabFree(LCMBS_PTAB_T *ptab);
+int lcmbsPtabSet(LCMBS_PTAB_T *ptab, uint16_t addr, void *val);
+
+static inline void *lcmbsPtabGet(const LCMBS_PTAB_T *ptab, uint16_t addr) {
+  void **page = ptab->pages[addr >> LCMBS_PTAB_PAGE_BITS];
+  return page ? page[addr & LCMBS_PTAB_PAGE_MASK] : NULL;
+}
+
 #endif
 